@@ -0,0 +1,98 @@
+// Request batcher benchmark: a closed-loop load generator where each client thread
+// submits one row, waits for its result and repeats. Compares direct single-row
+// NeuralNetwork::infer calls with Serving::RequestBatcher at several max_batch / max_wait
+// settings, reporting throughput and latency percentiles.
+//
+// Build:  g++ -std=c++17 -O2 -pthread -I src bench/batcher_bench.cpp -o batcher_bench
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "batcher.hpp"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    const std::vector<size_t> SIZES = {784, 256, 128, 10};
+    const double RUN_SECONDS = 1.0;  // Per setting
+
+    struct Setting {
+        size_t max_batch;
+        size_t max_wait_us;
+    };
+
+    // Direct infer() calls plus three batcher settings from latency- to throughput-leaning
+    const Setting SETTINGS[] = {{1, 0}, {16, 0}, {16, 100}, {64, 500}};
+
+    struct Result {
+        double throughput;
+        std::vector<double> latencies;  // Microseconds, sorted
+    };
+
+    // Runs `clients` threads for RUN_SECONDS, each calling request(input) in a loop
+    template<typename Fn>
+    Result load(size_t clients, Fn&& request) {
+        std::vector<std::vector<double>> samples(clients);
+        std::atomic<bool> done{false};
+        std::vector<std::thread> threads;
+        for (size_t c = 0; c < clients; ++c) {
+            threads.emplace_back([&, c] {
+                Matrix<float> input(1, SIZES.front());
+                input.randomize();
+                while (!done.load(std::memory_order_relaxed)) {
+                    auto start = Clock::now();
+                    request(input);
+                    samples[c].push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+                }
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::duration<double>(RUN_SECONDS));
+        done = true;
+        for (auto& thread : threads) thread.join();
+
+        Result result;
+        for (const auto& s : samples) result.latencies.insert(result.latencies.end(), s.begin(), s.end());
+        std::sort(result.latencies.begin(), result.latencies.end());
+        result.throughput = result.latencies.size() / RUN_SECONDS;
+        return result;
+    }
+
+    void report(const char* name, size_t clients, const Result& result, double mean_batch) {
+        const auto& l = result.latencies;
+        auto percentile = [&](double p) { return l.empty() ? 0.0 : l[std::min(l.size() - 1, size_t(p * l.size()))]; };
+        std::printf("%-22s clients %-3zu %9.0f req/s  p50 %8.1f us  p99 %8.1f us  p99.9 %8.1f us  mean batch %5.1f\n",
+                    name, clients, result.throughput, percentile(0.5), percentile(0.99), percentile(0.999), mean_batch);
+    }
+}
+
+int main() {
+    auto nn = std::make_shared<NeuralNetwork<float>>(std::make_shared<Loss::MSE<float>>());
+    for (size_t l = 0; l + 1 < SIZES.size(); ++l) {
+        std::shared_ptr<Activation::ActivationFunction<float>> act;
+        if (l + 2 == SIZES.size()) act = std::make_shared<Activation::Sigmoid<float>>();
+        else act = std::make_shared<Activation::ReLU<float>>();
+        nn->addLayer(std::make_shared<Layer<float>>(SIZES[l], SIZES[l + 1], act));
+    }
+    std::printf("mlp 784-256-128-10 float, %zu pool threads\n", Parallel::numThreads());
+
+    for (size_t clients : {size_t(1), size_t(8), size_t(32)}) {
+        Result direct = load(clients, [&](const Matrix<float>& input) {
+            thread_local Matrix<float> output(1, SIZES.back());
+            nn->infer(input, output.view());
+        });
+        report("direct infer", clients, direct, 1.0);
+
+        for (const Setting& setting : SETTINGS) {
+            Serving::RequestBatcher<float> batcher(nn, setting.max_batch,
+                                                   std::chrono::microseconds(setting.max_wait_us));
+            Result batched = load(clients, [&](const Matrix<float>& input) { batcher.submit(input).get(); });
+            auto stats = batcher.getStats();
+            char name[64];
+            std::snprintf(name, sizeof(name), "batch %zu wait %zu us", setting.max_batch, setting.max_wait_us);
+            report(name, clients, batched, stats.batches ? double(stats.requests) / stats.batches : 0.0);
+        }
+    }
+    return 0;
+}
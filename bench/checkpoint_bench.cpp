@@ -0,0 +1,83 @@
+// Checkpoint benchmark: saves a large MLP, then compares Checkpoint::load (memory-mapped,
+// weights stay in the mapping) with a copying load that reads the whole file into
+// memory first. Reports load time and the latency of the first predict() after the load
+// (which pays for faulting in the mapped pages), and checks that the loaded network
+// predicts exactly what the saved one did; exits with status 1 otherwise.
+//
+// Build:  g++ -std=c++17 -O2 -pthread -I src bench/checkpoint_bench.cpp -o checkpoint_bench
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#include "checkpoint.hpp"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    const std::vector<size_t> SIZES = {1024, 2048, 2048, 10};
+    const char* PATH = "checkpoint_bench.nnck";
+    const size_t REPEATS = 5;
+
+    double millis(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // The file contents every non-mapping loader must at least copy into memory
+    std::vector<char> readAll(const char* path) {
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        std::vector<char> bytes(static_cast<size_t>(in.tellg()));
+        in.seekg(0);
+        in.read(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        return bytes;
+    }
+
+    bool identical(const Matrix<float>& a, const Matrix<float>& b) {
+        for (size_t i = 0; i < a.getRows(); ++i) {
+            for (size_t j = 0; j < a.getCols(); ++j) {
+                if (a.at(i, j) != b.at(i, j)) return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main() {
+    NeuralNetwork<float> nn(std::make_shared<Loss::MSE<float>>());
+    for (size_t l = 0; l + 1 < SIZES.size(); ++l) {
+        std::shared_ptr<Activation::ActivationFunction<float>> act;
+        if (l + 2 == SIZES.size()) act = std::make_shared<Activation::Sigmoid<float>>();
+        else act = std::make_shared<Activation::ReLU<float>>();
+        nn.addLayer(std::make_shared<Layer<float>>(SIZES[l], SIZES[l + 1], act));
+    }
+    Matrix<float> input(16, SIZES.front());
+    input.randomize();
+    const Matrix<float> expected = nn.predict(input);
+
+    auto start = Clock::now();
+    Checkpoint::save(nn, PATH);
+    const double save_ms = millis(start);
+    const size_t bytes = readAll(PATH).size();
+    std::printf("mlp 1024-2048-2048-10 float, %.1f MB checkpoint, save %.2f ms\n", bytes / 1e6, save_ms);
+
+    bool match = true;
+    for (size_t r = 0; r < REPEATS; ++r) {
+        start = Clock::now();
+        auto loaded = Checkpoint::load<float>(PATH);
+        const double load_ms = millis(start);
+        start = Clock::now();
+        const Matrix<float> output = loaded->predict(input);
+        const double first_ms = millis(start);
+        match &= identical(output, expected);
+
+        start = Clock::now();
+        std::vector<char> copy = readAll(PATH);
+        const double copy_ms = millis(start);
+
+        std::printf("  mmap load %8.3f ms  first predict %7.2f ms   |   read into memory %8.3f ms (%zu bytes)\n",
+                    load_ms, first_ms, copy_ms, copy.size());
+    }
+    std::remove(PATH);
+
+    std::printf("loaded predictions %s\n", match ? "identical" : "DIFFER");
+    return match ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+"""Compare two nn_bench JSON result files and flag performance regressions.
+
+A case regresses when both its median and its fastest sample are slower than the
+baseline by more than the threshold. Requiring both keeps one noisy sample from failing
+the comparison. Exits with status 1 if any case regressed.
+
+Usage: compare.py baseline.json current.json [--threshold 0.10]
+"""
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        data = json.load(f)
+    return data.get("context", {}), {r["name"]: r for r in data["results"]}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=0.10,
+                        help="relative slowdown that counts as a regression (default 0.10)")
+    args = parser.parse_args()
+
+    base_context, base = load(args.baseline)
+    cur_context, cur = load(args.current)
+    if base_context != cur_context:
+        print(f"warning: contexts differ\n  baseline {base_context}\n  current  {cur_context}\n")
+
+    regressions = improvements = 0
+    width = max((len(name) for name in cur), default=10)
+    print(f"{'case':<{width}} {'baseline ns':>14} {'current ns':>14} {'change':>8}")
+    for name, result in cur.items():
+        if name not in base:
+            print(f"{name:<{width}} {'-':>14} {result['median_ns']:>14.1f}      new")
+            continue
+        before = base[name]
+        ratio = result["median_ns"] / before["median_ns"]
+        min_ratio = result["min_ns"] / before["min_ns"]
+        status = ""
+        if ratio > 1 + args.threshold and min_ratio > 1 + args.threshold:
+            status = "  REGRESSION"
+            regressions += 1
+        elif ratio < 1 - args.threshold and min_ratio < 1 - args.threshold:
+            status = "  improved"
+            improvements += 1
+        print(f"{name:<{width}} {before['median_ns']:>14.1f} {result['median_ns']:>14.1f} "
+              f"{(ratio - 1) * 100:>+7.1f}%{status}")
+    for name in base:
+        if name not in cur:
+            print(f"{name:<{width}} {base[name]['median_ns']:>14.1f} {'-':>14}  missing")
+
+    print(f"\n{regressions} regression(s), {improvements} improvement(s) beyond {args.threshold:.0%}")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
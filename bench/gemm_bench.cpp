@@ -0,0 +1,139 @@
+// GEMM benchmark: compares the blocked engine against the naive reference loop
+// and, optionally, a reference BLAS at every SIMD level the CPU supports.
+// Also times the transpose-flag variants (A*B^T, A^T*B) used by backpropagation.
+// Exits with status 1 when any result is further from the reference than the tolerance
+// of its type, which grows with the inner dimension k.
+//
+// Build:  g++ -std=c++17 -O2 -I src bench/gemm_bench.cpp -o gemm_bench
+// With BLAS comparison:
+//         g++ -std=c++17 -O2 -I src -DNN_BENCH_CBLAS bench/gemm_bench.cpp -o gemm_bench -lopenblas
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <type_traits>
+#include <vector>
+#include <string>
+#include "matrix.hpp"
+
+#ifdef NN_BENCH_CBLAS
+#include <cblas.h>
+#endif
+
+namespace {
+    // Shapes as [batch x inputs] * [inputs x outputs], matching Layer::forward
+    struct Shape { size_t m, k, n; };
+
+    const Shape SHAPES[] = {
+        {1000, 2, 4},      // XOR hidden layer
+        {256, 128, 128},
+        {1024, 256, 256},
+        {1024, 512, 512},
+        {2048, 1024, 1024},
+        {333, 257, 129},   // Ragged edges exercise the partial-tile path
+    };
+
+    // Run fn repeatedly for at least min_seconds and return the best time per call
+    template<typename Fn>
+    double bestSeconds(Fn&& fn, double min_seconds = 0.3) {
+        double best = 1e30, total = 0;
+        for (int rep = 0; rep < 3 || total < min_seconds; ++rep) {
+            auto start = std::chrono::steady_clock::now();
+            fn();
+            double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            best = std::min(best, s);
+            total += s;
+        }
+        return best;
+    }
+
+    template<typename T>
+    T maxRelativeError(const Matrix<T>& a, const Matrix<T>& b) {
+        T worst = 0;
+        for (size_t i = 0; i < a.size(); ++i) {
+            T denom = std::max(std::abs(b.data()[i]), T(1));
+            worst = std::max(worst, std::abs(a.data()[i] - b.data()[i]) / denom);
+        }
+        return worst;
+    }
+
+    // Largest accepted maxRelativeError for an inner dimension of k: rounding error of a
+    // k-term dot product grows at most linearly in k
+    template<typename T>
+    double tolerance(size_t k) {
+        return (std::is_same<T, double>::value ? 1e-15 : 1e-7) * double(k);
+    }
+
+#ifdef NN_BENCH_CBLAS
+    void blas(const Shape& s, const double* a, const double* b, double* c) {
+        cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, s.m, s.n, s.k,
+                    1.0, a, s.k, b, s.n, 0.0, c, s.n);
+    }
+    void blas(const Shape& s, const float* a, const float* b, float* c) {
+        cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, s.m, s.n, s.k,
+                    1.0f, a, s.k, b, s.n, 0.0f, c, s.n);
+    }
+#endif
+
+    // Returns false when any variant exceeds tolerance<T>
+    template<typename T>
+    bool run(const char* type_name) {
+        const Simd::Level best = Simd::detect();
+        bool ok = true;
+        for (const Shape& s : SHAPES) {
+            Matrix<T> a(s.m, s.k), b(s.k, s.n), expected(s.m, s.n), c(s.m, s.n);
+            a.randomize();
+            b.randomize();
+            const double flops = 2.0 * s.m * s.n * s.k;
+            const double tol = tolerance<T>(s.k);
+
+            double naive = bestSeconds([&] {
+                Gemm::reference<T>(s.m, s.n, s.k, T(1), a.data(), s.k, 1, b.data(), s.n, 1,
+                                   T(0), expected.data(), s.n);
+            });
+            std::printf("%-6s %5zux%-5zux%-5zu  %-8s %8.2f GFLOP/s\n", type_name, s.m, s.k, s.n,
+                        "naive", flops / naive * 1e-9);
+
+            for (int level = 0; level <= static_cast<int>(best); ++level) {
+                Simd::setLevel(static_cast<Simd::Level>(level));
+                double t = bestSeconds([&] { c = a.dot(b); });
+                const double err = maxRelativeError(c, expected);
+                std::printf("%-6s %5zux%-5zux%-5zu  %-8s %8.2f GFLOP/s  (x%.1f vs naive, max rel err %.2e)%s\n",
+                            type_name, s.m, s.k, s.n, Simd::name(Simd::activeLevel()),
+                            flops / t * 1e-9, naive / t, err, err > tol ? "   FAIL" : "");
+                ok &= err <= tol;
+            }
+            Simd::setLevel(best);
+
+            // Transpose-flag variants read the stored layout directly; compare against copying first
+            Matrix<T> bt = b.transpose(), at = a.transpose();
+            double fused_abt = bestSeconds([&] { c = a.dot(bt, Gemm::Transpose::No, Gemm::Transpose::Yes); });
+            T err_abt = maxRelativeError(c, expected);
+            double copied_abt = bestSeconds([&] { c = a.dot(bt.transpose()); });
+            double fused_atb = bestSeconds([&] { c = at.dot(b, Gemm::Transpose::Yes); });
+            T err_atb = maxRelativeError(c, expected);
+            double copied_atb = bestSeconds([&] { c = at.transpose().dot(b); });
+            std::printf("%-6s %5zux%-5zux%-5zu  %-8s %8.2f GFLOP/s  (copy+dot %.2f, max rel err %.2e)%s\n",
+                        type_name, s.m, s.k, s.n, "A*B^T", flops / fused_abt * 1e-9,
+                        flops / copied_abt * 1e-9, double(err_abt), err_abt > tol ? "   FAIL" : "");
+            std::printf("%-6s %5zux%-5zux%-5zu  %-8s %8.2f GFLOP/s  (copy+dot %.2f, max rel err %.2e)%s\n",
+                        type_name, s.m, s.k, s.n, "A^T*B", flops / fused_atb * 1e-9,
+                        flops / copied_atb * 1e-9, double(err_atb), err_atb > tol ? "   FAIL" : "");
+            ok &= err_abt <= tol && err_atb <= tol;
+
+#ifdef NN_BENCH_CBLAS
+            double t = bestSeconds([&] { blas(s, a.data(), b.data(), c.data()); });
+            std::printf("%-6s %5zux%-5zux%-5zu  %-8s %8.2f GFLOP/s\n", type_name, s.m, s.k, s.n,
+                        "blas", flops / t * 1e-9);
+#endif
+        }
+        return ok;
+    }
+}
+
+int main() {
+    std::printf("Detected SIMD level: %s\n\n", Simd::name(Simd::detect()));
+    bool ok = run<double>("double");
+    std::printf("\n");
+    ok &= run<float>("float");
+    return ok ? 0 : 1;
+}
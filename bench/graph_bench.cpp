@@ -0,0 +1,254 @@
+// Compute graph benchmark
+//  1. Training and inference workspace per batch row from the graph's memory plan, next to
+//     the per-layer caches it replaced (an output and a delta per layer plus the loss
+//     gradient), for deep chains and a residual network
+//  2. Correctness: chain gradients against the layer-by-layer LayerCache path, and
+//     gradients of a graph with branches, a residual sum and a concat against central
+//     finite differences
+//  3. Time per training step: the graph executor against the layer-by-layer loop over
+//     LayerCache state it replaced
+//
+// Build:  g++ -std=c++17 -O2 -pthread -I src bench/graph_bench.cpp -o graph_bench
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "neural_network.hpp"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    const size_t BATCH = 256;
+    const size_t REPEATS = 20;
+
+    template<typename T>
+    std::shared_ptr<Layer<T>> dense(size_t inputs, size_t outputs, bool output_layer = false) {
+        std::shared_ptr<Activation::ActivationFunction<T>> act;
+        if (output_layer) act = std::make_shared<Activation::Sigmoid<T>>();
+        else act = std::make_shared<Activation::ReLU<T>>();
+        auto layer = std::make_shared<Layer<T>>(inputs, outputs, act);
+        // Small weights keep deep chains from saturating
+        const T scale = T(1) / std::sqrt(static_cast<T>(inputs));
+        Matrix<T> w(inputs, outputs), b(1, outputs);
+        w.randomize(-scale, scale);
+        b.randomize(-scale, scale);
+        auto owner = std::make_shared<std::vector<Matrix<T>>>(std::vector<Matrix<T>>{w, b});
+        return std::make_shared<Layer<T>>((*owner)[0].view(), (*owner)[1].view(), act, owner);
+    }
+
+    // Chain of `depth` layers of `width`, then a 10-wide output
+    NeuralNetwork<float> chain(size_t depth, size_t width, Precision::Format format = Precision::Format::Native) {
+        NeuralNetwork<float> nn(std::make_shared<Loss::MSE<float>>());
+        nn.setStorageFormat(format);
+        for (size_t l = 0; l < depth; ++l) nn.addLayer(dense<float>(width, width));
+        nn.addLayer(dense<float>(width, 10, true));
+        return nn;
+    }
+
+    // `blocks` residual blocks h = h + f(g(h)) of `width`, then a 10-wide output
+    NeuralNetwork<float> residual(size_t blocks, size_t width) {
+        NeuralNetwork<float> nn(std::make_shared<Loss::MSE<float>>());
+        Graph::NodeId h = nn.addLayer(dense<float>(width, width), nn.input());
+        for (size_t b = 0; b < blocks; ++b) {
+            const Graph::NodeId inner = nn.addLayer(dense<float>(width, width), h);
+            h = nn.add({h, nn.addLayer(dense<float>(width, width), inner)});
+        }
+        nn.addLayer(dense<float>(width, 10, true), h);
+        return nn;
+    }
+
+    // Bytes per row of the per-layer caches: output and delta of every layer (and its
+    // 16-bit output in mixed precision), plus the loss gradient
+    size_t cachedRowBytes(const NeuralNetwork<float>& nn) {
+        size_t bytes = 0;
+        for (const auto& layer : nn.getLayers()) {
+            const size_t width = layer->getWeights().getCols();
+            bytes += 2 * width * sizeof(float);
+            if (nn.getStorageFormat() != Precision::Format::Native) bytes += width * sizeof(uint16_t);
+        }
+        return bytes + nn.outputSize() * sizeof(float);
+    }
+
+    void reportMemory(const char* name, const NeuralNetwork<float>& nn) {
+        const Graph::Plan& training = nn.getGraph().trainingPlan();
+        const Graph::Plan& inference = nn.getGraph().inferencePlan();
+        const size_t cached = cachedRowBytes(nn);
+        std::printf("  %-22s %3zu layers  train: caches %8.2f MB  planned %8.2f MB  (%4.1f%%)   infer: %6.2f MB  of %8.2f MB\n",
+                    name, nn.getLayers().size(), cached * BATCH / 1e6, training.row_bytes * BATCH / 1e6,
+                    100.0 * training.row_bytes / cached, inference.row_bytes * BATCH / 1e6,
+                    inference.unshared_row_bytes * BATCH / 1e6);
+    }
+
+    template<typename T>
+    T maxRelativeDifference(MatrixView<const T> a, MatrixView<const T> b) {
+        T scale = 0, diff = 0;
+        for (size_t i = 0; i < a.getRows(); ++i) {
+            for (size_t j = 0; j < a.getCols(); ++j) {
+                scale = std::max(scale, std::fabs(b.at(i, j)));
+                diff = std::max(diff, std::fabs(a.at(i, j) - b.at(i, j)));
+            }
+        }
+        return scale > 0 ? diff / scale : diff;
+    }
+
+    // The training step the graph replaced: layer by layer over LayerCache state, each
+    // layer writing the previous layer's delta from its propagation GEMM
+    struct LayerLoop {
+        const std::vector<std::shared_ptr<Layer<float>>>& layers;
+        std::vector<LayerCache<float>> caches;
+        ParameterArena<float> arena;
+        std::vector<LayerGradients<float>> grads;
+        Matrix<float> error{0, 0};
+
+        explicit LayerLoop(const std::vector<std::shared_ptr<Layer<float>>>& layers) : layers(layers), caches(layers.size()) {
+            std::vector<ParameterArena<float>::Shape> layout;
+            for (const auto& layer : layers) {
+                for (const auto& shape : layer->parameterShapes()) layout.push_back(shape);
+            }
+            arena = ParameterArena<float>(layout);
+            for (size_t l = 0; l < layers.size(); ++l) grads.push_back(layers[l]->gradientsIn(arena, 2 * l));
+        }
+
+        float step(const Matrix<float>& x, const Matrix<float>& y, const Loss::LossFunction<float>& loss) {
+            MatrixView<const float> current = x;
+            MatrixView<const uint16_t> current16;
+            for (size_t l = 0; l < layers.size(); ++l) {
+                current = layers[l]->forward(current, caches[l], current16);
+                current16 = layers[l]->getStorageFormat() == Precision::Format::Native
+                    ? MatrixView<const uint16_t>() : caches[l].output16.view();
+            }
+            const float value = loss.lossAndGradient(current, y, error);
+            layers.back()->computeDelta(error, caches.back());
+            for (size_t l = layers.size(); l-- > 0;) {
+                layers[l]->backwardFromDelta(caches[l], grads[l], l > 0 ? layers[l - 1].get() : nullptr,
+                                             l > 0 ? &caches[l - 1] : nullptr);
+            }
+            return value;
+        }
+    };
+
+    void checkChain() {
+        NeuralNetwork<float> nn = chain(6, 128);
+        Matrix<float> x(BATCH, 128), y(BATCH, 10);
+        x.randomize();
+        y.randomize(0.0f, 1.0f);
+
+        LayerLoop loop(nn.getLayers());
+        const float reference_loss = loop.step(x, y, *nn.getLossFunction());
+
+        const Graph::ComputeGraph<float>& graph = nn.getGraph();
+        Graph::Workspace<float> ws;
+        LayerLoop sink(nn.getLayers());  // Gradient storage of the graph pass
+        graph.forward(ws, x);
+        const float loss = graph.backward(ws, *nn.getLossFunction(), y, 1.0f, sink.grads);
+        float diff = 0;
+        for (size_t l = 0; l < loop.grads.size(); ++l) {
+            diff = std::max(diff, maxRelativeDifference<float>(sink.grads[l].weights, loop.grads[l].weights));
+            diff = std::max(diff, maxRelativeDifference<float>(sink.grads[l].bias, loop.grads[l].bias));
+        }
+        std::printf("  chain vs layer loop       loss diff %.2e   max gradient diff %.2e\n",
+                    double(std::fabs(loss - reference_loss)), double(diff));
+    }
+
+    // Branches, a residual sum and a concat, checked against central differences in double
+    void checkBranches() {
+        const size_t rows = 16;
+        NeuralNetwork<double> nn(std::make_shared<Loss::MSE<double>>());
+        auto tanh = std::make_shared<Activation::Tanh<double>>();
+        auto sigmoid = std::make_shared<Activation::Sigmoid<double>>();
+        const Graph::NodeId a = nn.addLayer(std::make_shared<Layer<double>>(8, 12, tanh), nn.input());
+        const Graph::NodeId b = nn.addLayer(std::make_shared<Layer<double>>(12, 12, tanh), a);
+        const Graph::NodeId sum = nn.add({a, b, a});
+        const Graph::NodeId c = nn.addLayer(std::make_shared<Layer<double>>(12, 6, std::make_shared<Activation::Softmax<double>>()), sum);
+        const Graph::NodeId joined = nn.concat({c, sum, b});
+        nn.addLayer(std::make_shared<Layer<double>>(30, 4, sigmoid), joined);
+
+        // Parameters in one arena, so the check can perturb them in place
+        std::vector<ParameterArena<double>::Shape> layout;
+        for (const auto& layer : nn.getLayers()) {
+            for (const auto& shape : layer->parameterShapes()) layout.push_back(shape);
+        }
+        auto params = std::make_shared<ParameterArena<double>>(layout);
+        ParameterArena<double> grad_arena(layout);
+        std::vector<LayerGradients<double>> grads;
+        for (size_t l = 0; l < nn.getLayers().size(); ++l) {
+            nn.getLayers()[l]->bindParameters(params->tensor(2 * l), params->tensor(2 * l + 1), params);
+            grads.push_back(nn.getLayers()[l]->gradientsIn(grad_arena, 2 * l));
+        }
+
+        Matrix<double> x(rows, 8), y(rows, 4);
+        x.randomize();
+        y.randomize(0.0, 1.0);
+        const Graph::ComputeGraph<double>& graph = nn.getGraph();
+        Graph::Workspace<double> ws;
+        graph.forward(ws, x);
+        graph.backward(ws, *nn.getLossFunction(), y, 1.0, grads);
+
+        const double h = 1e-6;
+        double worst = 0;
+        for (size_t i = 0; i < params->size(); i += 7) {
+            double* p = params->data() + i;
+            const double saved = *p;
+            *p = saved + h;
+            const double up = nn.getLossFunction()->calculate(graph.forward(ws, x), y);
+            *p = saved - h;
+            const double down = nn.getLossFunction()->calculate(graph.forward(ws, x), y);
+            *p = saved;
+            const double numeric = (up - down) / (2 * h);
+            const double analytic = grad_arena.data()[i];
+            worst = std::max(worst, std::fabs(numeric - analytic) / std::max(1e-6, std::fabs(numeric) + std::fabs(analytic)));
+        }
+        std::printf("  branches vs finite diff   max relative error %.2e over %zu parameters\n", worst,
+                    (params->size() + 6) / 7);
+    }
+
+    double timeSteps(const std::function<void()>& step) {
+        step();
+        double best = 1e30;
+        for (size_t i = 0; i < REPEATS; ++i) {
+            auto start = Clock::now();
+            step();
+            best = std::min(best, std::chrono::duration<double>(Clock::now() - start).count());
+        }
+        return best;
+    }
+
+    void benchStep(const char* name, size_t depth, size_t width) {
+        NeuralNetwork<float> nn = chain(depth, width);
+        Matrix<float> x(BATCH, width), y(BATCH, 10);
+        x.randomize();
+        y.randomize(0.0f, 1.0f);
+        LayerLoop loop(nn.getLayers());
+        const Graph::ComputeGraph<float>& graph = nn.getGraph();
+        Graph::Workspace<float> ws;
+        const double layered = timeSteps([&] { loop.step(x, y, *nn.getLossFunction()); });
+        const double planned = timeSteps([&] {
+            graph.forward(ws, x);
+            graph.backward(ws, *nn.getLossFunction(), y, 1.0f, loop.grads);
+        });
+        std::printf("  %-22s layer loop %7.2f ms   graph %7.2f ms   x%.2f\n", name, layered * 1e3, planned * 1e3,
+                    layered / planned);
+    }
+}
+
+int main() {
+    std::printf("activation + gradient memory for %zu rows (float)\n", BATCH);
+    reportMemory("mlp 4x512", chain(4, 512));
+    reportMemory("deep 32x512", chain(32, 512));
+    reportMemory("deep 128x256", chain(128, 256));
+    reportMemory("deep 32x512 bf16", chain(32, 512, Precision::Format::BFloat16));
+    reportMemory("residual 16x2x512", residual(16, 512));
+
+    std::printf("\ncorrectness\n");
+    checkChain();
+    checkBranches();
+
+    std::printf("\ntraining step (forward + backward), %zu rows (%s, %zu threads)\n", BATCH,
+                Simd::name(Simd::activeLevel()), Parallel::numThreads());
+    benchStep("mlp 4x512", 4, 512);
+    benchStep("deep 32x256", 32, 256);
+    return 0;
+}
@@ -0,0 +1,115 @@
+// Inference latency benchmark: single-sample NeuralNetwork::infer() calls from several
+// threads at once on one shared network. Reports latency percentiles per call and heap
+// allocations per steady-state call (global operator new is replaced with a counting
+// version); exits with status 1 if a steady-state call allocates.
+//
+// Build:  g++ -std=c++17 -O2 -pthread -I src bench/inference_bench.cpp -o inference_bench
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include "neural_network.hpp"
+
+// The counting operators pair malloc with free; GCC cannot see that and warns
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+namespace {
+    std::atomic<size_t> allocations{0};
+}
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    const size_t align = static_cast<size_t>(alignment);
+    if (void* p = std::aligned_alloc(align, (size + align - 1) / align * align)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+namespace {
+    struct Config {
+        const char* name;
+        std::vector<size_t> sizes;  // Layer widths, input first
+        size_t calls;               // Calls per thread
+    };
+
+    const Config CONFIGS[] = {
+        {"xor", {2, 4, 1}, 200000},
+        {"mlp", {784, 256, 128, 10}, 5000},
+    };
+
+    const size_t WARMUP_CALLS = 100;
+
+    template<typename T>
+    bool run(const Config& config, const char* type_name, size_t threads) {
+        NeuralNetwork<T> nn(std::make_shared<Loss::MSE<T>>());
+        for (size_t l = 0; l + 1 < config.sizes.size(); ++l) {
+            std::shared_ptr<Activation::ActivationFunction<T>> act;
+            if (l + 2 == config.sizes.size()) act = std::make_shared<Activation::Sigmoid<T>>();
+            else act = std::make_shared<Activation::ReLU<T>>();
+            nn.addLayer(std::make_shared<Layer<T>>(config.sizes[l], config.sizes[l + 1], act));
+        }
+
+        // Each thread owns its input and output rows and records its own latencies
+        std::vector<std::vector<double>> samples(threads, std::vector<double>(config.calls));
+        std::atomic<size_t> ready{0};
+        std::atomic<size_t> steady_allocations{0};
+        auto worker = [&](size_t id) {
+            Matrix<T> input(1, config.sizes.front());
+            Matrix<T> output(1, config.sizes.back());
+            input.randomize();
+            for (size_t i = 0; i < WARMUP_CALLS; ++i) nn.infer(input, output.view());
+
+            ready.fetch_add(1);
+            while (ready.load() < threads) std::this_thread::yield();
+            const size_t before = allocations.load();
+            for (size_t i = 0; i < config.calls; ++i) {
+                auto start = std::chrono::steady_clock::now();
+                nn.infer(input, output.view());
+                samples[id][i] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+            }
+            // Other threads' allocations would show up here too, so any count is a failure
+            steady_allocations.fetch_add(allocations.load() - before);
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> pool;
+        for (size_t t = 0; t < threads; ++t) pool.emplace_back(worker, t);
+        for (auto& thread : pool) thread.join();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::vector<double> all;
+        for (const auto& s : samples) all.insert(all.end(), s.begin(), s.end());
+        std::sort(all.begin(), all.end());
+        auto percentile = [&](double p) { return all[std::min(all.size() - 1, size_t(p * all.size()))]; };
+        std::printf("%-4s %-6s threads %-2zu p50 %8.2f us  p99 %8.2f us  p99.9 %8.2f us  %10.0f calls/s  %zu allocations\n",
+                    config.name, type_name, threads, percentile(0.5), percentile(0.99), percentile(0.999),
+                    all.size() / seconds, steady_allocations.load());
+        return steady_allocations.load() == 0;
+    }
+}
+
+int main() {
+    bool clean = true;
+    const size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    for (const Config& config : CONFIGS) {
+        for (size_t threads : {size_t(1), std::max(size_t(4), hardware)}) {
+            clean &= run<double>(config, "double", threads);
+            clean &= run<float>(config, "float", threads);
+        }
+    }
+    if (!clean) std::printf("FAIL: steady-state infer() allocated\n");
+    return clean ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+// Loss benchmark
+//  1. Accuracy of the loss value on a wide output against a long double reference: the
+//     fused pass (pairwise chunks, compensated sums) next to a plain running float sum
+//  2. Agreement of the fused output deltas (sigmoid + BCE, softmax + cross-entropy) with the
+//     unfused chain loss gradient -> activation backward
+//  3. Time per training step's loss work on a [ROWS x COLS] output: calculate() +
+//     derivativeInto() (+ the activation backward) against one lossAndGradient() or
+//     lossAndDelta() pass
+//
+// Build:  g++ -std=c++17 -O2 -pthread -I src bench/loss_bench.cpp -o loss_bench
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+#include "loss.hpp"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    const size_t ROWS = 256;
+    const size_t COLS = 16384;
+    const size_t REPEATS = 20;
+
+    double timeCalls(const std::function<void()>& call) {
+        call();
+        double best = 1e30;
+        for (size_t i = 0; i < REPEATS; ++i) {
+            auto start = Clock::now();
+            call();
+            best = std::min(best, std::chrono::duration<double>(Clock::now() - start).count());
+        }
+        return best;
+    }
+
+    // Softmax rows of random scores, and one-hot targets
+    void classification(Matrix<float>& probabilities, Matrix<float>& targets, std::mt19937& rng) {
+        Matrix<float> scores(ROWS, COLS);
+        scores.randomize(-4.0f, 4.0f);
+        probabilities = Activation::Softmax<float>().forward(scores);
+        targets = Matrix<float>(ROWS, COLS);
+        for (size_t i = 0; i < ROWS; ++i) targets.at(i, rng() % COLS) = 1.0f;
+    }
+
+    // Sigmoid outputs of random scores, and 0/1 targets
+    void binary(Matrix<float>& probabilities, Matrix<float>& targets, std::mt19937& rng) {
+        Matrix<float> scores(ROWS, COLS);
+        scores.randomize(-6.0f, 6.0f);
+        probabilities = Activation::Sigmoid<float>().forward(scores);
+        targets = Matrix<float>(ROWS, COLS);
+        for (size_t i = 0; i < targets.size(); ++i) targets.data()[i] = float(rng() % 2);
+    }
+
+    // Relative error of the fused loss and of a running float sum of the same terms
+    void accuracy(const char* name, const Loss::LossFunction<float>& loss, const Matrix<float>& y,
+                  const Matrix<float>& t, double divisor, long double (*term)(long double, long double)) {
+        long double exact = 0;
+        float naive = 0;
+        for (size_t i = 0; i < y.size(); ++i) {
+            const long double value = term(y.data()[i], t.data()[i]);
+            exact += value;
+            naive += static_cast<float>(value);
+        }
+        exact /= divisor;
+        const double fused = loss.calculate(y, t);
+        std::printf("  %-14s fused %.3e   running float sum %.3e\n", name,
+                    double(std::fabs((fused - exact) / exact)), double(std::fabs((naive / divisor - exact) / exact)));
+    }
+
+    long double squaredTerm(long double y, long double t) { return (y - t) * (y - t); }
+    long double bceTerm(long double y, long double t) {
+        return -(t * std::log(std::max(y, 1e-38L)) + (1 - t) * std::log(std::max(1 - y, 1e-38L)));
+    }
+    long double ceTerm(long double y, long double t) { return t == 0 ? 0 : -t * std::log(std::max(y, 1e-38L)); }
+
+    float maxRelativeDifference(const Matrix<float>& a, const Matrix<float>& b) {
+        float scale = 0, diff = 0;
+        for (size_t i = 0; i < a.size(); ++i) {
+            scale = std::max(scale, std::fabs(b.data()[i]));
+            diff = std::max(diff, std::fabs(a.data()[i] - b.data()[i]));
+        }
+        return diff / scale;
+    }
+
+    struct Case {
+        const char* name;
+        std::shared_ptr<Loss::LossFunction<float>> loss;
+        std::shared_ptr<Activation::ActivationFunction<float>> activation;  // Output activation
+        Matrix<float> y{0, 0};
+        Matrix<float> t{0, 0};
+    };
+}
+
+int main() {
+    std::mt19937 rng(42);
+    std::vector<Case> cases(3);
+    cases[0].name = "mse";
+    cases[0].loss = std::make_shared<Loss::MSE<float>>();
+    cases[0].activation = std::make_shared<Activation::Sigmoid<float>>();
+    binary(cases[0].y, cases[0].t, rng);
+    cases[1].name = "sigmoid+bce";
+    cases[1].loss = std::make_shared<Loss::BinaryCrossEntropy<float>>();
+    cases[1].activation = std::make_shared<Activation::Sigmoid<float>>();
+    binary(cases[1].y, cases[1].t, rng);
+    cases[2].name = "softmax+ce";
+    cases[2].loss = std::make_shared<Loss::CrossEntropy<float>>();
+    cases[2].activation = std::make_shared<Activation::Softmax<float>>();
+    classification(cases[2].y, cases[2].t, rng);
+
+    std::printf("loss value relative error on [%zu x %zu] float (%s, %zu threads)\n", ROWS, COLS,
+                Simd::name(Simd::activeLevel()), Parallel::numThreads());
+    accuracy(cases[0].name, *cases[0].loss, cases[0].y, cases[0].t, double(ROWS * COLS), squaredTerm);
+    accuracy(cases[1].name, *cases[1].loss, cases[1].y, cases[1].t, double(ROWS * COLS), bceTerm);
+    accuracy(cases[2].name, *cases[2].loss, cases[2].y, cases[2].t, double(ROWS), ceTerm);
+
+    std::printf("\nfused delta vs loss gradient -> activation backward, max |difference| / max |delta|\n");
+    for (size_t c = 1; c < cases.size(); ++c) {
+        Case& k = cases[c];
+        Matrix<float> gradient(0, 0), chained(0, 0), fused(0, 0);
+        k.loss->lossAndGradient(k.y, k.t, gradient);
+        k.activation->backwardInto(gradient, k.y, chained);
+        k.loss->lossAndDelta(*k.activation, k.y, k.t, fused);
+        std::printf("  %-14s %.2e\n", k.name, maxRelativeDifference(fused, chained));
+    }
+
+    std::printf("\nloss + output delta per step, [%zu x %zu] float\n", ROWS, COLS);
+    for (Case& k : cases) {
+        Matrix<float> gradient(ROWS, COLS), delta(ROWS, COLS);
+        volatile float sink = 0;
+        const double separate = timeCalls([&] {
+            sink = k.loss->calculate(k.y, k.t);
+            k.loss->derivativeInto(k.y, k.t, gradient);
+            k.activation->backwardInto(gradient, k.y, delta);
+        });
+        const bool fuses = k.loss->fusesActivation(*k.activation);
+        const double fused = timeCalls([&] {
+            if (fuses) {
+                sink = k.loss->lossAndDelta(*k.activation, k.y, k.t, delta);
+            } else {
+                sink = k.loss->lossAndGradient(k.y, k.t, gradient);
+                k.activation->backwardInto(gradient, k.y, delta);
+            }
+        });
+        (void)sink;
+        std::printf("  %-14s separate %7.2f ms   %s %7.2f ms   x%.2f\n", k.name, separate * 1e3,
+                    fuses ? "lossAndDelta   " : "lossAndGradient", fused * 1e3, separate / fused);
+    }
+    return 0;
+}
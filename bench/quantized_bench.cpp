@@ -0,0 +1,103 @@
+// Int8 inference benchmark: latency of Quantized::Model::predict against
+// NeuralNetwork::predict at batch sizes 1, 16 and 256, for every SIMD level the CPU
+// supports, plus the accuracy delta of the int8 model on a synthetic classification task.
+//
+// Build:  g++ -std=c++17 -O2 -pthread -I src bench/quantized_bench.cpp -o quantized_bench
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "quantized.hpp"
+
+namespace {
+    const size_t BATCHES[] = {1, 16, 256};
+    const size_t LATENCY_CALLS = 2000;  // Calls per batch size; percentiles over these
+
+    struct Latency {
+        double median;
+        double p99;
+    };
+
+    template<typename Fn>
+    Latency measure(Fn&& fn, size_t calls) {
+        std::vector<double> samples(calls);
+        for (size_t i = 0; i < 10; ++i) fn();  // Warm caches and scratch buffers
+        for (size_t i = 0; i < calls; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            fn();
+            samples[i] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        }
+        std::sort(samples.begin(), samples.end());
+        return Latency{samples[calls / 2], samples[calls * 99 / 100]};
+    }
+
+    std::shared_ptr<NeuralNetwork<float>> buildNetwork(const std::vector<size_t>& sizes) {
+        auto nn = std::make_shared<NeuralNetwork<float>>(std::make_shared<Loss::MSE<float>>());
+        for (size_t l = 0; l + 1 < sizes.size(); ++l) {
+            std::shared_ptr<Activation::ActivationFunction<float>> act;
+            if (l + 2 == sizes.size()) act = std::make_shared<Activation::Sigmoid<float>>();
+            else act = std::make_shared<Activation::ReLU<float>>();
+            nn->addLayer(std::make_shared<Layer<float>>(sizes[l], sizes[l + 1], act));
+        }
+        return nn;
+    }
+
+    // Label is 1 when the first half of the features outweighs the second half
+    void makeDataset(size_t rows, size_t cols, Matrix<float>& x, Matrix<float>& y, std::mt19937& rng) {
+        std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+        x.resize(rows, cols);
+        y.resize(rows, 1);
+        for (size_t i = 0; i < rows; ++i) {
+            float balance = 0;
+            for (size_t j = 0; j < cols; ++j) {
+                x.at(i, j) = dist(rng);
+                balance += j < cols / 2 ? x.at(i, j) : -x.at(i, j);
+            }
+            y.at(i, 0) = balance > 0 ? 1.0f : 0.0f;
+        }
+    }
+
+    void latency(NeuralNetwork<float>& nn, const Quantized::Model<float>& model, size_t inputs) {
+        for (size_t batch : BATCHES) {
+            Matrix<float> input(batch, inputs);
+            input.randomize();
+            Latency reference = measure([&] { nn.predict(input); }, LATENCY_CALLS);
+            Latency quantized = measure([&] { model.predict(input); }, LATENCY_CALLS);
+            std::printf("  batch %-4zu float %9.2f us (p99 %9.2f)   int8 %9.2f us (p99 %9.2f)   speedup %5.2fx\n",
+                        batch, reference.median, reference.p99, quantized.median, quantized.p99,
+                        reference.median / quantized.median);
+        }
+    }
+}
+
+int main() {
+    std::mt19937 rng(42);
+
+    // Accuracy: train a small classifier in float, then quantize it
+    Matrix<float> train_x(0, 0), train_y(0, 0), test_x(0, 0), test_y(0, 0);
+    makeDataset(4096, 64, train_x, train_y, rng);
+    makeDataset(2048, 64, test_x, test_y, rng);
+    auto classifier = buildNetwork({64, 128, 64, 1});
+    for (size_t epoch = 0; epoch < 30; ++epoch) classifier->trainEpoch(train_x, train_y, 64, 0.05f);
+    Quantized::Model<float> int8_classifier(*classifier, train_x.rowRange(0, 512));
+    auto report = Quantized::compareAccuracy(*classifier, int8_classifier, test_x, test_y);
+    std::printf("accuracy  float %.2f%%  int8 %.2f%%  delta %+.2f%%\n",
+                report.reference * 100, report.quantized * 100, report.delta() * 100);
+
+    // Latency: an MNIST-sized MLP with random weights
+    const std::vector<size_t> sizes = {784, 256, 128, 10};
+    auto mlp = buildNetwork(sizes);
+    Matrix<float> calibration(256, sizes.front());
+    calibration.randomize();
+    Quantized::Model<float> int8_mlp(*mlp, calibration);
+
+    const Simd::Level detected = Simd::detect();
+    for (int level = 0; level <= static_cast<int>(detected); ++level) {
+        Simd::setLevel(static_cast<Simd::Level>(level));
+        std::printf("mlp 784-256-128-10, level %s%s, threads %zu\n", Simd::name(Simd::activeLevel()),
+                    Simd::hasVnni() ? "+vnni" : "", Parallel::numThreads());
+        latency(*mlp, int8_mlp, sizes.front());
+    }
+    return 0;
+}
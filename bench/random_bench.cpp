@@ -0,0 +1,245 @@
+// Random number benchmark
+//  1. Philox4x32-10 against the published known-answer vectors, and the bulk kernels of
+//     every SIMD level the CPU supports against the single-block reference
+//  2. Bulk fills with 1 and 4 threads, which must give identical bits
+//  3. Moments of uniform and normal fills, and the normal CDF at a few points
+//  4. Throughput of fillUniform / fillNormal against std::mt19937 with the standard
+//     distributions, and of initializing many small matrices against the previous
+//     randomize() (a std::random_device and a new std::mt19937 per call)
+//  5. Weight standard deviation of each Layer initialization scheme
+//
+// Build:  g++ -std=c++17 -O2 -pthread -I src bench/random_bench.cpp -o random_bench
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+#include "neural_network.hpp"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    const size_t COUNT = size_t(1) << 24;
+
+    double timeCall(const std::function<void()>& call) {
+        call();
+        double best = 1e30;
+        for (size_t i = 0; i < 5; ++i) {
+            auto start = Clock::now();
+            call();
+            best = std::min(best, std::chrono::duration<double>(Clock::now() - start).count());
+        }
+        return best;
+    }
+
+    // Random123's kat_vectors for philox4x32_10
+    bool knownAnswers() {
+        struct Case {
+            uint32_t counter[4];
+            uint32_t key[2];
+            uint32_t expected[4];
+        };
+        const Case cases[] = {
+            {{0, 0, 0, 0}, {0, 0}, {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}},
+            {{0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+             {0xffffffff, 0xffffffff},
+             {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}},
+            {{0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344},
+             {0xa4093822, 0x299f31d0},
+             {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}},
+        };
+        bool ok = true;
+        for (const Case& c : cases) {
+            const Random::detail::Key key{(uint64_t(c.key[1]) << 32) | c.key[0], (uint64_t(c.counter[3]) << 32) | c.counter[2]};
+            uint32_t words[4];
+            Random::detail::philox(key, (uint64_t(c.counter[1]) << 32) | c.counter[0], words);
+            const bool match = std::equal(words, words + 4, c.expected);
+            std::printf("  %08x %08x %08x %08x  %s\n", words[0], words[1], words[2], words[3], match ? "ok" : "MISMATCH");
+            ok &= match;
+        }
+        return ok;
+    }
+
+    // Bulk uniform(0, 1) floats at every level against the same values computed from the
+    // single-block reference; scaling by powers of two is exact, so all must match bit for bit
+    bool kernelsMatchReference() {
+        const size_t count = 1000;  // Ends in a partial group
+        Random::Generator generator(7, 3);
+        std::vector<float> expected(count);
+        const size_t per_group = Random::detail::Layout<float>::PER_GROUP;
+        for (size_t i = 0; i < count; ++i) {
+            const size_t group = i / per_group, w = i % per_group / Random::GROUP_BLOCKS;
+            const size_t l = i % Random::GROUP_BLOCKS;
+            uint32_t words[4];
+            Random::detail::philox({7, 3}, group * Random::GROUP_BLOCKS + l, words);
+            expected[i] = static_cast<float>(((words[w] >> 9) << 1) | 1u) * 5.9604644775390625e-08f;
+        }
+
+        bool ok = true;
+        const Simd::Level best = Simd::detect();
+        for (int level = 0; level <= static_cast<int>(best); ++level) {
+            Simd::setLevel(static_cast<Simd::Level>(level));
+            std::vector<float> values(count);
+            Random::Generator(7, 3).fillUniform(values.data(), count, 0.0f, 1.0f);
+            const bool match = std::memcmp(values.data(), expected.data(), count * sizeof(float)) == 0;
+            std::printf("  %-7s bulk kernel %s\n", Simd::name(Simd::activeLevel()), match ? "matches" : "DIFFERS");
+            ok &= match;
+        }
+        Simd::setLevel(best);
+        return ok;
+    }
+
+    template<typename T>
+    bool sameForThreadCounts(const char* type) {
+        std::vector<T> one(COUNT / 4 + 123), four(COUNT / 4 + 123);
+        bool ok = true;
+        for (bool normal : {false, true}) {
+            for (size_t threads : {size_t(1), size_t(4)}) {
+                Parallel::setNumThreads(threads);
+                std::vector<T>& out = threads == 1 ? one : four;
+                Random::Generator generator(11, 5);
+                if (normal) generator.fillNormal(out.data(), out.size(), T(0), T(1));
+                else generator.fillUniform(out.data(), out.size(), T(-1), T(1));
+            }
+            const bool same = std::memcmp(one.data(), four.data(), one.size() * sizeof(T)) == 0;
+            std::printf("  %-6s %-7s 1 vs 4 threads: %s\n", type, normal ? "normal" : "uniform",
+                        same ? "identical" : "DIFFERENT");
+            ok &= same;
+        }
+        Parallel::setNumThreads(Parallel::detail::defaultThreadCount());
+        return ok;
+    }
+
+    template<typename T>
+    bool moments(const char* type) {
+        std::vector<T> values(COUNT);
+        Random::Generator generator(Random::nextSeed());
+
+        generator.fillUniform(values.data(), COUNT, T(0), T(1));
+        double sum = 0, squares = 0;
+        for (T v : values) {
+            sum += v;
+            squares += double(v) * v;
+        }
+        const double u_mean = sum / COUNT, u_var = squares / COUNT - u_mean * u_mean;
+
+        generator.fillNormal(values.data(), COUNT, T(0), T(1));
+        sum = squares = 0;
+        for (T v : values) {
+            sum += v;
+            squares += double(v) * v;
+        }
+        const double n_mean = sum / COUNT, n_var = squares / COUNT - n_mean * n_mean;
+
+        // Fraction below k against Phi(k)
+        double cdf_error = 0;
+        for (double k : {-3.0, -2.0, -1.0, 0.0, 1.0, 2.0, 3.0}) {
+            const size_t below = std::count_if(values.begin(), values.end(), [&](T v) { return v < k; });
+            cdf_error = std::max(cdf_error, std::fabs(double(below) / COUNT - 0.5 * std::erfc(-k / std::sqrt(2.0))));
+        }
+        std::printf("  %-6s uniform mean %.5f var %.5f (1/12 = %.5f)   normal mean %+.5f var %.5f   max CDF error %.1e\n",
+                    type, u_mean, u_var, 1.0 / 12, n_mean, n_var, cdf_error);
+        // Five standard errors for 2^24 draws
+        return std::fabs(u_mean - 0.5) < 4e-4 && std::fabs(u_var - 1.0 / 12) < 2e-4 && std::fabs(n_mean) < 1.5e-3 &&
+               std::fabs(n_var - 1) < 2e-3 && cdf_error < 7e-4;
+    }
+
+    void throughput() {
+        std::vector<float> values(COUNT);
+        const double fill_uniform = timeCall([&] {
+            Random::Generator generator(1);
+            generator.fillUniform(values.data(), COUNT, -1.0f, 1.0f);
+        });
+        const double fill_normal = timeCall([&] {
+            Random::Generator generator(1);
+            generator.fillNormal(values.data(), COUNT, 0.0f, 1.0f);
+        });
+        const double mt_uniform = timeCall([&] {
+            std::mt19937 gen(1);
+            std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+            for (float& v : values) v = dis(gen);
+        });
+        const double mt_normal = timeCall([&] {
+            std::mt19937 gen(1);
+            std::normal_distribution<float> dis(0.0f, 1.0f);
+            for (float& v : values) v = dis(gen);
+        });
+        std::printf("  uniform  mt19937 %7.1f M/s   Philox fill %7.1f M/s   x%.1f\n", COUNT / mt_uniform / 1e6,
+                    COUNT / fill_uniform / 1e6, mt_uniform / fill_uniform);
+        std::printf("  normal   mt19937 %7.1f M/s   Philox fill %7.1f M/s   x%.1f\n", COUNT / mt_normal / 1e6,
+                    COUNT / fill_normal / 1e6, mt_normal / fill_normal);
+
+        // Many small tensors, as a network of small layers initializes them
+        const size_t tensors = 2000;
+        std::vector<Matrix<float>> matrices(tensors, Matrix<float>(32, 32));
+        const double previous = timeCall([&] {
+            for (auto& m : matrices) {
+                std::random_device rd;
+                std::mt19937 gen(rd());
+                std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+                for (size_t i = 0; i < m.size(); ++i) m.data()[i] = dis(gen);
+            }
+        });
+        const double current = timeCall([&] {
+            for (auto& m : matrices) m.randomize();
+        });
+        std::printf("  %zu 32x32 randomize() calls: random_device + mt19937 %.2f ms   Philox streams %.2f ms   x%.1f\n",
+                    tensors, previous * 1e3, current * 1e3, previous / current);
+    }
+
+    bool layerInit() {
+        const size_t inputs = 512, outputs = 256;
+        const struct {
+            WeightInit init;
+            const char* name;
+            double stddev;
+        } schemes[] = {
+            {WeightInit::Uniform, "uniform", std::sqrt(1.0 / 3)},
+            {WeightInit::XavierUniform, "xavier uniform", std::sqrt(2.0 / (inputs + outputs))},
+            {WeightInit::XavierNormal, "xavier normal", std::sqrt(2.0 / (inputs + outputs))},
+            {WeightInit::HeUniform, "he uniform", std::sqrt(2.0 / inputs)},
+            {WeightInit::HeNormal, "he normal", std::sqrt(2.0 / inputs)},
+        };
+        bool ok = true;
+        for (const auto& scheme : schemes) {
+            Layer<float> layer(inputs, outputs, std::make_shared<Activation::ReLU<float>>(), scheme.init);
+            const MatrixView<const float> w = layer.getWeights();
+            double squares = 0;
+            for (size_t i = 0; i < inputs; ++i)
+                for (size_t j = 0; j < outputs; ++j) squares += double(w.at(i, j)) * w.at(i, j);
+            const double stddev = std::sqrt(squares / (inputs * outputs));
+            const bool close = std::fabs(stddev / scheme.stddev - 1) < 0.01;
+            std::printf("  %-15s weight std %.5f (expected %.5f)%s\n", scheme.name, stddev, scheme.stddev,
+                        close ? "" : "   OFF");
+            ok &= close;
+        }
+        return ok;
+    }
+}
+
+int main() {
+    bool ok = true;
+    std::printf("Philox4x32-10 known answers\n");
+    ok &= knownAnswers();
+    ok &= kernelsMatchReference();
+
+    std::printf("\ndeterminism across thread counts\n");
+    ok &= sameForThreadCounts<float>("float");
+    ok &= sameForThreadCounts<double>("double");
+
+    std::printf("\nmoments of %zu draws\n", COUNT);
+    ok &= moments<float>("float");
+    ok &= moments<double>("double");
+
+    std::printf("\nthroughput, %zu floats, %s, %zu threads\n", COUNT, Simd::name(Simd::activeLevel()),
+                Parallel::numThreads());
+    throughput();
+
+    std::printf("\nlayer initialization, 512 x 256\n");
+    ok &= layerInit();
+    return ok ? 0 : 1;
+}
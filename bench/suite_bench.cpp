@@ -0,0 +1,254 @@
+// Benchmark suite for regression tracking: Matrix::dot across shapes, elementwise ops,
+// activations, Layer forward/backward and NeuralNetwork training epochs (XOR and larger
+// MLPs). Every case reports the median time per call over several samples; results can be
+// written as JSON and compared against a stored baseline with bench/compare.py.
+//
+// Build:  cmake --build <build dir> --target nn_bench    (or the `bench` target, which runs it)
+//         g++ -std=c++17 -O2 -pthread -I src bench/suite_bench.cpp -o nn_bench
+// Usage:  nn_bench [--json results.json] [--filter substring] [--samples n] [--min-time seconds]
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+#include "neural_network.hpp"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Options {
+        std::string json;
+        std::string filter;
+        size_t samples = 7;
+        double min_time = 0.02;  // Seconds per sample; short cases repeat until they take this long
+    };
+
+    struct Result {
+        std::string name;
+        std::string group;
+        double median_ns;
+        double min_ns;
+        double spread;            // (max - min) / median over the samples
+        size_t iterations;        // Calls per sample
+        double flops;             // Per call; 0 when not meaningful
+    };
+
+    class Suite {
+    private:
+        Options options;
+        std::vector<Result> results;
+
+    public:
+        explicit Suite(Options options) : options(std::move(options)) {}
+
+        // Time fn; flops is the work of one call (0 to skip GFLOP/s)
+        void run(const std::string& group, const std::string& name, double flops, const std::function<void()>& fn) {
+            const std::string full = group + "/" + name;
+            if (!options.filter.empty() && full.find(options.filter) == std::string::npos) return;
+
+            // Calibrate the iteration count so one sample takes at least min_time
+            fn();
+            size_t iterations = 1;
+            while (true) {
+                auto start = Clock::now();
+                for (size_t i = 0; i < iterations; ++i) fn();
+                const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+                if (elapsed >= options.min_time || iterations >= (size_t(1) << 30)) break;
+                iterations *= elapsed > 0 ? std::clamp<size_t>(size_t(options.min_time / elapsed * 1.2), 2, 100) : 100;
+            }
+
+            std::vector<double> samples(options.samples);
+            for (double& sample : samples) {
+                auto start = Clock::now();
+                for (size_t i = 0; i < iterations; ++i) fn();
+                sample = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+            }
+            std::sort(samples.begin(), samples.end());
+            const double median = samples[samples.size() / 2];
+            results.push_back(Result{name, group, median, samples.front(),
+                                     (samples.back() - samples.front()) / median, iterations, flops});
+
+            const Result& r = results.back();
+            std::printf("%-56s %14.1f ns  (min %14.1f, spread %5.1f%%)", full.c_str(), r.median_ns, r.min_ns,
+                        r.spread * 100);
+            if (flops > 0) std::printf("  %8.2f GFLOP/s", flops / r.median_ns);
+            std::printf("\n");
+            std::fflush(stdout);
+        }
+
+        void writeJson() const {
+            if (options.json.empty()) return;
+            std::ofstream out(options.json);
+            if (!out) {
+                std::fprintf(stderr, "Cannot create %s\n", options.json.c_str());
+                std::exit(1);
+            }
+            char buffer[512];
+            std::snprintf(buffer, sizeof(buffer),
+                          "{\n  \"context\": {\"simd\": \"%s\", \"threads\": %zu, \"compiler\": \"%s\"},\n"
+                          "  \"results\": [",
+                          Simd::name(Simd::activeLevel()), Parallel::numThreads(), __VERSION__);
+            out << buffer;
+            for (size_t i = 0; i < results.size(); ++i) {
+                const Result& r = results[i];
+                std::snprintf(buffer, sizeof(buffer),
+                              "%s\n    {\"name\": \"%s/%s\", \"median_ns\": %.1f, \"min_ns\": %.1f, \"spread\": %.4f, "
+                              "\"iterations\": %zu, \"gflops\": %.3f}",
+                              i ? "," : "", r.group.c_str(), r.name.c_str(), r.median_ns, r.min_ns, r.spread,
+                              r.iterations, r.flops > 0 ? r.flops / r.median_ns : 0.0);
+                out << buffer;
+            }
+            out << "\n  ]\n}\n";
+            std::printf("\n%zu results written to %s\n", results.size(), options.json.c_str());
+        }
+    };
+
+    std::string shapeName(size_t m, size_t k, size_t n) {
+        return std::to_string(m) + "x" + std::to_string(k) + "x" + std::to_string(n);
+    }
+
+    template<typename T>
+    void dotCases(Suite& suite, const char* type) {
+        struct Shape { size_t m, k, n; };
+        const Shape shapes[] = {
+            {1000, 2, 4},     // XOR hidden layer
+            {1, 784, 256},    // Single-sample inference
+            {64, 64, 64},
+            {256, 256, 256},
+            {128, 784, 256},  // MLP first layer
+            {1024, 512, 512},
+            {333, 257, 129},  // Ragged edges
+        };
+        for (const Shape& s : shapes) {
+            Matrix<T> a(s.m, s.k), b(s.k, s.n), c(0, 0);
+            a.randomize();
+            b.randomize();
+            suite.run(std::string("dot_") + type, shapeName(s.m, s.k, s.n), 2.0 * s.m * s.k * s.n,
+                      [&] { a.dotInto(b, c); });
+            if (s.m > 1 && s.m == s.k) {
+                suite.run(std::string("dot_") + type, shapeName(s.m, s.k, s.n) + "_AtB", 2.0 * s.m * s.k * s.n,
+                          [&] { a.dotInto(b, c, Gemm::Transpose::Yes, Gemm::Transpose::No); });
+            }
+        }
+    }
+
+    void elementwiseCases(Suite& suite) {
+        const size_t rows = 1024, cols = 1024;
+        Matrix<float> a(rows, cols), b(rows, cols);
+        a.randomize();
+        b.randomize();
+        const double n = double(rows) * cols;
+        suite.run("elementwise", "add_inplace_1M", n, [&] { a += b; });
+        suite.run("elementwise", "axpy_1M", 2 * n, [&] { a.axpy(1e-6f, b); });
+        suite.run("elementwise", "scale_1M", n, [&] { a *= 0.999999f; });
+        suite.run("elementwise", "hadamard_1M", n, [&] { Matrix<float> c = a.hadamard(b); });
+        // Lazy expression chain: one fused pass into an existing matrix
+        Matrix<float> c(rows, cols);
+        suite.run("elementwise", "expr_chain_1M", 4 * n, [&] { c = (a - b) * 0.5f + a.hadamard(b); });
+    }
+
+    void activationCases(Suite& suite) {
+        Matrix<float> x(256, 1024);
+        x.randomize();
+        Activation::ReLU<float> relu;
+        Activation::Sigmoid<float> sigmoid;
+        Activation::Tanh<float> tanh;
+        const Matrix<float> relu_y = relu.forward(x), sigmoid_y = sigmoid.forward(x);
+        suite.run("activation", "relu_forward_256x1024", 0, [&] { Matrix<float> y = relu.forward(x); });
+        suite.run("activation", "relu_backward_256x1024", 0, [&] { Matrix<float> d = relu.backward(relu_y); });
+        suite.run("activation", "sigmoid_forward_256x1024", 0, [&] { Matrix<float> y = sigmoid.forward(x); });
+        suite.run("activation", "sigmoid_backward_256x1024", 0, [&] { Matrix<float> d = sigmoid.backward(sigmoid_y); });
+        suite.run("activation", "tanh_forward_256x1024", 0, [&] { Matrix<float> y = tanh.forward(x); });
+    }
+
+    void layerCases(Suite& suite) {
+        const size_t batch = 128, inputs = 784, outputs = 256;
+        Layer<float> layer(inputs, outputs, std::make_shared<Activation::ReLU<float>>());
+        Matrix<float> input(batch, inputs), error(batch, outputs);
+        input.randomize();
+        error.randomize();
+        LayerCache<float> state;
+        ParameterArena<float> grad_arena(layer.parameterShapes());
+        LayerGradients<float> grads = layer.gradientsIn(grad_arena);
+        const double gemm_flops = 2.0 * batch * inputs * outputs;
+        suite.run("layer", "forward_128x784x256_relu", gemm_flops, [&] { layer.forward(input, state); });
+        layer.forward(input, state);
+        suite.run("layer", "backward_128x784x256_relu", 2 * gemm_flops, [&] { layer.backward(error, state, grads); });
+    }
+
+    // Network of the given widths: ReLU hidden layers and a sigmoid output
+    std::shared_ptr<NeuralNetwork<float>> buildNetwork(const std::vector<size_t>& sizes) {
+        auto nn = std::make_shared<NeuralNetwork<float>>(std::make_shared<Loss::MSE<float>>());
+        for (size_t l = 0; l + 1 < sizes.size(); ++l) {
+            std::shared_ptr<Activation::ActivationFunction<float>> act;
+            if (l + 2 == sizes.size()) act = std::make_shared<Activation::Sigmoid<float>>();
+            else act = std::make_shared<Activation::ReLU<float>>();
+            nn->addLayer(std::make_shared<Layer<float>>(sizes[l], sizes[l + 1], act));
+        }
+        return nn;
+    }
+
+    void trainCases(Suite& suite) {
+        struct Config {
+            const char* name;
+            std::vector<size_t> sizes;
+            size_t rows;
+            size_t batch;
+        };
+        const Config configs[] = {
+            {"xor_2-4-1_1000rows_full_batch", {2, 4, 1}, 1000, 1000},
+            {"mlp_784-256-128-10_2048rows_batch128", {784, 256, 128, 10}, 2048, 128},
+            {"mlp_1024-1024-1024-10_1024rows_batch256", {1024, 1024, 1024, 10}, 1024, 256},
+        };
+        for (const Config& config : configs) {
+            auto nn = buildNetwork(config.sizes);
+            Matrix<float> x(config.rows, config.sizes.front()), y(config.rows, config.sizes.back());
+            x.randomize(0, 1);
+            y.randomize(0, 1);
+            // Forward + backward of every layer: 3 GEMMs of 2 * rows * in * out flops each
+            double flops = 0;
+            for (size_t l = 0; l + 1 < config.sizes.size(); ++l) flops += 6.0 * config.rows * config.sizes[l] * config.sizes[l + 1];
+            suite.run("train_epoch", config.name, flops, [&] { nn->trainEpoch(x, y, config.batch, 0.01f); });
+        }
+    }
+
+    Options parse(int argc, char** argv) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            auto value = [&](const char* flag) -> const char* {
+                if (i + 1 >= argc) {
+                    std::fprintf(stderr, "%s needs a value\n", flag);
+                    std::exit(2);
+                }
+                return argv[++i];
+            };
+            if (!std::strcmp(argv[i], "--json")) options.json = value("--json");
+            else if (!std::strcmp(argv[i], "--filter")) options.filter = value("--filter");
+            else if (!std::strcmp(argv[i], "--samples")) options.samples = std::max(1, std::atoi(value("--samples")));
+            else if (!std::strcmp(argv[i], "--min-time")) options.min_time = std::atof(value("--min-time"));
+            else {
+                std::fprintf(stderr, "Usage: %s [--json file] [--filter substring] [--samples n] [--min-time seconds]\n", argv[0]);
+                std::exit(2);
+            }
+        }
+        return options;
+    }
+}
+
+int main(int argc, char** argv) {
+    Suite suite(parse(argc, argv));
+    std::printf("simd %s, %zu pool threads\n\n", Simd::name(Simd::activeLevel()), Parallel::numThreads());
+    dotCases<float>(suite, "float");
+    dotCases<double>(suite, "double");
+    elementwiseCases(suite);
+    activationCases(suite);
+    layerCases(suite);
+    trainCases(suite);
+    suite.writeJson();
+    return 0;
+}
@@ -0,0 +1,101 @@
+// Training step benchmark: time per NeuralNetwork::train() call and heap allocations
+// per steady-state step, for double, float and float with bf16/fp16 storage. Global operator new is replaced with a counting version; after
+// a short warm-up every step must run without allocating, and the program exits with
+// status 1 if one does.
+//
+// Build:  g++ -std=c++17 -O2 -pthread -I src bench/train_step_bench.cpp -o train_step_bench
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include "neural_network.hpp"
+
+// The counting operators pair malloc with free; GCC cannot see that and warns
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+namespace {
+    std::atomic<size_t> allocations{0};
+}
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    const size_t align = static_cast<size_t>(alignment);
+    if (void* p = std::aligned_alloc(align, (size + align - 1) / align * align)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+namespace {
+    struct Config {
+        const char* name;
+        std::vector<size_t> sizes;  // Layer widths, input first
+        size_t batch;
+    };
+
+    const Config CONFIGS[] = {
+        {"xor", {2, 4, 1}, 1000},
+        {"mlp", {784, 256, 128, 10}, 256},
+        {"wide", {1024, 1024, 1024}, 512},
+    };
+
+    const size_t WARMUP_STEPS = 5;
+    const size_t MEASURED_STEPS = 50;
+
+    // Returns false if any measured step allocated
+    template<typename T>
+    bool run(const Config& config, const char* type_name, Precision::Format storage = Precision::Format::Native) {
+        NeuralNetwork<T> nn(std::make_shared<Loss::MSE<T>>());
+        for (size_t l = 0; l + 1 < config.sizes.size(); ++l) {
+            std::shared_ptr<Activation::ActivationFunction<T>> act;
+            if (l + 2 == config.sizes.size()) act = std::make_shared<Activation::Sigmoid<T>>();
+            else act = std::make_shared<Activation::ReLU<T>>();
+            nn.addLayer(std::make_shared<Layer<T>>(config.sizes[l], config.sizes[l + 1], act));
+        }
+        nn.setStorageFormat(storage);
+        Matrix<T> input(config.batch, config.sizes.front());
+        Matrix<T> expected(config.batch, config.sizes.back());
+        input.randomize();
+        expected.randomize(0, 1);
+
+        for (size_t step = 0; step < WARMUP_STEPS; ++step) nn.train(input, expected, T(0.01));
+
+        const size_t before = allocations.load();
+        auto start = std::chrono::steady_clock::now();
+        for (size_t step = 0; step < MEASURED_STEPS; ++step) nn.train(input, expected, T(0.01));
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const size_t allocated = allocations.load() - before;
+
+        std::printf("%-5s %-6s %-6s batch %-5zu threads %-3zu %9.3f ms/step  %6.2f allocations/step\n",
+                    config.name, type_name, Precision::name(storage), config.batch, Parallel::numThreads(),
+                    seconds / MEASURED_STEPS * 1e3, double(allocated) / MEASURED_STEPS);
+        return allocated == 0;
+    }
+}
+
+int main() {
+    bool clean = true;
+    const size_t threads = Parallel::numThreads();
+    for (size_t count : {size_t(1), threads}) {
+        Parallel::setNumThreads(count);
+        for (const Config& config : CONFIGS) {
+            clean &= run<double>(config, "double");
+            clean &= run<float>(config, "float");
+            clean &= run<float>(config, "float", Precision::Format::BFloat16);
+            clean &= run<float>(config, "float", Precision::Format::Float16);
+        }
+        if (threads == 1) break;
+    }
+    if (!clean) std::printf("FAIL: steady-state train() allocated\n");
+    return clean ? 0 : 1;
+}
@@ -1,7 +1,13 @@
 
 #pragma once
 #include <cmath>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
 #include "matrix.hpp"
+#include "thread_pool.hpp"
+#include "vector_math.hpp"
 
 namespace Activation {
     // Base class for activation functions
@@ -13,7 +19,55 @@ namespace Activation {
         virtual Matrix<T> forward(const Matrix<T>& x) const = 0;
         
         // Backward pass: compute activation derivative
-        virtual Matrix<T> backward(const Matrix<T>& x) const = 0;
+        // Layer passes the cached forward output y = f(x), so derivatives are expressed in y
+        virtual Matrix<T> backward(const Matrix<T>& y) const = 0;
+
+        // Fused kernels let Layer apply the activation inside the GEMM epilogue,
+        // skipping the intermediate matrices of forward()/backward()
+        // Layer only calls them when this returns true
+        virtual bool hasFusedKernels() const { return false; }
+
+        // Fused forward for one row segment: values[j] = f(values[j] + bias[j]), in place
+        virtual void forwardFused(T* values, const T* bias, size_t count) const {
+            // Generic fallback through forward(); fused activations override this
+            Matrix<T> z(1, count);
+            for (size_t j = 0; j < count; ++j) z.at(0, j) = values[j] + bias[j];
+            Matrix<T> activated = forward(z);
+            std::copy(activated.data(), activated.data() + count, values);
+        }
+
+        // Fused backward for one row segment: delta[j] = error[j] * derivative(output[j])
+        // error and delta may point to the same memory
+        virtual void backwardFused(const T* error, const T* output, T* delta, size_t count) const {
+            // Generic fallback through backward(); fused activations override this
+            Matrix<T> out(1, count);
+            std::copy(output, output + count, out.data());
+            Matrix<T> derivative = backward(out);
+            for (size_t j = 0; j < count; ++j) delta[j] = error[j] * derivative.at(0, j);
+        }
+
+        // Backward pass for whole matrices: delta = error * derivative(output), elementwise
+        // delta has the output's shape and may be the same memory as error; rows have unit
+        // column stride. Activations whose Jacobian is not diagonal (Softmax) override this
+        virtual void backwardInto(MatrixView<const T> error, MatrixView<const T> output, MatrixView<T> delta) const {
+            const Matrix<T> derivative = backward(Matrix<T>(output));
+            for (size_t i = 0; i < output.getRows(); ++i) {
+                const T* err = error.row(i).data();
+                const T* d = derivative.row(i).data();
+                T* out = delta.row(i).data();
+                for (size_t j = 0; j < output.getCols(); ++j) out[j] = err[j] * d[j];
+            }
+        }
+
+        // Same into a matrix, resized like output
+        void backwardInto(const Matrix<T>& error, const Matrix<T>& output, Matrix<T>& delta) const {
+            delta.resize(output.getRows(), output.getCols());
+            backwardInto(error.view(), output.view(), delta.view());
+        }
+
+        // Identifier stored in checkpoints (see create()); nullptr for activations that
+        // cannot be saved
+        virtual const char* name() const { return nullptr; }
         
         virtual ~ActivationFunction() = default;
     };
@@ -24,15 +78,19 @@ namespace Activation {
     template<typename T>
     class ReLU : public ActivationFunction<T> {
     public:
+        const char* name() const override { return "relu"; }
+
         // Forward pass: max(0, x)
         // Helps network learn non-linear patterns
         Matrix<T> forward(const Matrix<T>& x) const override {
             Matrix<T> result(x.getRows(), x.getCols());
-            for (size_t i = 0; i < x.getRows(); ++i) {
-                for (size_t j = 0; j < x.getCols(); ++j) {
-                    result.at(i, j) = std::max(static_cast<T>(0), x.at(i, j));
+            const T* in = x.data();
+            T* out = result.data();
+            Parallel::parallelFor(0, x.size(), Parallel::ELEMENTWISE_GRAIN, [&](size_t lo, size_t hi) {
+                for (size_t i = lo; i < hi; ++i) {
+                    out[i] = std::max(static_cast<T>(0), in[i]);
                 }
-            }
+            });
             return result;
         }
 
@@ -40,13 +98,31 @@ namespace Activation {
         // Returns 1 for positive inputs, 0 for negative
         Matrix<T> backward(const Matrix<T>& x) const override {
             Matrix<T> result(x.getRows(), x.getCols());
-            for (size_t i = 0; i < x.getRows(); ++i) {
-                for (size_t j = 0; j < x.getCols(); ++j) {
-                    result.at(i, j) = x.at(i, j) > 0 ? 1 : 0;
+            const T* in = x.data();
+            T* out = result.data();
+            Parallel::parallelFor(0, x.size(), Parallel::ELEMENTWISE_GRAIN, [&](size_t lo, size_t hi) {
+                for (size_t i = lo; i < hi; ++i) {
+                    out[i] = in[i] > 0 ? 1 : 0;
                 }
-            }
+            });
             return result;
         }
+
+        bool hasFusedKernels() const override { return true; }
+
+        // Fused bias-add + ReLU
+        void forwardFused(T* values, const T* bias, size_t count) const override {
+            for (size_t j = 0; j < count; ++j) {
+                values[j] = std::max(static_cast<T>(0), values[j] + bias[j]);
+            }
+        }
+
+        // Fused error * ReLU derivative
+        void backwardFused(const T* error, const T* output, T* delta, size_t count) const override {
+            for (size_t j = 0; j < count; ++j) {
+                delta[j] = error[j] * (output[j] > 0 ? static_cast<T>(1) : static_cast<T>(0));
+            }
+        }
     };
 
     // Sigmoid activation function
@@ -55,30 +131,177 @@ namespace Activation {
     template<typename T>
     class Sigmoid : public ActivationFunction<T> {
     public:
+        const char* name() const override { return "sigmoid"; }
+
         // Forward pass: compute sigmoid value
         // Maps any input to range (0,1)
         Matrix<T> forward(const Matrix<T>& x) const override {
             Matrix<T> result(x.getRows(), x.getCols());
-            for (size_t i = 0; i < x.getRows(); ++i) {
-                for (size_t j = 0; j < x.getCols(); ++j) {
-                    result.at(i, j) = 1.0 / (1.0 + std::exp(-x.at(i, j)));
+            const T* in = x.data();
+            T* out = result.data();
+            Parallel::parallelFor(0, x.size(), Parallel::ELEMENTWISE_GRAIN, [&](size_t lo, size_t hi) {
+                VectorMath::sigmoid(in + lo, out + lo, hi - lo);
+            });
+            return result;
+        }
+
+        // Backward pass: derivative of sigmoid from the forward output
+        // f'(x) = y * (1 - y) with y = f(x), so no exp is needed
+        Matrix<T> backward(const Matrix<T>& y) const override {
+            Matrix<T> result(y.getRows(), y.getCols());
+            const T* in = y.data();
+            T* out = result.data();
+            Parallel::parallelFor(0, y.size(), Parallel::ELEMENTWISE_GRAIN, [&](size_t lo, size_t hi) {
+                for (size_t i = lo; i < hi; ++i) {
+                    out[i] = in[i] * (1 - in[i]);
                 }
-            }
+            });
             return result;
         }
 
-        // Backward pass: derivative of sigmoid
-        // f'(x) = f(x) * (1 - f(x))
-        Matrix<T> backward(const Matrix<T>& x) const override {
-            Matrix<T> sig = forward(x);  // Compute sigmoid values
+        bool hasFusedKernels() const override { return true; }
+
+        // Fused bias-add + sigmoid
+        void forwardFused(T* values, const T* bias, size_t count) const override {
+            for (size_t j = 0; j < count; ++j) values[j] += bias[j];
+            VectorMath::sigmoid(values, values, count);
+        }
+
+        // Fused error * sigmoid derivative, same formula as backward()
+        void backwardFused(const T* error, const T* output, T* delta, size_t count) const override {
+            for (size_t j = 0; j < count; ++j) {
+                delta[j] = error[j] * (output[j] * (1 - output[j]));
+            }
+        }
+    };
+
+    // Hyperbolic tangent activation
+    // f(x) = (e^x - e^(-x)) / (e^x + e^(-x))
+    // Zero-centred alternative to sigmoid for hidden layers
+    template<typename T>
+    class Tanh : public ActivationFunction<T> {
+    public:
+        const char* name() const override { return "tanh"; }
+
+        // Forward pass: maps any input to range (-1,1)
+        Matrix<T> forward(const Matrix<T>& x) const override {
             Matrix<T> result(x.getRows(), x.getCols());
-            for (size_t i = 0; i < x.getRows(); ++i) {
-                for (size_t j = 0; j < x.getCols(); ++j) {
-                    T s = sig.at(i, j);
-                    result.at(i, j) = s * (1 - s);  // Derivative formula
+            const T* in = x.data();
+            T* out = result.data();
+            Parallel::parallelFor(0, x.size(), Parallel::ELEMENTWISE_GRAIN, [&](size_t lo, size_t hi) {
+                VectorMath::tanh(in + lo, out + lo, hi - lo);
+            });
+            return result;
+        }
+
+        // Backward pass: derivative of tanh from the forward output
+        // f'(x) = 1 - y^2 with y = f(x)
+        Matrix<T> backward(const Matrix<T>& y) const override {
+            Matrix<T> result(y.getRows(), y.getCols());
+            const T* in = y.data();
+            T* out = result.data();
+            Parallel::parallelFor(0, y.size(), Parallel::ELEMENTWISE_GRAIN, [&](size_t lo, size_t hi) {
+                for (size_t i = lo; i < hi; ++i) {
+                    out[i] = 1 - in[i] * in[i];
                 }
+            });
+            return result;
+        }
+
+        bool hasFusedKernels() const override { return true; }
+
+        // Fused bias-add + tanh
+        void forwardFused(T* values, const T* bias, size_t count) const override {
+            for (size_t j = 0; j < count; ++j) values[j] += bias[j];
+            VectorMath::tanh(values, values, count);
+        }
+
+        // Fused error * tanh derivative
+        void backwardFused(const T* error, const T* output, T* delta, size_t count) const override {
+            for (size_t j = 0; j < count; ++j) {
+                delta[j] = error[j] * (1 - output[j] * output[j]);
             }
+        }
+    };
+
+    // Softmax over each row: f(x)_j = e^(x_j - max) / Σ_k e^(x_k - max)
+    // Turns a row of scores into a probability distribution for multi-class outputs
+    // Its Jacobian is not diagonal, so it has no fused kernels: backwardInto() applies the
+    // Jacobian row by row, and Loss::CrossEntropy differentiates through it in closed form
+    template<typename T>
+    class Softmax : public ActivationFunction<T> {
+    public:
+        using ActivationFunction<T>::backwardInto;
+
+        const char* name() const override { return "softmax"; }
+
+        Matrix<T> forward(const Matrix<T>& x) const override {
+            Matrix<T> result(x.getRows(), x.getCols());
+            const size_t cols = x.getCols();
+            const size_t grain = std::max<size_t>(1, Parallel::ELEMENTWISE_GRAIN / std::max<size_t>(1, cols));
+            Parallel::parallelFor(0, x.getRows(), grain, [&](size_t lo, size_t hi) {
+                for (size_t i = lo; i < hi; ++i) softmaxRow(x.data() + i * cols, result.data() + i * cols, cols);
+            });
             return result;
         }
+
+        // Diagonal of the Jacobian only, y * (1 - y); backwardInto() is the full product
+        Matrix<T> backward(const Matrix<T>& y) const override {
+            Matrix<T> result(y.getRows(), y.getCols());
+            const T* in = y.data();
+            T* out = result.data();
+            Parallel::parallelFor(0, y.size(), Parallel::ELEMENTWISE_GRAIN, [&](size_t lo, size_t hi) {
+                for (size_t i = lo; i < hi; ++i) {
+                    out[i] = in[i] * (1 - in[i]);
+                }
+            });
+            return result;
+        }
+
+        // Jacobian-vector product per row: delta_j = y_j * (error_j - Σ_k error_k y_k)
+        void backwardInto(MatrixView<const T> error, MatrixView<const T> output, MatrixView<T> delta) const override {
+            const size_t cols = output.getCols();
+            const size_t grain = std::max<size_t>(1, Parallel::ELEMENTWISE_GRAIN / std::max<size_t>(1, cols));
+            Parallel::parallelFor(0, output.getRows(), grain, [&](size_t lo, size_t hi) {
+                for (size_t i = lo; i < hi; ++i) {
+                    const T* err = error.row(i).data();
+                    const T* y = output.row(i).data();
+                    T* d = delta.row(i).data();
+                    T dot = 0;
+                    for (size_t j = 0; j < cols; ++j) dot += err[j] * y[j];
+                    for (size_t j = 0; j < cols; ++j) d[j] = y[j] * (err[j] - dot);
+                }
+            });
+        }
+
+        // Bias-add + softmax over one whole row (Layer never calls this, as there are no fused
+        // kernels, but row-at-a-time callers such as quantized inference do)
+        void forwardFused(T* values, const T* bias, size_t count) const override {
+            for (size_t j = 0; j < count; ++j) values[j] += bias[j];
+            softmaxRow(values, values, count);
+        }
+
+    private:
+        // in and out may alias
+        static void softmaxRow(const T* in, T* out, size_t count) {
+            if (count == 0) return;
+            const T top = *std::max_element(in, in + count);
+            for (size_t j = 0; j < count; ++j) out[j] = in[j] - top;
+            VectorMath::exp(out, out, count);
+            T sum = 0;
+            for (size_t j = 0; j < count; ++j) sum += out[j];
+            const T inverse = T(1) / sum;
+            for (size_t j = 0; j < count; ++j) out[j] *= inverse;
+        }
     };
+
+    // Activation for a name() value
+    template<typename T>
+    std::shared_ptr<ActivationFunction<T>> create(const std::string& name) {
+        if (name == "relu") return std::make_shared<ReLU<T>>();
+        if (name == "sigmoid") return std::make_shared<Sigmoid<T>>();
+        if (name == "tanh") return std::make_shared<Tanh<T>>();
+        if (name == "softmax") return std::make_shared<Softmax<T>>();
+        throw std::invalid_argument("Unknown activation '" + name + "'");
+    }
 }
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+#include "matrix.hpp"
+#include "memory.hpp"
+
+// ParameterArena class: One flat buffer holding a sequence of dense tensors
+// Every tensor starts on a cache-line boundary; the padding between tensors is zero and
+// stays zero, so kernels may stream over the whole buffer (data(), size()) instead of
+// visiting tensors one by one. A network keeps all its parameters in one arena and the
+// gradients of each shard in another with the same layout, which turns gradient reduction
+// and optimizer steps into single passes over flat memory.
+template<typename T>
+class ParameterArena {
+public:
+    struct Shape {
+        size_t rows;
+        size_t cols;
+    };
+
+private:
+    std::vector<T, Memory::AlignedAllocator<T>> storage;
+    std::vector<Shape> shapes;
+    std::vector<size_t> offsets;      // First element of each tensor
+
+public:
+    // Elements per cache line: the granularity tensors are aligned to
+    static constexpr size_t ALIGN_ELEMENTS = Memory::CACHE_LINE / sizeof(T) > 0 ? Memory::CACHE_LINE / sizeof(T) : 1;
+
+    ParameterArena() = default;
+
+    // Allocate zero-initialized tensors of the given shapes, in order
+    explicit ParameterArena(const std::vector<Shape>& layout) : shapes(layout) {
+        size_t total = 0;
+        for (const Shape& shape : shapes) {
+            offsets.push_back(total);
+            total += (shape.rows * shape.cols + ALIGN_ELEMENTS - 1) / ALIGN_ELEMENTS * ALIGN_ELEMENTS;
+        }
+        storage.assign(total, T(0));
+    }
+
+    // Tensor i as a contiguous [rows x cols] view
+    MatrixView<T> tensor(size_t i) {
+        checkIndex(i);
+        return MatrixView<T>(storage.data() + offsets[i], shapes[i].rows, shapes[i].cols, shapes[i].cols);
+    }
+
+    MatrixView<const T> tensor(size_t i) const {
+        checkIndex(i);
+        return MatrixView<const T>(storage.data() + offsets[i], shapes[i].rows, shapes[i].cols, shapes[i].cols);
+    }
+
+    // True when both arenas hold tensors of the same shapes in the same order
+    bool sameLayout(const ParameterArena& other) const {
+        if (tensorCount() != other.tensorCount()) return false;
+        for (size_t i = 0; i < tensorCount(); ++i) {
+            if (shape(i).rows != other.shape(i).rows || shape(i).cols != other.shape(i).cols) return false;
+        }
+        return true;
+    }
+
+    const Shape& shape(size_t i) const { return shapes.at(i); }
+    size_t tensorCount() const { return shapes.size(); }
+
+    // The whole buffer, padding included
+    T* data() { return storage.data(); }
+    const T* data() const { return storage.data(); }
+    size_t size() const { return storage.size(); }
+
+private:
+    void checkIndex(size_t i) const {
+        if (i >= shapes.size()) {
+            throw std::out_of_range("Arena tensor index out of range");
+        }
+    }
+};
@@ -0,0 +1,191 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "neural_network.hpp"
+
+namespace Serving {
+    // Dynamic request batcher for a trained network
+    // Callers submit single input rows and get a future for the output row. A dispatcher
+    // thread coalesces pending rows into one batch and runs a single NeuralNetwork::infer
+    // on it, so the GEMMs see a matrix instead of a series of matrix-vector products.
+    //
+    // Knobs:
+    //   max_batch  rows per forward pass; larger batches raise throughput
+    //   max_wait   how long the oldest pending request may wait for the batch to fill;
+    //              0 dispatches as soon as the previous batch is done, so batches then
+    //              only form from requests that arrived while the network was busy
+    //
+    // The network must not be trained while the batcher serves it.
+    template<typename T>
+    class RequestBatcher {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // Counters since construction
+        struct Stats {
+            size_t requests = 0;
+            size_t batches = 0;    // Forward passes run
+            size_t max_rows = 0;   // Largest batch seen
+        };
+
+    private:
+        // Requests not yet dispatched: their rows are appended to one row-major buffer
+        // (a vector, so earlier rows survive growth), read by infer() as a matrix view
+        struct Pending {
+            std::vector<T> input;
+            std::vector<std::promise<Matrix<T>>> results;
+        };
+
+        std::shared_ptr<const NeuralNetwork<T>> network;
+        size_t input_size;
+        size_t output_size;
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        Pending pending;
+        Clock::time_point oldest;          // Arrival of the oldest pending request
+        size_t max_batch;
+        std::chrono::microseconds max_wait;
+        Stats stats;
+        bool stopping = false;
+        std::thread dispatcher;
+
+        void dispatchLoop() {
+            Pending running;
+            Matrix<T> output(0, 0);
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                wake.wait(lock, [this] { return stopping || !pending.results.empty(); });
+                if (pending.results.empty()) return;  // Stopping with nothing left to serve
+
+                // Give the batch until the oldest request's deadline to fill up
+                // (checked first: even an expired timed wait costs the kernel's timer slack)
+                const Clock::time_point deadline = oldest + max_wait;
+                if (pending.results.size() < max_batch && Clock::now() < deadline) {
+                    wake.wait_until(lock, deadline, [this] {
+                        return stopping || pending.results.size() >= max_batch;
+                    });
+                }
+                std::swap(running, pending);
+                pending.input.clear();
+                pending.results.clear();
+                const size_t batch = max_batch;
+                lock.unlock();
+
+                // A backlog larger than max_batch runs as several forward passes
+                const size_t rows = running.results.size();
+                size_t passes = 0;
+                for (size_t lo = 0; lo < rows; lo += batch, ++passes) {
+                    const size_t count = std::min(batch, rows - lo);
+                    run(running, lo, count, output);
+                }
+
+                lock.lock();
+                stats.requests += rows;
+                stats.batches += passes;
+                stats.max_rows = std::max(stats.max_rows, std::min(batch, rows));
+            }
+        }
+
+        // Forward pass over rows [lo, lo + count) of running, then fulfil their futures
+        void run(Pending& running, size_t lo, size_t count, Matrix<T>& output) {
+            try {
+                output.resize(count, output_size);
+                const MatrixView<const T> input(running.input.data() + lo * input_size, count, input_size, input_size);
+                network->infer(input, output.view());
+            } catch (...) {
+                for (size_t i = lo; i < lo + count; ++i) running.results[i].set_exception(std::current_exception());
+                return;
+            }
+            for (size_t i = 0; i < count; ++i) {
+                Matrix<T> row(1, output_size);
+                std::copy(output.row(i).data(), output.row(i).data() + output_size, row.data());
+                running.results[lo + i].set_value(std::move(row));
+            }
+        }
+
+    public:
+        RequestBatcher(std::shared_ptr<const NeuralNetwork<T>> network, size_t max_batch = 32,
+                       std::chrono::microseconds max_wait = std::chrono::microseconds(200))
+            : network(std::move(network)) {
+            if (!this->network || this->network->getLayers().empty()) {
+                throw std::invalid_argument("RequestBatcher needs a network with layers");
+            }
+            input_size = this->network->inputSize();
+            output_size = this->network->outputSize();
+            setMaxBatch(max_batch);
+            setMaxWait(max_wait);
+            pending.input.reserve(this->max_batch * input_size);
+            dispatcher = std::thread([this] { dispatchLoop(); });
+        }
+
+        // Serves every request already submitted, then stops the dispatcher
+        ~RequestBatcher() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            dispatcher.join();
+        }
+
+        RequestBatcher(const RequestBatcher&) = delete;
+        RequestBatcher& operator=(const RequestBatcher&) = delete;
+
+        // Queue one input row (1 x input size, any stride); the future yields the 1 x output
+        // size result
+        std::future<Matrix<T>> submit(MatrixView<const T> row) {
+            if (row.getRows() != 1 || row.getCols() != input_size) {
+                throw std::invalid_argument("Request must be a single row of the network input size");
+            }
+            std::future<Matrix<T>> result;
+            bool notify;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                const size_t index = pending.results.size();
+                if (index == 0) oldest = Clock::now();
+                for (size_t j = 0; j < input_size; ++j) pending.input.push_back(row.at(0, j));
+                pending.results.emplace_back();
+                result = pending.results.back().get_future();
+                // Wake the dispatcher to start the deadline, or because the batch is full
+                notify = index == 0 || index + 1 >= max_batch;
+            }
+            if (notify) wake.notify_one();
+            return result;
+        }
+
+        // Knobs may change while serving; they apply from the next batch on
+        void setMaxBatch(size_t rows) {
+            std::lock_guard<std::mutex> lock(mutex);
+            max_batch = std::max<size_t>(rows, 1);
+        }
+
+        void setMaxWait(std::chrono::microseconds wait) {
+            std::lock_guard<std::mutex> lock(mutex);
+            max_wait = std::max(wait, std::chrono::microseconds(0));
+        }
+
+        size_t getMaxBatch() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return max_batch;
+        }
+
+        std::chrono::microseconds getMaxWait() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return max_wait;
+        }
+
+        Stats getStats() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return stats;
+        }
+    };
+}
@@ -0,0 +1,274 @@
+#pragma once
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "memory.hpp"
+#include "neural_network.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define NN_CHECKPOINT_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define NN_CHECKPOINT_MMAP 0
+#endif
+
+// Binary checkpoints of trained networks
+//
+// Layout (version 1, all integers little-endian):
+//   Header        64 bytes: magic, version, byte-order mark, dtype, storage format,
+//                 loss name, layer count, file size
+//   LayerRecord   64 bytes per layer: input/output size, activation name and the file
+//                 offsets of the layer's weights and bias
+//   Blobs         weights [inputs x outputs] row-major, then bias [outputs], as raw T;
+//                 every blob starts on a 64-byte boundary
+//
+// load() maps the file read-only and the layers' weight views point straight into the
+// mapping: nothing is parsed beyond the headers and nothing is copied, and processes that
+// load the same file share its pages. Training a loaded network copies the parameters
+// into its parameter arena on the first train() step.
+namespace Checkpoint {
+    constexpr uint32_t VERSION = 1;
+    constexpr size_t BLOB_ALIGN = Memory::CACHE_LINE;
+
+    namespace detail {
+        constexpr char MAGIC[8] = {'N', 'N', 'C', 'K', 'P', 'T', '\0', '\0'};
+        constexpr uint32_t ENDIAN_MARK = 0x01020304;
+        constexpr size_t NAME_SIZE = 16;
+
+        struct Header {
+            char magic[8];
+            uint32_t version;
+            uint32_t byte_order;      // ENDIAN_MARK as written by the saving machine
+            uint32_t dtype_size;      // sizeof(T): 4 for float, 8 for double
+            uint32_t storage_format;  // Precision::Format of the network
+            char loss[NAME_SIZE];
+            uint64_t layer_count;
+            uint64_t file_size;
+            uint8_t reserved[8];
+        };
+        static_assert(sizeof(Header) == 64, "Checkpoint header must stay 64 bytes");
+
+        struct LayerRecord {
+            uint64_t inputs;
+            uint64_t outputs;
+            char activation[NAME_SIZE];
+            uint64_t weights_offset;
+            uint64_t bias_offset;
+            uint8_t reserved[16];
+        };
+        static_assert(sizeof(LayerRecord) == 64, "Checkpoint layer record must stay 64 bytes");
+
+        inline size_t alignUp(size_t offset) { return (offset + BLOB_ALIGN - 1) / BLOB_ALIGN * BLOB_ALIGN; }
+
+        inline void copyName(char (&out)[NAME_SIZE], const char* name, const char* what) {
+            if (!name || std::strlen(name) >= NAME_SIZE) {
+                throw std::invalid_argument(std::string("Cannot save ") + what + " without a checkpoint name");
+            }
+            std::memset(out, 0, NAME_SIZE);
+            std::memcpy(out, name, std::strlen(name));
+        }
+
+        inline std::string readName(const char (&name)[NAME_SIZE]) {
+            return std::string(name, strnlen(name, NAME_SIZE));
+        }
+
+        template<typename T>
+        void checkType() {
+            static_assert(std::is_same<T, float>::value || std::is_same<T, double>::value,
+                          "Checkpoints store float or double networks");
+        }
+    }
+
+    // Read-only view of a whole file: memory-mapped where the OS supports it, otherwise
+    // read into an aligned buffer
+    class MappedFile {
+    private:
+        const unsigned char* bytes = nullptr;
+        size_t length = 0;
+        std::vector<unsigned char, Memory::AlignedAllocator<unsigned char>> buffer;  // Fallback only
+
+    public:
+        explicit MappedFile(const std::string& path) {
+#if NN_CHECKPOINT_MMAP
+            const int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                throw std::runtime_error("Cannot open " + path + ": " + std::strerror(errno));
+            }
+            struct stat info;
+            if (::fstat(fd, &info) != 0) {
+                const int error = errno;
+                ::close(fd);
+                throw std::runtime_error("Cannot stat " + path + ": " + std::strerror(error));
+            }
+            length = static_cast<size_t>(info.st_size);
+            if (length > 0) {
+                void* mapped = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+                if (mapped == MAP_FAILED) {
+                    const int error = errno;
+                    ::close(fd);
+                    throw std::runtime_error("Cannot map " + path + ": " + std::strerror(error));
+                }
+                bytes = static_cast<const unsigned char*>(mapped);
+            }
+            ::close(fd);  // The mapping stays valid without the descriptor
+#else
+            std::ifstream in(path, std::ios::binary | std::ios::ate);
+            if (!in) throw std::runtime_error("Cannot open " + path);
+            length = static_cast<size_t>(in.tellg());
+            buffer.resize(length);
+            in.seekg(0);
+            in.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(length));
+            if (!in) throw std::runtime_error("Cannot read " + path);
+            bytes = buffer.data();
+#endif
+        }
+
+        ~MappedFile() {
+#if NN_CHECKPOINT_MMAP
+            if (bytes) ::munmap(const_cast<unsigned char*>(bytes), length);
+#endif
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const unsigned char* data() const { return bytes; }
+        size_t size() const { return length; }
+    };
+
+    // Write network to path (float or double; every activation and the loss need a name())
+    template<typename T>
+    void save(const NeuralNetwork<T>& network, const std::string& path) {
+        detail::checkType<T>();
+        if (!network.isSequential()) {
+            throw std::invalid_argument("Checkpoints describe sequential networks only");
+        }
+        const auto& layers = network.getLayers();
+
+        detail::Header header{};
+        std::memcpy(header.magic, detail::MAGIC, sizeof(header.magic));
+        header.version = VERSION;
+        header.byte_order = detail::ENDIAN_MARK;
+        header.dtype_size = sizeof(T);
+        header.storage_format = static_cast<uint32_t>(network.getStorageFormat());
+        detail::copyName(header.loss, network.getLossFunction()->name(), "a loss function");
+        header.layer_count = layers.size();
+
+        // Lay out the blobs after the header and layer table
+        std::vector<detail::LayerRecord> records(layers.size());
+        size_t offset = detail::alignUp(sizeof(detail::Header) + layers.size() * sizeof(detail::LayerRecord));
+        for (size_t l = 0; l < layers.size(); ++l) {
+            const MatrixView<const T> weights = layers[l]->getWeights();
+            detail::LayerRecord& record = records[l];
+            record = detail::LayerRecord{};
+            record.inputs = weights.getRows();
+            record.outputs = weights.getCols();
+            detail::copyName(record.activation, layers[l]->getActivation()->name(), "an activation");
+            record.weights_offset = offset;
+            offset = detail::alignUp(offset + weights.getRows() * weights.getCols() * sizeof(T));
+            record.bias_offset = offset;
+            offset = detail::alignUp(offset + weights.getCols() * sizeof(T));
+        }
+        header.file_size = offset;
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("Cannot create " + path);
+        size_t written = 0;
+        auto write = [&](const void* data, size_t bytes) {
+            out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+            written += bytes;
+        };
+        auto padTo = [&](size_t target) {
+            static const char zeros[BLOB_ALIGN] = {};
+            while (written < target) write(zeros, std::min(BLOB_ALIGN, target - written));
+        };
+
+        write(&header, sizeof(header));
+        write(records.data(), records.size() * sizeof(detail::LayerRecord));
+        for (size_t l = 0; l < layers.size(); ++l) {
+            padTo(records[l].weights_offset);
+            const MatrixView<const T> weights = layers[l]->getWeights();
+            for (size_t i = 0; i < weights.getRows(); ++i) write(weights.row(i).data(), weights.getCols() * sizeof(T));
+            padTo(records[l].bias_offset);
+            write(layers[l]->getBias().data(), records[l].outputs * sizeof(T));
+        }
+        padTo(header.file_size);
+        out.flush();
+        if (!out) throw std::runtime_error("Cannot write " + path);
+    }
+
+    // Map a checkpoint written by save() and rebuild the network around it
+    // The returned network's weights are views into the mapping, which stays alive as long
+    // as any of its layers does
+    template<typename T>
+    std::shared_ptr<NeuralNetwork<T>> load(const std::string& path) {
+        detail::checkType<T>();
+        auto file = std::make_shared<const MappedFile>(path);
+        const unsigned char* base = file->data();
+
+        if (file->size() < sizeof(detail::Header)) {
+            throw std::invalid_argument(path + " is too small to be a checkpoint");
+        }
+        detail::Header header;
+        std::memcpy(&header, base, sizeof(header));
+        if (std::memcmp(header.magic, detail::MAGIC, sizeof(header.magic)) != 0) {
+            throw std::invalid_argument(path + " is not a checkpoint");
+        }
+        if (header.version != VERSION) {
+            throw std::invalid_argument(path + " has unsupported checkpoint version " + std::to_string(header.version));
+        }
+        if (header.byte_order != detail::ENDIAN_MARK) {
+            throw std::invalid_argument(path + " was written on a machine with a different byte order");
+        }
+        if (header.dtype_size != sizeof(T)) {
+            throw std::invalid_argument(path + " stores " + std::to_string(header.dtype_size * 8) +
+                                        "-bit values, expected " + std::to_string(sizeof(T) * 8));
+        }
+        if (header.file_size != file->size() ||
+            header.layer_count > (file->size() - sizeof(header)) / sizeof(detail::LayerRecord)) {
+            throw std::invalid_argument(path + " is truncated or corrupt");
+        }
+        if (header.storage_format > static_cast<uint32_t>(Precision::Format::Float16)) {
+            throw std::invalid_argument(path + " has an unknown storage format");
+        }
+
+        auto network = std::make_shared<NeuralNetwork<T>>(Loss::create<T>(detail::readName(header.loss)));
+        const unsigned char* table = base + sizeof(header);
+        size_t previous_outputs = 0;
+        for (size_t l = 0; l < header.layer_count; ++l) {
+            detail::LayerRecord record;
+            std::memcpy(&record, table + l * sizeof(record), sizeof(record));
+            const uint64_t weight_bytes = record.inputs * record.outputs * sizeof(T);
+            const bool in_bounds = record.inputs > 0 && record.outputs > 0 &&
+                                   weight_bytes / sizeof(T) / record.inputs == record.outputs &&
+                                   record.weights_offset % BLOB_ALIGN == 0 && record.bias_offset % BLOB_ALIGN == 0 &&
+                                   record.weights_offset <= file->size() &&
+                                   weight_bytes <= file->size() - record.weights_offset &&
+                                   record.bias_offset <= file->size() &&
+                                   record.outputs * sizeof(T) <= file->size() - record.bias_offset;
+            if (!in_bounds) throw std::invalid_argument(path + ": layer " + std::to_string(l) + " is corrupt");
+            if (l > 0 && record.inputs != previous_outputs) {
+                throw std::invalid_argument(path + ": layer " + std::to_string(l) + " does not match the previous layer");
+            }
+            previous_outputs = record.outputs;
+
+            const T* weights = reinterpret_cast<const T*>(base + record.weights_offset);
+            const T* bias = reinterpret_cast<const T*>(base + record.bias_offset);
+            network->addLayer(std::make_shared<Layer<T>>(
+                MatrixView<const T>(weights, record.inputs, record.outputs, record.outputs),
+                MatrixView<const T>(bias, 1, record.outputs, record.outputs),
+                Activation::create<T>(detail::readName(record.activation)), file));
+        }
+        network->setStorageFormat(static_cast<Precision::Format>(header.storage_format));
+        return network;
+    }
+}
@@ -0,0 +1,432 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "matrix.hpp"
+#include "random.hpp"
+#include "thread_pool.hpp"
+
+// Streaming datasets for data that does not fit in memory
+//
+// A Source yields fixed-size records (input values followed by expected values) in file
+// order. A Stream turns a source into shuffled mini-batches: records pass through a bounded
+// shuffle buffer, so memory stays at buffer size x record size however large the source
+// is, and a background thread decodes the next batch while the caller trains on the
+// current one.
+namespace Data {
+    // Sequential reader of fixed-size records
+    template<typename T>
+    class Source {
+    public:
+        virtual ~Source() = default;
+
+        virtual size_t inputSize() const = 0;
+        virtual size_t outputSize() const = 0;
+        size_t recordSize() const { return inputSize() + outputSize(); }
+
+        // Read up to count records into records ([count x recordSize()], row-major)
+        // Returns the number of records read; 0 once the data is exhausted
+        virtual size_t read(T* records, size_t count) = 0;
+
+        // Start over from the first record
+        virtual void rewind() = 0;
+    };
+
+    // Raw T records back to back, as written by writeBinary()
+    template<typename T>
+    class BinarySource : public Source<T> {
+    private:
+        std::string path;
+        size_t input_size;
+        size_t output_size;
+        std::ifstream in;
+
+    public:
+        BinarySource(std::string file, size_t input_size, size_t output_size)
+            : path(std::move(file)), input_size(input_size), output_size(output_size),
+              in(path, std::ios::binary | std::ios::ate) {
+            if (!in) throw std::runtime_error("Cannot open " + path);
+            if (input_size + output_size == 0) throw std::invalid_argument("Records must not be empty");
+            const auto bytes = static_cast<size_t>(in.tellg());
+            if (bytes % (this->recordSize() * sizeof(T)) != 0) {
+                throw std::invalid_argument(path + " is not a whole number of records");
+            }
+            in.seekg(0);
+        }
+
+        size_t inputSize() const override { return input_size; }
+        size_t outputSize() const override { return output_size; }
+
+        size_t read(T* records, size_t count) override {
+            const size_t record_bytes = this->recordSize() * sizeof(T);
+            in.read(reinterpret_cast<char*>(records), static_cast<std::streamsize>(count * record_bytes));
+            return static_cast<size_t>(in.gcount()) / record_bytes;
+        }
+
+        void rewind() override {
+            in.clear();
+            in.seekg(0);
+        }
+    };
+
+    // Text records, one per line: input values then expected values, comma-separated
+    template<typename T>
+    class CsvSource : public Source<T> {
+    private:
+        std::string path;
+        size_t input_size;
+        size_t output_size;
+        bool has_header;
+        std::ifstream in;
+        std::string line;
+        size_t line_number = 0;
+
+        void skipHeader() {
+            if (has_header && std::getline(in, line)) ++line_number;
+        }
+
+    public:
+        CsvSource(std::string file, size_t input_size, size_t output_size, bool has_header = false)
+            : path(std::move(file)), input_size(input_size), output_size(output_size),
+              has_header(has_header), in(path) {
+            if (!in) throw std::runtime_error("Cannot open " + path);
+            if (input_size + output_size == 0) throw std::invalid_argument("Records must not be empty");
+            skipHeader();
+        }
+
+        size_t inputSize() const override { return input_size; }
+        size_t outputSize() const override { return output_size; }
+
+        size_t read(T* records, size_t count) override {
+            const size_t fields = this->recordSize();
+            size_t done = 0;
+            while (done < count && std::getline(in, line)) {
+                ++line_number;
+                if (line.empty() || line == "\r") continue;
+                const char* cursor = line.c_str();
+                T* record = records + done * fields;
+                for (size_t f = 0; f < fields; ++f) {
+                    char* end;
+                    const double value = std::strtod(cursor, &end);
+                    const bool separated = f + 1 < fields ? *end == ',' : (*end == '\0' || *end == '\r');
+                    if (end == cursor || !separated) {
+                        throw std::invalid_argument(path + ":" + std::to_string(line_number) + ": expected " +
+                                                    std::to_string(fields) + " comma-separated numbers");
+                    }
+                    record[f] = static_cast<T>(value);
+                    cursor = end + 1;
+                }
+                ++done;
+            }
+            return done;
+        }
+
+        void rewind() override {
+            in.clear();
+            in.seekg(0);
+            line_number = 0;
+            skipHeader();
+        }
+    };
+
+    // Synthetic XOR samples: two binary operands and their XOR
+    // Sample i takes its operands from word i of a Philox stream under `seed`, so the same
+    // seed replays the same samples and every pass sees the same data, however many
+    // threads generate them
+    template<typename T>
+    class XorSource : public Source<T> {
+    private:
+        size_t samples;
+        size_t produced = 0;
+        Random::Generator generator;
+
+    public:
+        explicit XorSource(size_t samples, uint64_t seed = Random::nextSeed())
+            : samples(samples), generator(seed) {}
+
+        size_t inputSize() const override { return 2; }
+        size_t outputSize() const override { return 1; }
+
+        size_t read(T* records, size_t count) override {
+            const size_t n = std::min(count, samples - produced);
+            Parallel::parallelFor(0, n, Parallel::ELEMENTWISE_GRAIN, [&](size_t lo, size_t hi) {
+                for (size_t i = lo; i < hi; ++i) {
+                    const uint32_t bits = generator.word(produced + i);
+                    const bool a = bits & 1u;         // First operand
+                    const bool b = (bits >> 1) & 1u;  // Second operand
+                    records[i * 3 + 0] = a;
+                    records[i * 3 + 1] = b;
+                    records[i * 3 + 2] = a != b;  // XOR operation
+                }
+            });
+            produced += n;
+            return n;
+        }
+
+        void rewind() override { produced = 0; }
+    };
+
+    // Read a whole source into memory as (inputs, expected outputs)
+    template<typename T>
+    std::pair<Matrix<T>, Matrix<T>> readAll(Source<T>& source) {
+        const size_t chunk = 4096;
+        const size_t fields = source.recordSize();
+        std::vector<T> records;
+        size_t count = 0;
+        while (true) {
+            records.resize((count + chunk) * fields);
+            const size_t n = source.read(records.data() + count * fields, chunk);
+            count += n;
+            if (n == 0) break;
+        }
+
+        Matrix<T> inputs(count, source.inputSize());
+        Matrix<T> outputs(count, source.outputSize());
+        for (size_t i = 0; i < count; ++i) {
+            const T* record = records.data() + i * fields;
+            std::copy(record, record + source.inputSize(), inputs.row(i).data());
+            std::copy(record + source.inputSize(), record + fields, outputs.row(i).data());
+        }
+        return {std::move(inputs), std::move(outputs)};
+    }
+
+    // Write inputs and expected outputs as a BinarySource file
+    template<typename T>
+    void writeBinary(const std::string& path, MatrixView<const T> inputs, MatrixView<const T> expected) {
+        if (inputs.getRows() != expected.getRows()) {
+            throw std::invalid_argument("Inputs and expected outputs have different row counts");
+        }
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("Cannot create " + path);
+        for (size_t i = 0; i < inputs.getRows(); ++i) {
+            for (size_t j = 0; j < inputs.getCols(); ++j) out.write(reinterpret_cast<const char*>(&inputs.at(i, j)), sizeof(T));
+            for (size_t j = 0; j < expected.getCols(); ++j) out.write(reinterpret_cast<const char*>(&expected.at(i, j)), sizeof(T));
+        }
+        if (!out) throw std::runtime_error("Cannot write " + path);
+    }
+
+    // One mini-batch: input rows and the matching expected rows
+    template<typename T>
+    struct Batch {
+        Matrix<T> input{0, 0};
+        Matrix<T> expected{0, 0};
+    };
+
+    // Shuffled mini-batches from a source, decoded ahead of time on a background thread
+    //
+    // Records enter a shuffle buffer of shuffle_records and leave it from random positions:
+    // a buffer as large as the dataset gives a full shuffle, 1 keeps file order. The
+    // source is read in chunks as the buffer drains, keeping it at least 7/8 full until
+    // the source ends.
+    //
+    // With prefetch on, a decoder thread fills the next batch while the caller works on the
+    // current one; the two batch buffers (plus the one being filled) are swapped, not
+    // copied, so a pass performs no heap allocation once they are sized. With prefetch off,
+    // next() decodes on the calling thread.
+    //
+    // The shuffle order follows `seed`, by default the next one of the global sequence
+    // (Random::nextSeed), and picks are drawn with Random::Generator::below, so runs under
+    // the same NN_SEED shuffle alike on every platform and standard library.
+    //
+    // next() and rewind() must be called from one consumer thread.
+    template<typename T>
+    class Stream {
+    private:
+        static constexpr size_t CHUNK_RECORDS = 1024;  // Largest single read from the source
+
+        std::unique_ptr<Source<T>> source;
+        size_t batch_size;
+        Random::Generator rng;  // Shuffle picks
+
+        // Shuffle buffer; touched only by the decoding thread
+        std::vector<T> pool;
+        size_t pool_capacity;   // In records
+        size_t pool_count = 0;
+        bool source_done = false;
+
+        Batch<T> current;       // Handed out by next()
+
+        // Prefetch state, guarded by mutex
+        bool prefetch;
+        std::mutex mutex;
+        std::condition_variable wake;
+        Batch<T> ready;
+        bool has_ready = false;
+        bool finished = false;  // The pass is over (or failed) and ready has been taken
+        bool stopping = false;
+        size_t generation = 0;  // Bumped by rewind(); batches of older passes are dropped
+        std::exception_ptr error;
+        std::thread decoder;
+
+        // Start the source and the shuffle buffer over
+        void restart() {
+            source->rewind();
+            pool_count = 0;
+            source_done = false;
+        }
+
+        // Top the shuffle buffer up once an eighth of it (at most a chunk) is free, so the
+        // window rolls over the source instead of draining in separate blocks; a buffer of
+        // one record refills only when empty
+        void refill() {
+            const size_t free = pool_capacity - pool_count;
+            const size_t threshold = std::min(CHUNK_RECORDS, std::max<size_t>(1, pool_capacity / 8));
+            if (source_done || free < threshold) return;
+            const size_t fields = source->recordSize();
+            const size_t want = std::min(free, CHUNK_RECORDS);
+            const size_t got = source->read(pool.data() + pool_count * fields, want);
+            pool_count += got;
+            if (got < want) source_done = true;
+        }
+
+        // Decode the next batch of the pass into batch; false once the pass is over
+        bool fill(Batch<T>& batch) {
+            const size_t inputs = source->inputSize();
+            const size_t fields = source->recordSize();
+            batch.input.resize(batch_size, inputs);
+            batch.expected.resize(batch_size, source->outputSize());
+
+            size_t rows = 0;
+            while (rows < batch_size) {
+                refill();
+                if (pool_count == 0) break;
+                const size_t pick = static_cast<size_t>(rng.below(pool_count));
+                const T* record = pool.data() + pick * fields;
+                std::copy(record, record + inputs, batch.input.row(rows).data());
+                std::copy(record + inputs, record + fields, batch.expected.row(rows).data());
+                // Fill the hole with the last record
+                --pool_count;
+                std::copy(pool.data() + pool_count * fields, pool.data() + (pool_count + 1) * fields,
+                          pool.data() + pick * fields);
+                ++rows;
+            }
+            // Shrinking keeps the capacity, so full-size batches later need no allocation
+            batch.input.resize(rows, inputs);
+            batch.expected.resize(rows, source->outputSize());
+            return rows > 0;
+        }
+
+        void decodeLoop() {
+            Batch<T> working;
+            std::unique_lock<std::mutex> lock(mutex);
+            size_t seen = generation;
+            while (!stopping) {
+                if (seen != generation) {
+                    seen = generation;
+                    lock.unlock();
+                    restart();
+                    lock.lock();
+                    continue;
+                }
+                if (finished) {
+                    wake.wait(lock, [&] { return stopping || seen != generation; });
+                    continue;
+                }
+
+                lock.unlock();
+                bool produced = false;
+                std::exception_ptr failure;
+                try {
+                    produced = fill(working);
+                } catch (...) {
+                    failure = std::current_exception();
+                }
+                lock.lock();
+
+                // Publish once the consumer has taken the previous batch
+                wake.wait(lock, [&] { return stopping || seen != generation || !has_ready; });
+                if (stopping || seen != generation) continue;  // Rewound while decoding: drop it
+                if (failure) {
+                    error = failure;
+                    finished = true;
+                } else if (produced) {
+                    std::swap(ready, working);
+                    has_ready = true;
+                } else {
+                    finished = true;
+                }
+                wake.notify_all();
+            }
+        }
+
+    public:
+        Stream(std::unique_ptr<Source<T>> source, size_t batch_size, size_t shuffle_records = 8192,
+               bool prefetch = true, uint64_t seed = Random::nextSeed())
+            : source(std::move(source)), batch_size(batch_size), rng(seed),
+              pool_capacity(std::max<size_t>(shuffle_records, 1)), prefetch(prefetch) {
+            if (!this->source) throw std::invalid_argument("Stream needs a source");
+            if (batch_size == 0) throw std::invalid_argument("Batch size must be positive");
+            pool.resize(pool_capacity * this->source->recordSize());
+            if (prefetch) decoder = std::thread([this] { decodeLoop(); });
+        }
+
+        ~Stream() {
+            if (!prefetch) return;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            decoder.join();
+        }
+
+        Stream(const Stream&) = delete;
+        Stream& operator=(const Stream&) = delete;
+
+        // Next batch of the current pass, or nullptr once the pass is over
+        // The batch stays valid until the next call; rethrows decoding errors
+        const Batch<T>* next() {
+            if (!prefetch) {
+                if (finished || !fill(current)) {
+                    finished = true;
+                    return nullptr;
+                }
+                return &current;
+            }
+
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return has_ready || finished; });
+            if (!has_ready) {
+                if (error) std::rethrow_exception(std::exchange(error, nullptr));
+                return nullptr;
+            }
+            std::swap(current, ready);
+            has_ready = false;
+            lock.unlock();
+            wake.notify_all();
+            return &current;
+        }
+
+        // Start a new pass from the first record; the shuffle order differs per pass
+        // With prefetch on, decoding of the new pass starts right away
+        void rewind() {
+            if (!prefetch) {
+                restart();
+                finished = false;
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ++generation;
+                has_ready = false;
+                finished = false;
+                error = nullptr;
+            }
+            wake.notify_all();
+        }
+
+        size_t inputSize() const { return source->inputSize(); }
+        size_t outputSize() const { return source->outputSize(); }
+        size_t batchSize() const { return batch_size; }
+    };
+}
@@ -0,0 +1,183 @@
+#pragma once
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include "thread_pool.hpp"
+
+template<typename T>
+class Matrix;
+
+// Lazy elementwise expressions over matrices
+//
+// Matrix +, -, scalar * and hadamard() do not compute anything: they return small
+// expression objects describing the operation tree, e.g.
+//     (predicted - expected) * (T(2) / n)
+// is a Scaled<Binary<Sub, Leaf, Leaf>>. The work happens when an expression is assigned
+// to a Matrix (constructor, =, += or -=): one fused loop computes every element through
+// the whole tree, so a chain of operators walks memory once and allocates at most the
+// result (nothing when assigning into a matrix that is already large enough). The loop is
+// a plain indexed loop the compiler vectorizes, split across the thread pool.
+//
+// Leaves refer to the matrices' storage, which must stay alive and unresized until the
+// expression is evaluated. Assign expressions to a Matrix in the same statement; do not
+// keep them in `auto` variables.
+namespace Expr {
+    // CRTP base of every expression node
+    template<typename E>
+    struct Expression {
+        const E& self() const { return static_cast<const E&>(*this); }
+
+        // Elementwise product with another matrix or expression
+        template<typename R>
+        auto hadamard(const R& other) const;
+    };
+
+    template<typename X>
+    constexpr bool isExpression = std::is_base_of_v<Expression<X>, X>;
+
+    // A matrix's elements, read in place
+    template<typename T>
+    class Leaf : public Expression<Leaf<T>> {
+    private:
+        const T* values;
+        size_t rows;
+        size_t cols;
+
+    public:
+        using value_type = T;
+
+        Leaf(const T* values, size_t rows, size_t cols) : values(values), rows(rows), cols(cols) {}
+
+        T operator[](size_t i) const { return values[i]; }
+        size_t getRows() const { return rows; }
+        size_t getCols() const { return cols; }
+    };
+
+    struct Add {
+        template<typename T>
+        static T apply(T a, T b) { return a + b; }
+    };
+
+    struct Sub {
+        template<typename T>
+        static T apply(T a, T b) { return a - b; }
+    };
+
+    struct Mul {
+        template<typename T>
+        static T apply(T a, T b) { return a * b; }
+    };
+
+    // Elementwise combination of two same-shaped operands
+    template<typename Op, typename L, typename R>
+    class Binary : public Expression<Binary<Op, L, R>> {
+    private:
+        L left;
+        R right;
+
+    public:
+        using value_type = typename L::value_type;
+        static_assert(std::is_same_v<value_type, typename R::value_type>, "Operands have different element types");
+
+        Binary(const L& left, const R& right, const char* mismatch) : left(left), right(right) {
+            if (left.getRows() != right.getRows() || left.getCols() != right.getCols()) {
+                throw std::invalid_argument(mismatch);
+            }
+        }
+
+        value_type operator[](size_t i) const { return Op::apply(left[i], right[i]); }
+        size_t getRows() const { return left.getRows(); }
+        size_t getCols() const { return left.getCols(); }
+    };
+
+    // Operand times a scalar
+    template<typename E>
+    class Scaled : public Expression<Scaled<E>> {
+    public:
+        using value_type = typename E::value_type;
+
+    private:
+        E operand;
+        value_type scalar;
+
+    public:
+        Scaled(const E& operand, value_type scalar) : operand(operand), scalar(scalar) {}
+
+        value_type operator[](size_t i) const { return operand[i] * scalar; }
+        size_t getRows() const { return operand.getRows(); }
+        size_t getCols() const { return operand.getCols(); }
+    };
+
+    // Operands: matrices (wrapped in a Leaf) and expressions (used as they are)
+    template<typename X>
+    struct Operand {
+        static constexpr bool valid = isExpression<X>;
+        static const X& wrap(const X& x) { return x; }
+    };
+
+    template<typename T>
+    struct Operand<Matrix<T>> {
+        static constexpr bool valid = true;
+        static Leaf<T> wrap(const Matrix<T>& m) { return Leaf<T>(m.data(), m.getRows(), m.getCols()); }
+    };
+
+    template<typename X>
+    using Node = std::decay_t<decltype(Operand<X>::wrap(std::declval<const X&>()))>;
+
+    template<typename... X>
+    using EnableIfOperands = std::enable_if_t<(Operand<X>::valid && ...)>;
+
+    template<typename X>
+    using ValueType = typename Node<X>::value_type;
+
+    template<typename A, typename B, typename = EnableIfOperands<A, B>>
+    Binary<Add, Node<A>, Node<B>> operator+(const A& a, const B& b) {
+        return {Operand<A>::wrap(a), Operand<B>::wrap(b), "Matrix dimensions don't match for addition"};
+    }
+
+    template<typename A, typename B, typename = EnableIfOperands<A, B>>
+    Binary<Sub, Node<A>, Node<B>> operator-(const A& a, const B& b) {
+        return {Operand<A>::wrap(a), Operand<B>::wrap(b), "Matrix dimensions don't match for subtraction"};
+    }
+
+    // The scalar converts to the element type, so matrix<float> * 0.5 stays float
+    template<typename A, typename = EnableIfOperands<A>>
+    Scaled<Node<A>> operator*(const A& a, ValueType<A> scalar) {
+        return {Operand<A>::wrap(a), scalar};
+    }
+
+    template<typename A, typename = EnableIfOperands<A>>
+    Scaled<Node<A>> operator*(ValueType<A> scalar, const A& a) {
+        return {Operand<A>::wrap(a), scalar};
+    }
+
+    template<typename A, typename B, typename = EnableIfOperands<A, B>>
+    Binary<Mul, Node<A>, Node<B>> hadamard(const A& a, const B& b) {
+        return {Operand<A>::wrap(a), Operand<B>::wrap(b), "Matrix dimensions don't match for hadamard product"};
+    }
+
+    template<typename E>
+    template<typename R>
+    auto Expression<E>::hadamard(const R& other) const {
+        return Expr::hadamard(self(), other);
+    }
+
+    // Evaluate every element into out (which has the expression's size), combining it with
+    // the current value: Assign::apply(out[i], expr[i])
+    template<typename Assign, typename E>
+    void evaluate(const E& expr, typename E::value_type* out) {
+        const size_t count = expr.getRows() * expr.getCols();
+        Parallel::parallelFor(0, count, Parallel::ELEMENTWISE_GRAIN, [&](size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; ++i) out[i] = Assign::apply(out[i], expr[i]);
+        });
+    }
+
+    struct Replace {
+        template<typename T>
+        static T apply(T, T value) { return value; }
+    };
+}
+
+using Expr::operator+;
+using Expr::operator-;
+using Expr::operator*;
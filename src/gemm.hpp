@@ -0,0 +1,345 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include "memory.hpp"
+#include "precision.hpp"
+#include "profiler.hpp"
+#include "simd.hpp"
+#include "thread_pool.hpp"
+
+// GEMM engine: C = alpha * A * B + beta * C
+// Operands are described by a base pointer plus row and column strides, so any
+// MatrixView (including transposed views) can be multiplied without copying.
+// Large products are cache blocked (NC/KC/MC), packed into contiguous panels and
+// computed by register-tiled micro-kernels chosen at runtime for the CPU.
+// A and B may be stored in a reduced-precision format (see precision.hpp): they are
+// decoded to T while packing, so the micro-kernels always accumulate in T.
+namespace Gemm {
+    namespace detail {
+        namespace portable {
+#include "gemm_kernel.inl"
+        }
+
+#if NN_SIMD_X86
+NN_SIMD_BEGIN_AVX2
+        namespace avx2 {
+#include "gemm_kernel.inl"
+        }
+NN_SIMD_END
+
+NN_SIMD_BEGIN_AVX512
+        namespace avx512 {
+#include "gemm_kernel.inl"
+        }
+NN_SIMD_END
+#endif
+
+        // Micro-kernel plus the blocking parameters tuned for it
+        // kc * nr fills roughly half of L1, mc * kc roughly half of L2
+        template<typename T>
+        struct KernelConfig {
+            void (*kernel)(size_t, const T*, const T*, T*, size_t, T, T);
+            size_t mr, nr;      // Register tile
+            size_t kc, mc, nc;  // Cache blocks
+            void (*row)(size_t, size_t, T, const T*, size_t, const T*, size_t, T, T*);  // Unpacked C row
+        };
+
+        template<typename T>
+        const KernelConfig<T>& selectKernel(Simd::Level level);
+
+        template<>
+        inline const KernelConfig<double>& selectKernel<double>(Simd::Level level) {
+            static const KernelConfig<double> scalar{
+                &portable::microKernel<Simd::ScalarOps<double>, 4, 4>, 4, 4, 256, 128, 2048,
+                &portable::rowKernel<Simd::ScalarOps<double>>};
+#if NN_SIMD_X86
+            static const KernelConfig<double> avx2{
+                &avx2::microKernel<Simd::Avx2Ops<double>, 6, 2>, 6, 8, 256, 72, 4096,
+                &avx2::rowKernel<Simd::Avx2Ops<double>>};
+            static const KernelConfig<double> avx512{
+                &avx512::microKernel<Simd::Avx512Ops<double>, 12, 2>, 12, 16, 192, 96, 4096,
+                &avx512::rowKernel<Simd::Avx512Ops<double>>};
+            if (level == Simd::Level::AVX512) return avx512;
+            if (level == Simd::Level::AVX2) return avx2;
+#else
+            (void)level;
+#endif
+            return scalar;
+        }
+
+        template<>
+        inline const KernelConfig<float>& selectKernel<float>(Simd::Level level) {
+            static const KernelConfig<float> scalar{
+                &portable::microKernel<Simd::ScalarOps<float>, 4, 4>, 4, 4, 256, 128, 2048,
+                &portable::rowKernel<Simd::ScalarOps<float>>};
+#if NN_SIMD_X86
+            static const KernelConfig<float> avx2{
+                &avx2::microKernel<Simd::Avx2Ops<float>, 6, 2>, 6, 16, 256, 144, 4096,
+                &avx2::rowKernel<Simd::Avx2Ops<float>>};
+            static const KernelConfig<float> avx512{
+                &avx512::microKernel<Simd::Avx512Ops<float>, 12, 2>, 12, 32, 192, 192, 4096,
+                &avx512::rowKernel<Simd::Avx512Ops<float>>};
+            if (level == Simd::Level::AVX512) return avx512;
+            if (level == Simd::Level::AVX2) return avx2;
+#else
+            (void)level;
+#endif
+            return scalar;
+        }
+
+        // Elements decoded per run when a reduced-precision operand is packed across its layout
+        constexpr size_t DECODE_RUN = 64;
+
+        // Copy an mc x kc block of A into MR-row panels, zero-padding the last panel
+        // Reduced-precision A is decoded in contiguous runs (rows of A, or columns when transposed)
+        template<typename T, typename Codec = Precision::Native<T>>
+        void packA(size_t mc, size_t kc, const typename Codec::Storage* a, size_t rsa, size_t csa,
+                   size_t mr, T* out) {
+            constexpr bool coded = !std::is_same<Codec, Precision::Native<T>>::value;
+            for (size_t ir = 0; ir < mc; ir += mr) {
+                const size_t rows = std::min(mr, mc - ir);
+                if (coded && csa == 1 && rsa != 1) {
+                    T run[DECODE_RUN];
+                    for (size_t i = 0; i < rows; ++i) {
+                        for (size_t p0 = 0; p0 < kc; p0 += DECODE_RUN) {
+                            const size_t count = std::min(DECODE_RUN, kc - p0);
+                            Precision::decodeRun<Codec>(a + (ir + i) * rsa + p0, run, count);
+                            for (size_t p = 0; p < count; ++p) out[(p0 + p) * mr + i] = run[p];
+                        }
+                    }
+                    for (size_t p = 0; p < kc; ++p) {
+                        for (size_t i = rows; i < mr; ++i) out[p * mr + i] = T(0);
+                    }
+                    out += kc * mr;
+                    continue;
+                }
+                for (size_t p = 0; p < kc; ++p) {
+                    const typename Codec::Storage* src = a + ir * rsa + p * csa;
+                    if (coded && rsa == 1) Precision::decodeRun<Codec>(src, out, rows);
+                    else for (size_t i = 0; i < rows; ++i) out[i] = static_cast<T>(Codec::decode(src[i * rsa]));
+                    for (size_t i = rows; i < mr; ++i) out[i] = T(0);
+                    out += mr;
+                }
+            }
+        }
+
+        // Copy a kc x nc block of B into NR-column panels, zero-padding the last panel
+        template<typename T, typename Codec = Precision::Native<T>>
+        void packB(size_t kc, size_t nc, const typename Codec::Storage* b, size_t rsb, size_t csb,
+                   size_t nr, T* out) {
+            constexpr bool coded = !std::is_same<Codec, Precision::Native<T>>::value;
+            for (size_t jr = 0; jr < nc; jr += nr) {
+                const size_t cols = std::min(nr, nc - jr);
+                if (rsb == 1 && csb != 1) {
+                    // Transposed B: columns are contiguous, so walk each column down k
+                    for (size_t j = 0; j < cols; ++j) {
+                        const typename Codec::Storage* src = b + (jr + j) * csb;
+                        if (coded) {
+                            T run[DECODE_RUN];
+                            for (size_t p0 = 0; p0 < kc; p0 += DECODE_RUN) {
+                                const size_t count = std::min(DECODE_RUN, kc - p0);
+                                Precision::decodeRun<Codec>(src + p0, run, count);
+                                for (size_t p = 0; p < count; ++p) out[(p0 + p) * nr + j] = run[p];
+                            }
+                            continue;
+                        }
+                        for (size_t p = 0; p < kc; ++p) out[p * nr + j] = static_cast<T>(Codec::decode(src[p]));
+                    }
+                    for (size_t p = 0; p < kc; ++p) {
+                        for (size_t j = cols; j < nr; ++j) out[p * nr + j] = T(0);
+                    }
+                    out += kc * nr;
+                    continue;
+                }
+                for (size_t p = 0; p < kc; ++p) {
+                    const typename Codec::Storage* src = b + p * rsb + jr * csb;
+                    if (csb == 1 && std::is_same<Codec, Precision::Native<T>>::value) {
+                        std::copy(src, src + cols, out);
+                    } else if (csb == 1) {
+                        Precision::decodeRun<Codec>(src, out, cols);
+                    } else {
+                        for (size_t j = 0; j < cols; ++j) out[j] = static_cast<T>(Codec::decode(src[j * csb]));
+                    }
+                    for (size_t j = cols; j < nr; ++j) out[j] = T(0);
+                    out += nr;
+                }
+            }
+        }
+
+        // Per-thread packing buffers, grown on demand and reused across calls
+        template<typename T>
+        T* scratch(std::vector<T, Memory::AlignedAllocator<T>>& buffer, size_t size) {
+            if (buffer.size() < size) buffer.resize(size);
+            return buffer.data();
+        }
+
+        // C = beta * C, treating beta == 0 as an overwrite (C may be uninitialized)
+        template<typename T>
+        void scale(size_t m, size_t n, T beta, T* c, size_t ldc) {
+            for (size_t i = 0; i < m; ++i) {
+                T* row = c + i * ldc;
+                for (size_t j = 0; j < n; ++j) row[j] = beta == T(0) ? T(0) : beta * row[j];
+            }
+        }
+    }
+
+    // Operand layout flag: use the operand as stored or as its transpose
+    enum class Transpose { No, Yes };
+
+    // Post-processing applied to each finished tile of C while it is still hot in cache
+    // Lets callers fuse bias-add, activations or activation derivatives into the multiply.
+    // `tile` points at C(row, col) and spans rows x cols with row stride ldc.
+    template<typename T>
+    struct Epilogue {
+        void (*apply)(const void* context, T* tile, size_t ldc,
+                      size_t row, size_t col, size_t rows, size_t cols) = nullptr;
+        const void* context = nullptr;
+    };
+
+    // Products at or below this many multiply-adds skip packing entirely
+    // Packing costs O(mk + kn), which dominates for tiny layers such as the XOR net
+    constexpr size_t SMALL_PRODUCT = 32 * 32 * 32;
+
+    // Products with at most this many rows skip packing and run the row kernel on B in place
+    constexpr size_t ROW_KERNEL_ROWS = 4;
+
+    // Straightforward i-k-j loop: used for small products and as the correctness reference
+    template<typename T, typename CodecA = Precision::Native<T>, typename CodecB = Precision::Native<T>>
+    void reference(size_t m, size_t n, size_t k, T alpha,
+                   const typename CodecA::Storage* a, size_t rsa, size_t csa,
+                   const typename CodecB::Storage* b, size_t rsb, size_t csb,
+                   T beta, T* c, size_t ldc) {
+        detail::scale(m, n, beta, c, ldc);
+        for (size_t i = 0; i < m; ++i) {
+            T* out = c + i * ldc;
+            for (size_t p = 0; p < k; ++p) {
+                const T av = alpha * static_cast<T>(CodecA::decode(a[i * rsa + p * csa]));
+                const typename CodecB::Storage* brow = b + p * rsb;
+                for (size_t j = 0; j < n; ++j) {
+                    out[j] += av * static_cast<T>(CodecB::decode(brow[j * csb]));
+                }
+            }
+        }
+    }
+
+    // Products at or above this many multiply-adds are split across the thread pool
+    constexpr size_t PARALLEL_PRODUCT = 64 * 64 * 64;
+
+    // General matrix multiply: C[m x n] = alpha * A[m x k] * B[k x n] + beta * C
+    // A(i, p) = a[i * rsa + p * csa], B(p, j) = b[p * rsb + j * csb], C is row-major with stride ldc
+    // A transposed operand is expressed by swapping its two strides
+    // An optional epilogue runs once on every tile of C after its final k block
+    // CodecA / CodecB name the storage format of A and B (Precision::Native<T> by default)
+    template<typename T, typename CodecA = Precision::Native<T>, typename CodecB = Precision::Native<T>>
+    void gemm(size_t m, size_t n, size_t k, T alpha,
+              const typename CodecA::Storage* a, size_t rsa, size_t csa,
+              const typename CodecB::Storage* b, size_t rsb, size_t csb,
+              T beta, T* c, size_t ldc,
+              const Epilogue<T>* epilogue = nullptr) {
+        if (m == 0 || n == 0) return;
+        NN_PROFILE_SCOPE_WORK("op", "gemm", 2 * m * n * k,
+                              m * k * sizeof(*a) + k * n * sizeof(*b) + m * n * sizeof(T));
+        if (k == 0 || alpha == T(0) || m * n * k <= SMALL_PRODUCT) {
+            if (k == 0 || alpha == T(0)) detail::scale(m, n, beta, c, ldc);
+            else reference<T, CodecA, CodecB>(m, n, k, alpha, a, rsa, csa, b, rsb, csb, beta, c, ldc);
+            if (epilogue) epilogue->apply(epilogue->context, c, ldc, 0, 0, m, n);
+            return;
+        }
+
+        const auto& cfg = detail::selectKernel<T>(Simd::activeLevel());
+        // Matrix-vector shaped products (single-sample inference) read B in place
+        constexpr bool native = std::is_same<CodecA, Precision::Native<T>>::value &&
+                                std::is_same<CodecB, Precision::Native<T>>::value;
+        if constexpr (native) {
+            if (m <= ROW_KERNEL_ROWS && csb == 1) {
+                for (size_t i = 0; i < m; ++i) cfg.row(n, k, alpha, a + i * rsa, csa, b, rsb, beta, c + i * ldc);
+                if (epilogue) epilogue->apply(epilogue->context, c, ldc, 0, 0, m, n);
+                return;
+            }
+        }
+
+        // Borrow this thread's B buffer for the whole call: while waiting on the pool the
+        // thread may run a nested GEMM task, which must not repack into the same memory
+        thread_local std::vector<T, Memory::AlignedAllocator<T>> b_cache;
+        std::vector<T, Memory::AlignedAllocator<T>> b_buffer;
+        b_buffer.swap(b_cache);
+        T* packed_b = detail::scratch(b_buffer, cfg.kc * ((std::min(n, cfg.nc) + cfg.nr - 1) / cfg.nr) * cfg.nr);
+
+        // Split rows into enough MC blocks to give every thread work; each block
+        // writes a disjoint slice of C, so results do not depend on the thread count
+        const size_t threads = m * n * k >= PARALLEL_PRODUCT ? Parallel::numThreads() : 1;
+        size_t mc_step = cfg.mc;
+        if (threads > 1) {
+            const size_t rows_per_thread = (m + threads - 1) / threads;
+            mc_step = std::min(cfg.mc, std::max(cfg.mr, (rows_per_thread + cfg.mr - 1) / cfg.mr * cfg.mr));
+        }
+        const size_t row_blocks = (m + mc_step - 1) / mc_step;
+
+        for (size_t jc = 0; jc < n; jc += cfg.nc) {
+            const size_t nc = std::min(cfg.nc, n - jc);
+            const size_t panels = (nc + cfg.nr - 1) / cfg.nr;
+            for (size_t pc = 0; pc < k; pc += cfg.kc) {
+                const size_t kc = std::min(cfg.kc, k - pc);
+                // Later k blocks accumulate onto the partial sums already in C
+                const T block_beta = pc == 0 ? beta : T(1);
+                const Epilogue<T>* tile_epilogue = pc + kc == k ? epilogue : nullptr;
+
+                // Pack the shared B block, one range of NR panels per task
+                const typename CodecB::Storage* b_block = b + pc * rsb + jc * csb;
+                auto pack_panels = [&](size_t lo, size_t hi) {
+                    const size_t first = lo * cfg.nr;
+                    detail::packB<T, CodecB>(kc, std::min(nc, hi * cfg.nr) - first, b_block + first * csb,
+                                  rsb, csb, cfg.nr, packed_b + first * kc);
+                };
+                if (threads > 1) Parallel::parallelFor(0, panels, 4, pack_panels);
+                else pack_panels(0, panels);
+
+                // Each row block packs its own A panel into thread-local scratch
+                auto row_block = [&](size_t lo, size_t hi) {
+                    thread_local std::vector<T, Memory::AlignedAllocator<T>> a_buffer;
+                    T* packed_a = detail::scratch(a_buffer, cfg.mc * cfg.kc);
+                    alignas(Memory::CACHE_LINE) T edge[16 * 32];  // Staging tile for partial MR x NR blocks
+
+                    for (size_t block = lo; block < hi; ++block) {
+                        const size_t ic = block * mc_step;
+                        const size_t mc = std::min(mc_step, m - ic);
+                        detail::packA<T, CodecA>(mc, kc, a + ic * rsa + pc * csa, rsa, csa, cfg.mr, packed_a);
+
+                        for (size_t jr = 0; jr < nc; jr += cfg.nr) {
+                            const size_t cols = std::min(cfg.nr, nc - jr);
+                            for (size_t ir = 0; ir < mc; ir += cfg.mr) {
+                                const size_t rows = std::min(cfg.mr, mc - ir);
+                                T* tile = c + (ic + ir) * ldc + jc + jr;
+                                const T* pa = packed_a + ir * kc;
+                                const T* pb = packed_b + jr * kc;
+
+                                if (rows == cfg.mr && cols == cfg.nr) {
+                                    cfg.kernel(kc, pa, pb, tile, ldc, alpha, block_beta);
+                                } else {
+                                    // Partial tile: compute the full tile aside, then merge the valid part
+                                    cfg.kernel(kc, pa, pb, edge, cfg.nr, alpha, T(0));
+                                    for (size_t i = 0; i < rows; ++i) {
+                                        for (size_t j = 0; j < cols; ++j) {
+                                            T& out = tile[i * ldc + j];
+                                            out = block_beta == T(0) ? edge[i * cfg.nr + j]
+                                                                     : block_beta * out + edge[i * cfg.nr + j];
+                                        }
+                                    }
+                                }
+                                if (tile_epilogue) {
+                                    tile_epilogue->apply(tile_epilogue->context, tile, ldc,
+                                                         ic + ir, jc + jr, rows, cols);
+                                }
+                            }
+                        }
+                    }
+                };
+                if (threads > 1) Parallel::parallelFor(0, row_blocks, 1, row_block);
+                else row_block(0, row_blocks);
+            }
+        }
+        b_cache.swap(b_buffer);
+    }
+}
@@ -0,0 +1,109 @@
+// Register-tiled GEMM micro-kernel and row-kernel bodies
+// Included once per instruction-set region by gemm.hpp, so each copy is
+// compiled with that region's target options. Do not include directly.
+//
+// Ops must provide: T, V, lanes, zero(), load(), store(), broadcast(), mul(), fma()
+
+// Computes an MR x (NV * lanes) tile: c = alpha * (a * b) + beta * c
+// a: packed panel, MR values per k step; b: packed panel, NR values per k step
+// beta == 0 never reads c, so c may hold uninitialized memory
+template<typename Ops, size_t MR, size_t NV>
+void microKernel(size_t kc, const typename Ops::T* a, const typename Ops::T* b,
+                 typename Ops::T* c, size_t ldc, typename Ops::T alpha, typename Ops::T beta) {
+    using V = typename Ops::V;
+    constexpr size_t NR = NV * Ops::lanes;
+
+    // Accumulators live in registers for the whole k loop
+    V acc[MR][NV];
+#pragma GCC unroll 16
+    for (size_t i = 0; i < MR; ++i) {
+#pragma GCC unroll 4
+        for (size_t v = 0; v < NV; ++v) {
+            acc[i][v] = Ops::zero();
+        }
+    }
+
+    for (size_t p = 0; p < kc; ++p) {
+        V bv[NV];
+#pragma GCC unroll 4
+        for (size_t v = 0; v < NV; ++v) {
+            bv[v] = Ops::load(b + v * Ops::lanes);
+        }
+#pragma GCC unroll 16
+        for (size_t i = 0; i < MR; ++i) {
+            V av = Ops::broadcast(a[i]);
+#pragma GCC unroll 4
+            for (size_t v = 0; v < NV; ++v) {
+                acc[i][v] = Ops::fma(av, bv[v], acc[i][v]);
+            }
+        }
+        a += MR;
+        b += NR;
+    }
+
+    // Epilogue: scale and merge with existing C
+    V valpha = Ops::broadcast(alpha);
+    if (beta == typename Ops::T(0)) {
+#pragma GCC unroll 16
+        for (size_t i = 0; i < MR; ++i) {
+#pragma GCC unroll 4
+            for (size_t v = 0; v < NV; ++v) {
+                Ops::store(c + i * ldc + v * Ops::lanes, Ops::mul(acc[i][v], valpha));
+            }
+        }
+    } else {
+        V vbeta = Ops::broadcast(beta);
+#pragma GCC unroll 16
+        for (size_t i = 0; i < MR; ++i) {
+#pragma GCC unroll 4
+            for (size_t v = 0; v < NV; ++v) {
+                typename Ops::T* out = c + i * ldc + v * Ops::lanes;
+                Ops::store(out, Ops::fma(vbeta, Ops::load(out), Ops::mul(acc[i][v], valpha)));
+            }
+        }
+    }
+}
+
+// Computes one row of C: c = alpha * (a * B) + beta * c, reading B in place (row-major, stride rsb)
+// Used when C has only a few rows: each element of B is then used once per row, so packing
+// B would cost as much as the product itself. a holds k values with stride csa.
+// Columns go in blocks of NV vectors whose accumulators stay in registers for the whole k loop.
+template<typename Ops>
+void rowKernel(size_t n, size_t k, typename Ops::T alpha, const typename Ops::T* a, size_t csa,
+               const typename Ops::T* b, size_t rsb, typename Ops::T beta, typename Ops::T* c) {
+    using T = typename Ops::T;
+    using V = typename Ops::V;
+    constexpr size_t NV = 4;
+    const V valpha = Ops::broadcast(alpha);
+    const V vbeta = Ops::broadcast(beta);
+
+    auto finish = [&](T* out, V acc) {
+        if (beta == T(0)) Ops::store(out, Ops::mul(acc, valpha));
+        else Ops::store(out, Ops::fma(vbeta, Ops::load(out), Ops::mul(acc, valpha)));
+    };
+
+    size_t j = 0;
+    for (; j + NV * Ops::lanes <= n; j += NV * Ops::lanes) {
+        V acc[NV];
+#pragma GCC unroll 4
+        for (size_t v = 0; v < NV; ++v) acc[v] = Ops::zero();
+        for (size_t p = 0; p < k; ++p) {
+            const V av = Ops::broadcast(a[p * csa]);
+            const T* brow = b + p * rsb + j;
+#pragma GCC unroll 4
+            for (size_t v = 0; v < NV; ++v) acc[v] = Ops::fma(av, Ops::load(brow + v * Ops::lanes), acc[v]);
+        }
+#pragma GCC unroll 4
+        for (size_t v = 0; v < NV; ++v) finish(c + j + v * Ops::lanes, acc[v]);
+    }
+    for (; j + Ops::lanes <= n; j += Ops::lanes) {
+        V acc = Ops::zero();
+        for (size_t p = 0; p < k; ++p) acc = Ops::fma(Ops::broadcast(a[p * csa]), Ops::load(b + p * rsb + j), acc);
+        finish(c + j, acc);
+    }
+    for (; j < n; ++j) {
+        T sum = 0;
+        for (size_t p = 0; p < k; ++p) sum += a[p * csa] * b[p * rsb + j];
+        c[j] = beta == T(0) ? alpha * sum : beta * c[j] + alpha * sum;
+    }
+}
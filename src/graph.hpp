@@ -0,0 +1,563 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "layer.hpp"
+#include "loss.hpp"
+#include "memory.hpp"
+#include "profiler.hpp"
+#include "thread_pool.hpp"
+
+// Compute graph: layers wired into a directed acyclic graph, run over one preallocated
+// workspace per pass
+//
+// Nodes are created in topological order, each reading nodes created before it:
+//   Input    the batch, read in place from the caller's view
+//   Dense    a Layer applied to one node
+//   Add      elementwise sum of equally wide nodes (residual connections)
+//   Concat   nodes side by side, [rows x sum of widths]
+// A node may feed any number of later nodes; the node created last is the output, and
+// every other node must be read by some later node.
+//
+// Memory plan: a pass is a sequence of steps (the forward steps in node order, the loss,
+// then the backward steps in reverse node order), and each tensor a pass writes (a node's
+// output, its 16-bit copy in mixed precision and, when training, its gradient) is live
+// from the step that first writes it to the step that last reads it. A greedy first-fit
+// assigns every tensor an offset in one buffer such that tensors with overlapping
+// lifetimes never overlap in memory. Tensors are all [rows x width], so offsets are planned
+// per batch row and scale with the batch: one plan serves every batch size.
+// Training keeps each dense output until its own backward step (the activation derivative
+// reads it), but a gradient only lives from its first reader's backward step to its own,
+// so a chain of L layers holds L outputs and two gradients instead of 2L tensors.
+// Inference keeps outputs only until their last reader: a chain runs in two buffers.
+// In mixed precision, a dense node whose readers are all dense layers is kept only as its
+// 16-bit copy after its forward step: the readers' GEMMs read that copy and the activation
+// derivative decodes it, so its T output is forward scratch that such layers share.
+//
+// Backward, the gradient tensor of a dense node turns into its delta in place. A node read
+// by a single layer gets its delta straight from that layer's propagation GEMM, the
+// activation derivative fused into the epilogue; gradients of nodes with several readers
+// are accumulated in place (GEMM with beta = 1, or an add).
+namespace Graph {
+    using NodeId = size_t;
+
+    enum class Op { Input, Dense, Add, Concat };
+
+    template<typename T>
+    struct Node {
+        Op op;
+        std::vector<NodeId> inputs;        // Nodes read, in order (Concat places them left to right)
+        std::shared_ptr<Layer<T>> layer;   // Dense nodes only
+        size_t layer_index = 0;            // Position of the layer in ComputeGraph::getLayers()
+        size_t width = 0;                  // Output columns
+    };
+
+    // Placement of the tensors of one kind of pass in a workspace buffer
+    // Sizes and offsets are bytes per batch row: with r rows, tensor t starts at byte
+    // tensors[t].offset * r of the buffer and the buffer holds row_bytes * r bytes
+    struct Plan {
+        static constexpr size_t NONE = std::numeric_limits<size_t>::max();
+
+        struct Tensor {
+            size_t row_bytes;   // Rounded up to a cache line, so every tensor stays aligned
+            size_t first;       // Lifetime: first and last step using the tensor
+            size_t last;
+            size_t offset;
+        };
+
+        std::vector<Tensor> tensors;
+        std::vector<size_t> output;     // Per node: tensor of its output (NONE: read from the caller)
+        std::vector<size_t> output16;   // Per node: 16-bit copy of a dense output (NONE: not needed)
+        std::vector<size_t> gradient;   // Per node: dL/d(output); a dense node's delta in place
+        std::vector<char> encoded;      // Per node: later steps read only output16 (output is scratch)
+        size_t row_bytes = 0;           // Workspace bytes per batch row
+        size_t unshared_row_bytes = 0;  // Bytes per row if every tensor had memory of its own
+
+        explicit Plan(size_t nodes)
+            : output(nodes, NONE), output16(nodes, NONE), gradient(nodes, NONE), encoded(nodes, 0) {}
+
+        size_t add(size_t bytes_per_row, size_t first, size_t last) {
+            const size_t bytes = (bytes_per_row + Memory::CACHE_LINE - 1) / Memory::CACHE_LINE * Memory::CACHE_LINE;
+            tensors.push_back({bytes, first, last, 0});
+            unshared_row_bytes += bytes;
+            return tensors.size() - 1;
+        }
+
+        // Assign offsets, largest tensors first: each goes to the lowest offset clear of every
+        // placed tensor whose lifetime overlaps its own
+        void place() {
+            std::vector<size_t> order(tensors.size());
+            std::iota(order.begin(), order.end(), size_t(0));
+            std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+                if (tensors[a].row_bytes != tensors[b].row_bytes) return tensors[a].row_bytes > tensors[b].row_bytes;
+                return tensors[a].first < tensors[b].first;
+            });
+            std::vector<size_t> placed;
+            std::vector<std::pair<size_t, size_t>> busy;  // [begin, end) of conflicting placed tensors
+            for (size_t t : order) {
+                Tensor& tensor = tensors[t];
+                busy.clear();
+                for (size_t p : placed) {
+                    const Tensor& other = tensors[p];
+                    if (other.last < tensor.first || tensor.last < other.first) continue;
+                    busy.emplace_back(other.offset, other.offset + other.row_bytes);
+                }
+                std::sort(busy.begin(), busy.end());
+                size_t offset = 0;
+                for (const auto& range : busy) {
+                    if (range.first >= offset + tensor.row_bytes) break;
+                    offset = std::max(offset, range.second);
+                }
+                tensor.offset = offset;
+                row_bytes = std::max(row_bytes, offset + tensor.row_bytes);
+                placed.push_back(t);
+            }
+        }
+    };
+
+    template<typename T>
+    class ComputeGraph;
+
+    // Memory of one pass: a single buffer holding every tensor of a plan
+    // It grows to the largest batch seen and is reused after that, so passes over batches
+    // of known size perform no heap allocations
+    template<typename T>
+    class Workspace {
+    private:
+        friend class ComputeGraph<T>;
+
+        std::vector<unsigned char, Memory::AlignedAllocator<unsigned char>> buffer;
+        MatrixView<const T> input;    // Batch of the current pass, read in place
+        MatrixView<T> result;         // Caller's output of an inference pass
+        size_t rows = 0;
+        bool training = false;        // The buffer holds a training pass, ready for backward
+
+        void prepare(const Plan& plan, size_t batch_rows) {
+            reserve(plan, batch_rows);
+            rows = batch_rows;
+        }
+
+    public:
+        // Size the buffer for passes of up to max_rows rows
+        void reserve(const Plan& plan, size_t max_rows) {
+            if (buffer.size() < plan.row_bytes * max_rows) buffer.resize(plan.row_bytes * max_rows);
+        }
+
+        size_t bytes() const { return buffer.size(); }
+    };
+
+    // Topology plus executor: builds the graph, derives memory plans from it and runs
+    // training and inference passes on caller-owned workspaces
+    // Passes are const: any number of workspaces may run on one graph at once
+    template<typename T>
+    class ComputeGraph {
+    public:
+        // How one reader's backward step hands its contribution to a node's gradient
+        enum class Flow : uint8_t {
+            None,         // The node is the input: nothing to propagate
+            Write,        // First contribution: overwrite
+            WriteDelta,   // Only contribution to a dense node: write its delta directly
+            Accumulate    // Later contribution: add
+        };
+
+        // Everything derived from the topology, built once after each change
+        struct Schedule {
+            Plan training;
+            Plan inference;
+            std::vector<std::vector<Flow>> flows;  // flows[n][k]: node n's backward into inputs[k]
+            std::vector<char> delta_from_reader;   // Dense node whose delta its only reader writes
+
+            explicit Schedule(size_t nodes) : training(nodes), inference(nodes), flows(nodes), delta_from_reader(nodes, 0) {}
+        };
+
+    private:
+        std::vector<Node<T>> nodes;
+        std::vector<std::shared_ptr<Layer<T>>> layers;   // Dense layers in node order
+        mutable std::shared_ptr<const Schedule> schedule;  // Built on first use after a change
+
+    public:
+        ComputeGraph() { nodes.push_back(Node<T>{Op::Input, {}, nullptr, 0, 0}); }
+
+        NodeId input() const { return 0; }
+        NodeId output() const { return nodes.size() - 1; }
+
+        // Apply `layer` to node `from`; the input node takes its width from the first layer
+        // reading it. A layer may appear only once: it owns one set of parameters.
+        NodeId addDense(std::shared_ptr<Layer<T>> layer, NodeId from) {
+            checkNode(from);
+            if (!layer) throw std::invalid_argument("Layer must not be null");
+            if (std::find(layers.begin(), layers.end(), layer) != layers.end()) {
+                throw std::invalid_argument("A layer can appear in a graph only once");
+            }
+            const size_t layer_inputs = layer->getWeights().getRows();
+            Node<T>& source = nodes[from];
+            if (from == input() && source.width == 0) source.width = layer_inputs;
+            if (source.width != layer_inputs) {
+                throw std::invalid_argument("Layer input size " + std::to_string(layer_inputs) +
+                                            " does not match the width " + std::to_string(source.width) +
+                                            " of node " + std::to_string(from));
+            }
+            nodes.push_back(Node<T>{Op::Dense, {from}, layer, layers.size(), layer->getWeights().getCols()});
+            layers.push_back(std::move(layer));
+            invalidate();
+            return output();
+        }
+
+        // Elementwise sum of nodes of equal width, e.g. a residual connection
+        NodeId addSum(const std::vector<NodeId>& from) {
+            const size_t width = checkMerge(from);
+            for (NodeId id : from) {
+                if (nodes[id].width != width) throw std::invalid_argument("Added nodes have different widths");
+            }
+            nodes.push_back(Node<T>{Op::Add, from, nullptr, 0, width});
+            invalidate();
+            return output();
+        }
+
+        // Nodes side by side, in the order given
+        NodeId addConcat(const std::vector<NodeId>& from) {
+            checkMerge(from);
+            size_t width = 0;
+            for (NodeId id : from) width += nodes[id].width;
+            nodes.push_back(Node<T>{Op::Concat, from, nullptr, 0, width});
+            invalidate();
+            return output();
+        }
+
+        // Rebuild the plans on next use, e.g. after the layers' storage format changed
+        void invalidate() { std::atomic_store(&schedule, std::shared_ptr<const Schedule>()); }
+
+        const std::vector<std::shared_ptr<Layer<T>>>& getLayers() const { return layers; }
+        const std::vector<Node<T>>& getNodes() const { return nodes; }
+        size_t inputWidth() const { return nodes.front().width; }
+        size_t outputWidth() const { return nodes.back().width; }
+
+        // True for a plain chain input -> layer -> layer -> ..., the only shape checkpoints
+        // and quantized models describe
+        bool isSequential() const {
+            for (NodeId n = 1; n < nodes.size(); ++n) {
+                if (nodes[n].op != Op::Dense || nodes[n].inputs[0] != n - 1) return false;
+            }
+            return true;
+        }
+
+        const Plan& trainingPlan() const { return compiled()->training; }
+        const Plan& inferencePlan() const { return compiled()->inference; }
+
+        // Training forward pass over `input` into ws; returns the output, which lives in ws
+        // The input is read in place and must stay alive until backward() ran
+        MatrixView<const T> forward(Workspace<T>& ws, MatrixView<const T> input) const {
+            checkInput(input);
+            const std::shared_ptr<const Schedule> current = compiled();
+            ws.prepare(current->training, input.getRows());
+            ws.input = input;
+            ws.training = true;
+            run(current->training, ws);
+            return value(current->training, ws, output());
+        }
+
+        // Backward pass of the training pass in ws: loss times `scale` against `expected`,
+        // whose value is returned, and every layer's parameter gradients written into
+        // grads (indexed like getLayers())
+        T backward(Workspace<T>& ws, const Loss::LossFunction<T>& loss, MatrixView<const T> expected, T scale,
+                   const std::vector<LayerGradients<T>>& grads) const {
+            if (!ws.training) throw std::invalid_argument("Backward pass without a training forward pass");
+            if (grads.size() != layers.size()) throw std::invalid_argument("Need one set of gradients per layer");
+            const std::shared_ptr<const Schedule> current = compiled();
+            const Plan& plan = current->training;
+            const NodeId last = output();
+            const Node<T>& node = nodes[last];
+
+            // Loss and output gradient from one pass; when the loss differentiates through
+            // the output activation it writes the output layer's delta directly
+            MatrixView<T> gradient = tensor<T>(plan, ws, plan.gradient[last], node.width);
+            const bool fused = node.op == Op::Dense && loss.fusesActivation(*node.layer->getActivation());
+            const MatrixView<const T> predicted = value(plan, ws, last);
+            T loss_value;
+            {
+                NN_PROFILE_SCOPE("op", "loss");
+                loss_value = fused ? loss.lossAndDelta(*node.layer->getActivation(), predicted, expected, gradient, scale)
+                                   : loss.lossAndGradient(predicted, expected, gradient, scale);
+            }
+            for (NodeId n = last; n > 0; --n) {
+                backwardNode(*current, ws, n, n == last ? fused : current->delta_from_reader[n] != 0, grads);
+            }
+            return loss_value;
+        }
+
+        // Inference pass of `input` into the caller's output ([rows x output width])
+        void infer(Workspace<T>& ws, MatrixView<const T> input, MatrixView<T> result) const {
+            checkInput(input);
+            if (result.getRows() != input.getRows() || result.getCols() != outputWidth()) {
+                throw std::invalid_argument("Output does not match the input rows and graph output width");
+            }
+            const std::shared_ptr<const Schedule> current = compiled();
+            ws.prepare(current->inference, input.getRows());
+            ws.input = input;
+            ws.result = result;
+            ws.training = false;
+            run(current->inference, ws);
+        }
+
+    private:
+        void checkNode(NodeId id) const {
+            if (id >= nodes.size()) throw std::invalid_argument("Unknown graph node " + std::to_string(id));
+        }
+
+        // Validate the nodes of an Add or Concat; returns the width of the first
+        size_t checkMerge(const std::vector<NodeId>& from) const {
+            if (from.size() < 2) throw std::invalid_argument("Merging needs at least two nodes");
+            for (NodeId id : from) {
+                checkNode(id);
+                if (nodes[id].width == 0) {
+                    throw std::invalid_argument("Connect a layer to the input before merging it");
+                }
+            }
+            return nodes[from.front()].width;
+        }
+
+        void checkInput(MatrixView<const T> input) const {
+            if (input.getCols() != inputWidth()) {
+                throw std::invalid_argument("Input does not match the network input size");
+            }
+        }
+
+        std::shared_ptr<const Schedule> compiled() const {
+            std::shared_ptr<const Schedule> current = std::atomic_load(&schedule);
+            if (!current) {
+                // Concurrent first passes may each build one; the results are identical
+                current = std::make_shared<const Schedule>(compile());
+                std::atomic_store(&schedule, current);
+            }
+            return current;
+        }
+
+        // Liveness analysis, memory plans and backward data flow of the current topology
+        Schedule compile() const {
+            const size_t count = nodes.size();
+            std::vector<std::vector<std::pair<NodeId, size_t>>> readers(count);  // (reader, input slot)
+            for (NodeId n = 1; n < count; ++n) {
+                for (size_t k = 0; k < nodes[n].inputs.size(); ++k) readers[nodes[n].inputs[k]].emplace_back(n, k);
+            }
+
+            Schedule result(count);
+            for (NodeId n = 0; n < count; ++n) result.flows[n].assign(nodes[n].inputs.size(), Flow::None);
+            for (NodeId n = 1; n + 1 < count; ++n) {
+                if (readers[n].empty()) {
+                    throw std::invalid_argument("Graph node " + std::to_string(n) + " is not read by any later node");
+                }
+                // Backward visits readers from the last one down, each reader's inputs in
+                // order: that first visit writes, the others accumulate
+                for (const auto& [reader, slot] : readers[n]) result.flows[reader][slot] = Flow::Accumulate;
+                size_t first = readers[n].size() - 1;
+                while (first > 0 && readers[n][first - 1].first == readers[n].back().first) --first;
+                const auto& [reader, slot] = readers[n][first];
+                const bool fuses = nodes[n].op == Op::Dense && readers[n].size() == 1 &&
+                                   nodes[n].layer->getActivation()->hasFusedKernels();
+                result.flows[reader][slot] = fuses ? Flow::WriteDelta : Flow::Write;
+                result.delta_from_reader[n] = fuses;
+            }
+
+            // Steps: forward of node n is n, the loss is `count`, backward of node n is 2 count - n
+            const auto backward_step = [count](NodeId n) { return 2 * count - n; };
+            const NodeId last = count - 1;
+            for (NodeId n = 1; n < count; ++n) {
+                const Node<T>& node = nodes[n];
+                size_t read_forward = n;       // Last forward step reading the output
+                size_t read_backward = n;      // Last training step reading the output
+                size_t read16 = n;             // Last step reading the 16-bit copy
+                bool dense_reader = false;
+                bool all_read16 = true;        // Every reader can take the 16-bit copy instead
+                const Precision::Format format =
+                    node.op == Op::Dense ? node.layer->getStorageFormat() : Precision::Format::Native;
+                for (const auto& [reader, slot] : readers[n]) {
+                    (void)slot;
+                    read_forward = std::max(read_forward, reader);
+                    if (nodes[reader].op == Op::Dense) {
+                        // The reader's weight gradient reads its input
+                        read_backward = std::max(read_backward, backward_step(reader));
+                        read16 = std::max(read16, backward_step(reader));
+                        dense_reader = true;
+                        // Sparse kernels read T inputs
+                        const Layer<T>& layer = *nodes[reader].layer;
+                        all_read16 &= !layer.isSparse() && layer.getStorageFormat() == format;
+                    } else {
+                        all_read16 = false;
+                    }
+                }
+                read_backward = std::max(read_backward, read_forward);
+                if (node.op == Op::Dense) read_backward = std::max(read_backward, backward_step(n));
+                if (n == last) read_backward = std::max(read_backward, count);
+
+                // Encoded: the derivative decodes the 16-bit copy in the node's own backward step
+                // or its reader's propagation epilogue, so the T output dies with the forward step
+                const bool low = format != Precision::Format::Native && dense_reader;
+                const bool encoded = low && all_read16 && node.layer->getActivation()->hasFusedKernels();
+                if (encoded) read16 = std::max(read16, backward_step(n));
+
+                const size_t bytes = node.width * sizeof(T);
+                result.training.output[n] = result.training.add(bytes, n, encoded ? n : read_backward);
+                if (n != last) result.inference.output[n] = result.inference.add(bytes, n, read_forward);
+                if (low) {
+                    result.training.output16[n] = result.training.add(node.width * sizeof(uint16_t), n, read16);
+                    result.training.encoded[n] = encoded;
+                }
+                const size_t first_write = n == last ? count : backward_step(readers[n].back().first);
+                result.training.gradient[n] = result.training.add(bytes, first_write, backward_step(n));
+            }
+            result.training.place();
+            result.inference.place();
+            return result;
+        }
+
+        template<typename U>
+        static MatrixView<U> tensor(const Plan& plan, Workspace<T>& ws, size_t index, size_t width) {
+            unsigned char* base = ws.buffer.data() + plan.tensors[index].offset * ws.rows;
+            return MatrixView<U>(reinterpret_cast<U*>(base), ws.rows, width, width);
+        }
+
+        // Output of node n as written by the pass
+        MatrixView<T> outputOf(const Plan& plan, Workspace<T>& ws, NodeId n) const {
+            if (plan.output[n] == Plan::NONE) return ws.result;
+            return tensor<T>(plan, ws, plan.output[n], nodes[n].width);
+        }
+
+        // Output of node n as read by later steps; empty for an encoded node (read value16)
+        MatrixView<const T> value(const Plan& plan, Workspace<T>& ws, NodeId n) const {
+            if (n == input()) return ws.input;
+            if (plan.encoded[n]) return MatrixView<const T>();
+            return outputOf(plan, ws, n);
+        }
+
+        // 16-bit copy of node n for its dense readers, or an empty view
+        MatrixView<const uint16_t> value16(const Plan& plan, Workspace<T>& ws, NodeId n) const {
+            if (plan.output16[n] == Plan::NONE) return MatrixView<const uint16_t>();
+            return tensor<uint16_t>(plan, ws, plan.output16[n], nodes[n].width);
+        }
+
+        MatrixView<T> gradientOf(const Plan& plan, Workspace<T>& ws, NodeId n) const {
+            return tensor<T>(plan, ws, plan.gradient[n], nodes[n].width);
+        }
+
+        // body(lo, hi) over row ranges of a [rows x cols] elementwise operation
+        template<typename Body>
+        static void forRows(size_t rows, size_t cols, const Body& body) {
+            const size_t grain = std::max<size_t>(1, Parallel::ELEMENTWISE_GRAIN / std::max<size_t>(1, cols));
+            Parallel::parallelFor(0, rows, grain, body);
+        }
+
+        void run(const Plan& plan, Workspace<T>& ws) const {
+            for (NodeId n = 1; n < nodes.size(); ++n) {
+                const Node<T>& node = nodes[n];
+                const MatrixView<T> out = outputOf(plan, ws, n);
+                switch (node.op) {
+                    case Op::Dense: {
+                        NN_PROFILE_SCOPE_INDEX("layer", "forward", node.layer_index);
+                        const NodeId from = node.inputs[0];
+                        uint16_t* out16 = plan.output16[n] == Plan::NONE
+                            ? nullptr : tensor<uint16_t>(plan, ws, plan.output16[n], node.width).data();
+                        node.layer->activateInto(value(plan, ws, from), out, value16(plan, ws, from), out16);
+                        break;
+                    }
+                    case Op::Add: {
+                        NN_PROFILE_SCOPE_WORK("op", "add", ws.rows * node.width * (node.inputs.size() - 1),
+                                              ws.rows * node.width * (node.inputs.size() + 1) * sizeof(T));
+                        for (size_t k = 0; k < node.inputs.size(); ++k) {
+                            const MatrixView<const T> in = value(plan, ws, node.inputs[k]);
+                            forRows(ws.rows, node.width, [&](size_t lo, size_t hi) {
+                                for (size_t i = lo; i < hi; ++i) {
+                                    const T* src = in.row(i).data();
+                                    T* dst = out.row(i).data();
+                                    if (k == 0) std::copy(src, src + node.width, dst);
+                                    else for (size_t j = 0; j < node.width; ++j) dst[j] += src[j];
+                                }
+                            });
+                        }
+                        break;
+                    }
+                    case Op::Concat: {
+                        NN_PROFILE_SCOPE_WORK("op", "concat", 0, ws.rows * node.width * 2 * sizeof(T));
+                        size_t offset = 0;
+                        for (NodeId from : node.inputs) {
+                            const MatrixView<const T> in = value(plan, ws, from);
+                            const size_t width = nodes[from].width;
+                            forRows(ws.rows, width, [&](size_t lo, size_t hi) {
+                                for (size_t i = lo; i < hi; ++i) {
+                                    std::copy(in.row(i).data(), in.row(i).data() + width, out.row(i).data() + offset);
+                                }
+                            });
+                            offset += width;
+                        }
+                        break;
+                    }
+                    case Op::Input:
+                        break;
+                }
+            }
+        }
+
+        void backwardNode(const Schedule& current, Workspace<T>& ws, NodeId n, bool delta_ready,
+                          const std::vector<LayerGradients<T>>& grads) const {
+            const Plan& plan = current.training;
+            const Node<T>& node = nodes[n];
+            const MatrixView<T> gradient = gradientOf(plan, ws, n);
+            if (node.op == Op::Dense) {
+                NN_PROFILE_SCOPE_INDEX("layer", "backward", node.layer_index);
+                const Layer<T>& layer = *node.layer;
+                if (!delta_ready && plan.encoded[n]) layer.computeDelta(gradient, value16(plan, ws, n), gradient);
+                else if (!delta_ready) layer.computeDelta(gradient, value(plan, ws, n), gradient);
+                const NodeId from = node.inputs[0];
+                layer.parameterGradients(value(plan, ws, from), value16(plan, ws, from), gradient, grads[node.layer_index]);
+                const Flow flow = current.flows[n][0];
+                if (flow == Flow::None) return;
+                if (flow == Flow::WriteDelta) {
+                    layer.propagate(gradient, gradientOf(plan, ws, from), false,
+                                    nodes[from].layer->getActivation().get(), value(plan, ws, from),
+                                    value16(plan, ws, from));
+                } else {
+                    layer.propagate(gradient, gradientOf(plan, ws, from), flow == Flow::Accumulate);
+                }
+                return;
+            }
+
+            // Add passes its gradient to every input, Concat each input its columns
+            NN_PROFILE_SCOPE_WORK("op", node.op == Op::Add ? "add_backward" : "concat_backward",
+                                  ws.rows * node.width, ws.rows * node.width * 3 * sizeof(T));
+            size_t offset = 0;
+            for (size_t k = 0; k < node.inputs.size(); ++k) {
+                const NodeId from = node.inputs[k];
+                const size_t width = nodes[from].width;
+                const Flow flow = current.flows[n][k];
+                if (flow != Flow::None) {
+                    const MatrixView<const T> source = node.op == Op::Add ? gradient : gradient.block(0, offset, ws.rows, width);
+                    flowInto(plan, ws, from, flow, source);
+                }
+                offset += width;
+            }
+        }
+
+        // Hand a contribution to node `to`'s gradient
+        void flowInto(const Plan& plan, Workspace<T>& ws, NodeId to, Flow flow, MatrixView<const T> source) const {
+            const MatrixView<T> target = gradientOf(plan, ws, to);
+            const size_t width = nodes[to].width;
+            const Activation::ActivationFunction<T>* activation =
+                flow == Flow::WriteDelta ? nodes[to].layer->getActivation().get() : nullptr;
+            const MatrixView<const T> produced = activation ? value(plan, ws, to) : MatrixView<const T>();
+            forRows(ws.rows, width, [&](size_t lo, size_t hi) {
+                for (size_t i = lo; i < hi; ++i) {
+                    const T* src = source.row(i).data();
+                    T* dst = target.row(i).data();
+                    if (activation) activation->backwardFused(src, produced.row(i).data(), dst, width);
+                    else if (flow == Flow::Write) std::copy(src, src + width, dst);
+                    else for (size_t j = 0; j < width; ++j) dst[j] += src[j];
+                }
+            });
+        }
+    };
+}
@@ -2,8 +2,45 @@
 #pragma once
 #include "matrix.hpp"
 #include "activation.hpp"
+#include "arena.hpp"
+#include "optimizer.hpp"
+#include "precision.hpp"
+#include "profiler.hpp"
+#include "sparse.hpp"
+#include <cmath>
 #include <memory>
 
+// Per-pass state of one layer: everything forward() produces that backward() needs
+// Kept outside the Layer so several passes (e.g. one per thread) can share one set of weights
+template<typename T>
+struct LayerCache {
+    MatrixView<const T> input;       // View of the layer input (not copied)
+    Matrix<T> output{0, 0};          // Activated output
+    Matrix<T> delta{0, 0};           // Error terms: error * activation derivative
+
+    // Mixed precision only: 16-bit copies in the layer's storage format
+    MatrixView<const uint16_t> input16;  // Input as stored by the previous layer, read by the GEMMs
+    Matrix<uint16_t> output16{0, 0};     // Output encoded for the next layer
+};
+
+// Parameter gradients of one layer, accumulated separately from the update
+// Views into a gradient arena (see Layer::gradientsIn), so the gradients of a whole
+// network can be reduced and applied as one flat buffer
+template<typename T>
+struct LayerGradients {
+    MatrixView<T> weights;           // dL/dW: [input_size x output_size]
+    MatrixView<T> bias;              // dL/db: [1 x output_size]
+};
+
+// Weight initialization schemes (fan_in = inputs, fan_out = outputs of the layer)
+//   Uniform        U(-1, 1) weights and bias
+//   XavierUniform  U(-a, a), a = sqrt(6 / (fan_in + fan_out)), zero bias   (Glorot & Bengio, 2010)
+//   XavierNormal   N(0, 2 / (fan_in + fan_out)), zero bias
+//   HeUniform      U(-a, a), a = sqrt(6 / fan_in), zero bias             (He et al., 2015)
+//   HeNormal       N(0, 2 / fan_in), zero bias
+// Xavier keeps the activation variance of tanh / sigmoid layers, He that of ReLU layers
+enum class WeightInit { Uniform, XavierUniform, XavierNormal, HeUniform, HeNormal };
+
 // Layer class: Represents a fully connected neural network layer
 // Manages weights, biases, and activation functions for one layer
 template<typename T>
@@ -11,77 +48,585 @@ class Layer {
 private:
     Matrix<T> weights;    // Weight matrix: [input_size x output_size]
     Matrix<T> bias;       // Bias vector: [1 x output_size]
+
+    // Parameters living in memory the layer does not own; `mapping` keeps that memory
+    // alive and weights/bias are empty while it is set. Either read-only (a memory-mapped
+    // checkpoint: the first update copies the values into weights/bias) or a writable
+    // parameter arena (arena_weights/arena_bias set: updates write the arena in place).
+    std::shared_ptr<const void> mapping;
+    MatrixView<const T> mapped_weights;
+    MatrixView<const T> mapped_bias;
+    MatrixView<T> arena_weights;
+    MatrixView<T> arena_bias;
     std::shared_ptr<Activation::ActivationFunction<T>> activation;  // Activation function
-    Matrix<T> input;      // Cached input for backward pass
-    Matrix<T> output;     // Cached output for backward pass
-    Matrix<T> delta;      // Cached error terms for backward pass
+    LayerCache<T> cache;             // State of the most recent forward()/backward() call
+    ParameterArena<T> gradient_storage;  // Backs `gradients`; allocated by the first backward()
+    LayerGradients<T> gradients;     // Gradients of the most recent backward() call
+
+    // Mixed precision: the GEMMs read a 16-bit copy of the weights, refreshed from the
+    // T master weights after every update
+    Precision::Format storage_format = Precision::Format::Native;
+    Matrix<uint16_t> weights16{0, 0};
+
+    // Pruned layers: the nonzero weight blocks, which the forward product reads instead of
+    // the dense weights. The dense weights stay the master copy (zero outside the blocks).
+    Sparse::BlockCsr<T> sparse_weights;
 
 public:
     // Constructor: Initialize layer with specified dimensions and activation
     Layer(size_t input_size, size_t output_size, 
-          std::shared_ptr<Activation::ActivationFunction<T>> act)
+          std::shared_ptr<Activation::ActivationFunction<T>> act, WeightInit init = WeightInit::Uniform)
         : weights(input_size, output_size),
           bias(1, output_size),
-          activation(act),
-          input(1, input_size),      // Cache matrices initialized with proper dimensions
-          output(1, output_size),    // for storing intermediate values during
-          delta(1, output_size)      // forward and backward passes
+          activation(act)
     {
-        // Initialize weights and biases with random values
-        weights.randomize();  // Random initialization helps break symmetry
-        bias.randomize();     // during training
+        // Random initialization helps break symmetry during training
+        initialize(init);
     }
 
-    // Forward propagation through layer
-    // Computes: activation(input * weights + bias)
-    Matrix<T> forward(const Matrix<T>& input) {
-        this->input = input;  // Cache input for backward pass
-        
-        // Compute weighted sum: z = input * weights + bias
-        Matrix<T> z = input.dot(weights);
-        // Add bias to each output neuron
-        for (size_t i = 0; i < z.getRows(); ++i) {
-            for (size_t j = 0; j < z.getCols(); ++j) {
-                z.at(i, j) += bias.at(0, j);
+    // Constructor: Wrap existing parameters without copying them
+    // Weights are [input_size x output_size] and bias [1 x output_size], both contiguous;
+    // owner must keep their memory alive (the layer holds on to it)
+    Layer(MatrixView<const T> borrowed_weights, MatrixView<const T> borrowed_bias,
+          std::shared_ptr<Activation::ActivationFunction<T>> act, std::shared_ptr<const void> owner)
+        : weights(0, 0),
+          bias(0, 0),
+          mapping(std::move(owner)),
+          mapped_weights(borrowed_weights),
+          mapped_bias(borrowed_bias),
+          activation(act)
+    {
+        if (!borrowed_weights.isContiguous() || !borrowed_bias.isContiguous() || borrowed_bias.getRows() != 1 ||
+            borrowed_bias.getCols() != borrowed_weights.getCols()) {
+            throw std::invalid_argument("Borrowed layer parameters have inconsistent shapes");
+        }
+    }
+
+    // Draw new weights and bias with the given scheme from the generator
+    // Borrowed read-only parameters are copied first; a pruned layer keeps its pattern
+    void initialize(WeightInit init, Random::Generator& generator) {
+        ownParameters();
+        const MatrixView<T> w = mutableWeights();
+        const MatrixView<T> b = mutableBias();
+        const size_t count = w.getRows() * w.getCols();
+        const double fan_in = static_cast<double>(w.getRows());
+        const double fan_out = static_cast<double>(w.getCols());
+        switch (init) {
+            case WeightInit::Uniform:
+                generator.fillUniform(w.data(), count, T(-1), T(1));
+                generator.fillUniform(b.data(), b.getCols(), T(-1), T(1));
+                break;
+            case WeightInit::XavierUniform:
+            case WeightInit::HeUniform: {
+                const double fans = init == WeightInit::HeUniform ? fan_in : fan_in + fan_out;
+                const T limit = static_cast<T>(std::sqrt(6.0 / fans));
+                generator.fillUniform(w.data(), count, -limit, limit);
+                std::fill(b.data(), b.data() + b.getCols(), T(0));
+                break;
             }
+            case WeightInit::XavierNormal:
+            case WeightInit::HeNormal: {
+                const double fans = init == WeightInit::HeNormal ? fan_in : fan_in + fan_out;
+                generator.fillNormal(w.data(), count, T(0), static_cast<T>(std::sqrt(2.0 / fans)));
+                std::fill(b.data(), b.data() + b.getCols(), T(0));
+                break;
+            }
+        }
+        refreshWeightCopies();
+    }
+
+    // Same from a stream of its own (Random::nextStream)
+    void initialize(WeightInit init) {
+        Random::Generator generator = Random::nextStream();
+        initialize(init, generator);
+    }
+
+    // Select how weights and cached activations are stored
+    // BFloat16 / Float16 keep the T weights as the master copy that updates apply to,
+    // and give the GEMMs a 16-bit copy to read; products still accumulate in T
+    void setStorageFormat(Precision::Format format) {
+        storage_format = format;
+        if (format == Precision::Format::Native) {
+            weights16.resize(0, 0);
+            return;
+        }
+        const MatrixView<const T> master = getWeights();
+        weights16.resize(master.getRows(), master.getCols());
+        Precision::encode(format, master.data(), weights16.data(), weights16.size());
+    }
+
+    Precision::Format getStorageFormat() const { return storage_format; }
+
+    // Magnitude pruning: zero the fraction `sparsity` of weight blocks (layout's B x 1) with
+    // the smallest norms, then run the forward product on the remaining blocks
+    // Sparsity 0 prunes nothing and stores the blocks that are already nonzero, e.g. of a
+    // pruned network loaded from a checkpoint (a mapped layer is then not copied).
+    // Training keeps the pattern: pruned weights are zeroed again after every update.
+    void prune(double sparsity, Sparse::Layout layout) {
+        if (sparsity > 0.0) {
+            ownParameters();
+            Sparse::prune(mutableWeights(), sparsity, layout);
         }
-        
+        sparse_weights = Sparse::BlockCsr<T>::fromDense(getWeights(), layout);
+        refreshWeightCopies();
+    }
+
+    // Back to dense products; the pruned weights stay zero until training changes them
+    void makeDense() { sparse_weights = Sparse::BlockCsr<T>(); }
+
+    bool isSparse() const { return !sparse_weights.empty(); }
+    const Sparse::BlockCsr<T>& getSparseWeights() const { return sparse_weights; }
+
+    // Forward propagation through layer
+    // Computes: activation(input * weights + bias)
+    // The input is cached as a view, so it must stay alive until backward() runs
+    const Matrix<T>& forward(MatrixView<const T> input, MatrixView<const uint16_t> input16 = {}) {
+        return forward(input, cache, input16);
+    }
+
+    // Forward propagation into caller-owned state; leaves the layer itself untouched
+    // In mixed precision, input16 may hold the same input in this layer's storage format
+    // (the previous layer's output16); the GEMMs then read it instead of `input`
+    const Matrix<T>& forward(MatrixView<const T> input, LayerCache<T>& state,
+                             MatrixView<const uint16_t> input16 = {}) const {
+        state.input = input;  // Cache input view for backward pass
+        const bool low_input = storage_format != Precision::Format::Native &&
+                               input16.getRows() == input.getRows() && input16.getCols() == input.getCols();
+        state.input16 = low_input ? input16 : MatrixView<const uint16_t>();
+
         // Apply activation function and cache result
-        output = activation->forward(z);
-        return output;
+        activateInto(input, state.output, state.input16,
+                     storage_format != Precision::Format::Native ? &state.output16 : nullptr);
+        return state.output;
+    }
+
+    // Inference-only forward pass: same result as forward() but touches no cached state,
+    // so several threads may run it on the same layer at once
+    Matrix<T> infer(MatrixView<const T> input) const {
+        Matrix<T> result(input.getRows(), getWeights().getCols());
+        activateInto(input, result);
+        return result;
+    }
+
+    // infer() into caller-owned memory: out must be [input rows x output size]
+    // Allocates nothing when the activation has fused kernels
+    void infer(MatrixView<const T> input, MatrixView<T> out) const {
+        if (input.getCols() != getWeights().getRows() || out.getRows() != input.getRows() ||
+            out.getCols() != getWeights().getCols()) {
+            throw std::invalid_argument("Layer inference shapes do not match");
+        }
+        activateInto(input, out, {}, nullptr);
     }
 
     // Backward propagation through layer
     // Updates weights and biases, returns propagated error
     Matrix<T> backward(const Matrix<T>& error, T learning_rate) {
-        // Compute local gradient: error * activation_derivative
-        Matrix<T> delta = error.hadamard(activation->backward(output));
-        this->delta = delta;  // Cache for potential later use
+        if (gradient_storage.size() == 0) {
+            gradient_storage = ParameterArena<T>(parameterShapes());
+            gradients = gradientsIn(gradient_storage);
+        }
+        Matrix<T> propagated = backward(error, cache, gradients);
+        applyGradients(gradients, learning_rate);
+        return propagated;
+    }
+
+    // Gradient computation only: writes dL/dW and dL/db for the pass recorded in `state`
+    // and returns the error for the previous layer. Weights are not modified.
+    Matrix<T> backward(const Matrix<T>& error, LayerCache<T>& state, LayerGradients<T>& grads) const {
+        computeDelta(error, state);
+        backwardFromDelta(state, grads);
+
+        // Propagate error to previous layer: delta * weights^T
+        Matrix<T> propagated(state.delta.getRows(), getWeights().getRows());
+        propagate(state.delta, propagated.view());
+        return propagated;
+    }
+
+    // Compute local gradient: delta = error * activation_derivative(output)
+    void computeDelta(const Matrix<T>& error, LayerCache<T>& state) const {
+        if (error.getRows() != state.output.getRows() || error.getCols() != state.output.getCols()) {
+            throw std::invalid_argument("Error shape doesn't match layer output");
+        }
+        state.delta.resize(state.output.getRows(), state.output.getCols());
+        computeDelta(error, state.output, state.delta.view());
+    }
+
+    // Same on caller memory: delta has the output's shape and may be the memory of error,
+    // which then turns into the delta in place
+    void computeDelta(MatrixView<const T> error, MatrixView<const T> output, MatrixView<T> delta) const {
+        const size_t rows = output.getRows();
+        const size_t cols = output.getCols();
+        if (error.getRows() != rows || error.getCols() != cols || delta.getRows() != rows || delta.getCols() != cols) {
+            throw std::invalid_argument("Error shape doesn't match layer output");
+        }
+        NN_PROFILE_SCOPE_WORK("op", "activation_backward", rows * cols * 2, rows * cols * 3 * sizeof(T));
+        if (!activation->hasFusedKernels()) {
+            activation->backwardInto(error, output, delta);
+            return;
+        }
+        // Single pass, no derivative matrix
+        if (error.isContiguous() && output.isContiguous() && delta.isContiguous()) {
+            const T* err = error.data();
+            const T* out = output.data();
+            T* result = delta.data();
+            Parallel::parallelFor(0, rows * cols, Parallel::ELEMENTWISE_GRAIN, [&](size_t lo, size_t hi) {
+                activation->backwardFused(err + lo, out + lo, result + lo, hi - lo);
+            });
+            return;
+        }
+        const size_t grain = std::max<size_t>(1, Parallel::ELEMENTWISE_GRAIN / std::max<size_t>(1, cols));
+        Parallel::parallelFor(0, rows, grain, [&](size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; ++i) {
+                activation->backwardFused(error.row(i).data(), output.row(i).data(), delta.row(i).data(), cols);
+            }
+        });
+    }
+
+    // Same with the output only kept in the storage format, as the compute graph stores hidden
+    // outputs in mixed precision: output16 is decoded a run at a time into the fused derivative
+    void computeDelta(MatrixView<const T> error, MatrixView<const uint16_t> output16, MatrixView<T> delta) const {
+        const size_t rows = output16.getRows();
+        const size_t cols = output16.getCols();
+        if (error.getRows() != rows || error.getCols() != cols || delta.getRows() != rows || delta.getCols() != cols) {
+            throw std::invalid_argument("Error shape doesn't match layer output");
+        }
+        if (storage_format == Precision::Format::Native || !activation->hasFusedKernels()) {
+            throw std::invalid_argument("A 16-bit output needs mixed precision and an activation with fused kernels");
+        }
+        NN_PROFILE_SCOPE_WORK("op", "activation_backward", rows * cols * 2,
+                              rows * cols * (2 * sizeof(T) + sizeof(uint16_t)));
+        const Precision::Decoder<T> decode = Precision::decoder<T>(storage_format);
+        const size_t grain = std::max<size_t>(1, Parallel::ELEMENTWISE_GRAIN / std::max<size_t>(1, cols));
+        Parallel::parallelFor(0, rows, grain, [&](size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; ++i) {
+                backwardEncoded(*activation, decode, error.row(i).data(), output16.row(i).data(), delta.row(i).data(),
+                                cols);
+            }
+        });
+    }
+
+    // Gradients from the delta already stored in `state`
+    // When the previous layer is given, its delta is produced directly by the
+    // propagation GEMM, with that layer's activation derivative fused into the epilogue
+    void backwardFromDelta(LayerCache<T>& state, LayerGradients<T>& grads,
+                           const Layer<T>* previous = nullptr, LayerCache<T>* previous_state = nullptr) const {
+        parameterGradients(state.input, state.input16, state.delta, grads);
+        if (!previous) return;
+
+        const Activation::ActivationFunction<T>& previous_activation = *previous->activation;
+        previous_state->delta.resize(state.delta.getRows(), getWeights().getRows());
+        if (!previous_activation.hasFusedKernels()) {
+            propagate(state.delta, previous_state->delta.view());
+            previous->computeDelta(previous_state->delta, previous_state->output, previous_state->delta.view());
+            return;
+        }
+        propagate(state.delta, previous_state->delta.view(), false, &previous_activation, previous_state->output);
+    }
+
+    // Parameter gradients of a pass: dL/dW = input^T * delta and dL/db = column sums of delta
+    // In mixed precision, input16 (if not empty) is read in place of input
+    void parameterGradients(MatrixView<const T> input, MatrixView<const uint16_t> input16, MatrixView<const T> delta,
+                            const LayerGradients<T>& grads) const {
+        // Compute weight gradients: input^T * delta, read in place without a transpose copy
+        multiply(input, input16, delta, {}, grads.weights, Gemm::Transpose::Yes, Gemm::Transpose::No);
 
-        // Compute weight gradients
-        Matrix<T> weights_gradient = input.transpose().dot(delta);
-        
         // Compute bias gradients (sum error terms for each output neuron)
-        Matrix<T> bias_gradient(1, bias.getCols());
+        biasGradient(delta, grads.bias);
+    }
+
+    // Error for the layer input: out = delta * weights^T, or out += delta * weights^T with
+    // accumulate set (an input read by several layers)
+    // Given the activation that produced the input and its output, the epilogue applies that
+    // activation's derivative to each finished tile, so out receives the producing layer's
+    // delta without another pass; the activation should have fused kernels
+    // With producer_output empty, the epilogue decodes producer_output16, the output as
+    // stored in this layer's storage format (the input16 of the forward pass)
+    void propagate(MatrixView<const T> delta, MatrixView<T> out, bool accumulate = false,
+                   const Activation::ActivationFunction<T>* producer = nullptr,
+                   MatrixView<const T> producer_output = {},
+                   MatrixView<const uint16_t> producer_output16 = {}) const {
+        if (!producer) {
+            multiply(delta, {}, getWeights(), lowWeights(), out, Gemm::Transpose::No, Gemm::Transpose::Yes, nullptr,
+                     accumulate);
+            return;
+        }
+        const bool encoded = producer_output.data() == nullptr;
+        const size_t produced_rows = encoded ? producer_output16.getRows() : producer_output.getRows();
+        const size_t produced_cols = encoded ? producer_output16.getCols() : producer_output.getCols();
+        const size_t produced_stride = encoded ? producer_output16.colStride() : producer_output.colStride();
+        if (produced_rows != out.getRows() || produced_cols != out.getCols() || produced_stride != 1) {
+            throw std::invalid_argument("Producer output doesn't match the propagated error");
+        }
+        if (encoded && storage_format == Precision::Format::Native) {
+            throw std::invalid_argument("A 16-bit producer output needs mixed precision");
+        }
+
+        // out = (delta * weights^T) * producer'(producer_output)
+        struct Context {
+            const Activation::ActivationFunction<T>* activation;
+            MatrixView<const T> output;
+            MatrixView<const uint16_t> output16;
+            Precision::Decoder<T> decode;
+        } context{producer, producer_output, producer_output16, encoded ? Precision::decoder<T>(storage_format) : nullptr};
+        Gemm::Epilogue<T> epilogue;
+        epilogue.context = &context;
+        epilogue.apply = [](const void* raw, T* tile, size_t ldc, size_t row, size_t col, size_t rows, size_t cols) {
+            const auto* ctx = static_cast<const Context*>(raw);
+            for (size_t i = 0; i < rows; ++i) {
+                T* values = tile + i * ldc;
+                if (ctx->decode) {
+                    backwardEncoded(*ctx->activation, ctx->decode, values, &ctx->output16.at(row + i, col), values, cols);
+                } else {
+                    ctx->activation->backwardFused(values, &ctx->output.at(row + i, col), values, cols);
+                }
+            }
+        };
+        multiply(delta, {}, getWeights(), lowWeights(), out, Gemm::Transpose::No, Gemm::Transpose::Yes, &epilogue,
+                 accumulate);
+    }
+
+    // Update weights and bias using gradient descent, in place
+    // In mixed precision the update goes to the T master weights, then the 16-bit copy is refreshed
+    // Networks update all layers at once through their parameter arena and an optimizer;
+    // this per-layer step serves backward(error, learning_rate)
+    void applyGradients(const LayerGradients<T>& grads, T learning_rate) {
+        ownParameters();
+        const MatrixView<T> w = mutableWeights();
+        const MatrixView<T> b = mutableBias();
+        Optim::SGD<T> sgd;
+        sgd.step(w.data(), grads.weights.data(), w.getRows() * w.getCols(), learning_rate);
+        sgd.step(b.data(), grads.bias.data(), b.getCols(), learning_rate);
+        refreshWeightCopies();
+    }
+
+    // Update the weight copies the products read after the master weights changed outside
+    // applyGradients (an optimizer step over the parameter arena): re-zero pruned weights
+    // and re-read the sparse blocks, then re-encode the 16-bit copy
+    void refreshWeightCopies() {
+        if (isSparse()) {
+            if (isMapped()) return;  // Read-only weights have not changed
+            sparse_weights.refresh(mutableWeights());
+        }
+        if (storage_format == Precision::Format::Native) return;
+        const MatrixView<const T> master = getWeights();
+        Precision::encode(storage_format, master.data(), weights16.data(), weights16.size());
+    }
+
+    // Shapes of the parameter tensors, in arena order: weights, then bias
+    std::vector<typename ParameterArena<T>::Shape> parameterShapes() const {
+        return {{getWeights().getRows(), getWeights().getCols()}, {1, getBias().getCols()}};
+    }
+
+    // Move the parameters into caller-provided memory, e.g. tensors of a network-wide
+    // ParameterArena laid out by parameterShapes(). The current values are copied over and
+    // from then on read and updated in place there; owner must keep the memory alive.
+    void bindParameters(MatrixView<T> new_weights, MatrixView<T> new_bias, std::shared_ptr<const void> owner) {
+        const MatrixView<const T> current_weights = getWeights();
+        const MatrixView<const T> current_bias = getBias();
+        if (!new_weights.isContiguous() || !new_bias.isContiguous() ||
+            new_weights.getRows() != current_weights.getRows() || new_weights.getCols() != current_weights.getCols() ||
+            new_bias.getRows() != 1 || new_bias.getCols() != current_bias.getCols()) {
+            throw std::invalid_argument("Bound parameters do not match the layer shape");
+        }
+        if (new_weights.data() != current_weights.data()) {
+            std::copy(current_weights.data(), current_weights.data() + new_weights.getRows() * new_weights.getCols(),
+                      new_weights.data());
+            std::copy(current_bias.data(), current_bias.data() + new_bias.getCols(), new_bias.data());
+        }
+        mapping = std::move(owner);
+        mapped_weights = new_weights;
+        mapped_bias = new_bias;
+        arena_weights = new_weights;
+        arena_bias = new_bias;
+        weights = Matrix<T>(0, 0);
+        bias = Matrix<T>(0, 0);
+    }
+
+    // Reserve the cache buffers for batches of up to max_rows rows
+    // Afterwards forward/backward passes of that size reuse the buffers without allocating
+    void reserveCache(LayerCache<T>& state, size_t max_rows) const {
+        state.output.reserve(max_rows, getWeights().getCols());
+        state.delta.reserve(max_rows, getWeights().getCols());
+        if (storage_format != Precision::Format::Native) {
+            state.output16.reserve(max_rows, getWeights().getCols());
+        }
+    }
+
+    // Gradient views onto tensors first and first + 1 of an arena laid out by parameterShapes()
+    LayerGradients<T> gradientsIn(ParameterArena<T>& arena, size_t first = 0) const {
+        LayerGradients<T> grads{arena.tensor(first), arena.tensor(first + 1)};
+        if (grads.weights.getRows() != getWeights().getRows() || grads.weights.getCols() != getWeights().getCols() ||
+            grads.bias.getRows() != 1 || grads.bias.getCols() != getBias().getCols()) {
+            throw std::invalid_argument("Gradient arena does not match the layer shape");
+        }
+        return grads;
+    }
+
+    // Compute activation(input * weights + bias) into `out`, resizing it
+    // In mixed precision, input16 (if not empty) replaces input as the GEMM operand and
+    // out16 receives the result encoded in the storage format
+    void activateInto(MatrixView<const T> input, Matrix<T>& out,
+                      MatrixView<const uint16_t> input16 = {}, Matrix<uint16_t>* out16 = nullptr) const {
+        out.resize(input.getRows(), getWeights().getCols());
+        if (out16) out16->resize(input.getRows(), getWeights().getCols());
+        activateInto(input, out.view(), input16, out16 ? out16->data() : nullptr);
+    }
+
+    // Same into a view of the right shape; out16, if given, is a contiguous [rows x outputs] buffer
+    // With input16 given, input may be empty unless the layer is sparse
+    // Activations with fused kernels apply bias and activation to each GEMM tile while it is
+    // still in cache; others fall back to separate weighted-sum and activation passes
+    void activateInto(MatrixView<const T> input, MatrixView<T> out,
+                      MatrixView<const uint16_t> input16, uint16_t* out16) const {
+        const Precision::Encoder<T> encode = Precision::encoder<T>(storage_format);
+        const size_t cols = getWeights().getCols();
+        if (!activation->hasFusedKernels()) {
+            Matrix<T> z = weightedSum(input, input16);
+            NN_PROFILE_SCOPE_WORK("op", "activation", z.size(), 2 * z.size() * sizeof(T));
+            Matrix<T> activated = activation->forward(z);
+            for (size_t i = 0; i < activated.getRows(); ++i) {
+                const T* row = activated.row(i).data();
+                std::copy(row, row + cols, out.row(i).data());
+                if (out16 && encode) encode(row, out16 + i * cols, cols);
+            }
+            return;
+        }
+
+        struct Context {
+            const Activation::ActivationFunction<T>* activation;
+            const T* bias;
+            Precision::Encoder<T> encode;
+            uint16_t* out16;
+            size_t ld16;
+        } context{activation.get(), getBias().data(), encode, encode ? out16 : nullptr, cols};
+        Gemm::Epilogue<T> epilogue;
+        epilogue.context = &context;
+        epilogue.apply = [](const void* raw, T* tile, size_t ldc, size_t row, size_t col, size_t rows, size_t cols) {
+            const auto* ctx = static_cast<const Context*>(raw);
+            for (size_t i = 0; i < rows; ++i) {
+                ctx->activation->forwardFused(tile + i * ldc, ctx->bias + col, cols);
+                if (ctx->out16) ctx->encode(tile + i * ldc, ctx->out16 + (row + i) * ctx->ld16 + col, cols);
+            }
+        };
+        weightProduct(input, input16, out, &epilogue);
+    }
+
+    // Compute weighted sum: z = input * weights + bias
+    Matrix<T> weightedSum(MatrixView<const T> input, MatrixView<const uint16_t> input16 = {}) const {
+        Matrix<T> z(input16.data() ? input16.getRows() : input.getRows(), getWeights().getCols());
+        weightProduct(input, input16, z.view());
+        // Add bias to each output neuron
+        NN_PROFILE_SCOPE_WORK("op", "bias", z.size(), 2 * z.size() * sizeof(T));
+        for (size_t i = 0; i < z.getRows(); ++i) {
+            for (size_t j = 0; j < z.getCols(); ++j) {
+                z.at(i, j) += getBias().at(0, j);
+            }
+        }
+        return z;
+    }
+
+    // Accessor methods for layer components
+    MatrixView<const T> getWeights() const { return mapping ? mapped_weights : weights.view(); }
+    MatrixView<const T> getBias() const { return mapping ? mapped_bias : bias.view(); }
+    // True while the parameters are borrowed read-only (see the wrapping constructor)
+    bool isMapped() const { return mapping != nullptr && arena_weights.data() == nullptr; }
+    // True while the parameters live in an arena (see bindParameters)
+    bool isBound() const { return arena_weights.data() != nullptr; }
+    const std::shared_ptr<Activation::ActivationFunction<T>>& getActivation() const { return activation; }
+    const Matrix<T>& getOutput() const { return cache.output; }
+    const Matrix<T>& getDelta() const { return cache.delta; }
+    const LayerCache<T>& getCache() const { return cache; }
+
+private:
+    // Bias gradient: column sums of delta into out [1 x outputs]
+    static void biasGradient(MatrixView<const T> delta, MatrixView<T> out) {
+        NN_PROFILE_SCOPE_WORK("op", "bias_gradient", delta.getRows() * delta.getCols(),
+                              (delta.getRows() + 1) * delta.getCols() * sizeof(T));
         for (size_t j = 0; j < delta.getCols(); ++j) {
             T sum = 0;
             for (size_t i = 0; i < delta.getRows(); ++i) {
                 sum += delta.at(i, j);
             }
-            bias_gradient.at(0, j) = sum;
+            out.at(0, j) = sum;
         }
+    }
+
+    // Copy-on-write: borrowed read-only parameters are copied into owned matrices before
+    // anything writes to them
+    void ownParameters() {
+        if (isMapped()) {
+            weights = Matrix<T>(mapped_weights);
+            bias = Matrix<T>(mapped_bias);
+            mapping.reset();
+        }
+    }
 
-        // Update weights and bias using gradient descent
-        weights = weights - weights_gradient * learning_rate;
-        bias = bias - bias_gradient * learning_rate;
+    // Writable parameters: the arena tensors when bound, otherwise the owned matrices
+    MatrixView<T> mutableWeights() { return isBound() ? arena_weights : weights.view(); }
+    MatrixView<T> mutableBias() { return isBound() ? arena_bias : bias.view(); }
 
-        // Propagate error to previous layer
-        return delta.dot(weights.transpose());
+    // delta = error * activation'(y) for one row segment whose y is stored in a 16-bit format,
+    // decoded a run at a time; error and delta may point to the same memory
+    static void backwardEncoded(const Activation::ActivationFunction<T>& act, Precision::Decoder<T> decode,
+                                const T* error, const uint16_t* output16, T* delta, size_t count) {
+        constexpr size_t RUN = 256;
+        T output[RUN];
+        for (size_t j = 0; j < count; j += RUN) {
+            const size_t n = std::min(RUN, count - j);
+            decode(output16 + j, output, n);
+            act.backwardFused(error + j, output, delta + j, n);
+        }
     }
 
-    // Accessor methods for layer components
-    const Matrix<T>& getWeights() const { return weights; }
-    const Matrix<T>& getBias() const { return bias; }
-    const Matrix<T>& getOutput() const { return output; }
-    const Matrix<T>& getDelta() const { return delta; }
+    // 16-bit weights when mixed precision is on, otherwise an empty view
+    MatrixView<const uint16_t> lowWeights() const {
+        return storage_format == Precision::Format::Native ? MatrixView<const uint16_t>() : weights16.view();
+    }
+
+    // out = input * weights through the sparse blocks of a pruned layer, otherwise the GEMM
+    // (reading input16 / the 16-bit weights in mixed precision)
+    void weightProduct(MatrixView<const T> input, MatrixView<const uint16_t> input16, MatrixView<T> out,
+                       const Gemm::Epilogue<T>* epilogue = nullptr) const {
+        if (isSparse()) {
+            if (input.data() == nullptr && input16.data() != nullptr) {
+                throw std::invalid_argument("Sparse layers read their input in T");
+            }
+            sparse_weights.multiply(input, out, epilogue);
+            return;
+        }
+        multiply(input, input16, getWeights(), lowWeights(), out, Gemm::Transpose::No, Gemm::Transpose::No, epilogue);
+    }
+
+    // out = op(a) * op(b) (out += with accumulate) where either operand may come as a
+    // 16-bit copy in the storage format
+    // An empty 16-bit view means that operand is read from its T view
+    void multiply(MatrixView<const T> a, MatrixView<const uint16_t> a16,
+                  MatrixView<const T> b, MatrixView<const uint16_t> b16, MatrixView<T> out,
+                  Gemm::Transpose trans_a, Gemm::Transpose trans_b,
+                  const Gemm::Epilogue<T>* epilogue = nullptr, bool accumulate = false) const {
+        switch (storage_format) {
+            case Precision::Format::BFloat16:
+                multiplyAs<Precision::BFloat16>(a, a16, b, b16, out, trans_a, trans_b, epilogue, accumulate);
+                break;
+            case Precision::Format::Float16:
+                multiplyAs<Precision::Float16>(a, a16, b, b16, out, trans_a, trans_b, epilogue, accumulate);
+                break;
+            default:
+                a.dotInto(b, out, trans_a, trans_b, epilogue, accumulate);
+        }
+    }
+
+    template<typename Codec>
+    static void multiplyAs(MatrixView<const T> a, MatrixView<const uint16_t> a16,
+                           MatrixView<const T> b, MatrixView<const uint16_t> b16, MatrixView<T> out,
+                           Gemm::Transpose trans_a, Gemm::Transpose trans_b, const Gemm::Epilogue<T>* epilogue,
+                           bool accumulate) {
+        using Native = Precision::Native<T>;
+        const bool low_a = a16.data() != nullptr;
+        const bool low_b = b16.data() != nullptr;
+        if (low_a && low_b) multiplyInto<Codec, Codec>(a16, b16, out, trans_a, trans_b, epilogue, accumulate);
+        else if (low_a) multiplyInto<Codec, Native>(a16, b, out, trans_a, trans_b, epilogue, accumulate);
+        else if (low_b) multiplyInto<Native, Codec>(a, b16, out, trans_a, trans_b, epilogue, accumulate);
+        else multiplyInto<Native, Native>(a, b, out, trans_a, trans_b, epilogue, accumulate);
+    }
 };
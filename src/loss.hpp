@@ -1,46 +1,438 @@
-
 #pragma once
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include "activation.hpp"
 #include "matrix.hpp"
+#include "memory.hpp"
+#include "thread_pool.hpp"
+#include "vector_math.hpp"
 
+// Loss functions
+//
+// Besides calculate() and derivative(), every loss offers lossAndGradient(): the loss value
+// and its gradient from a single pass over predictions and targets. The pass walks the data
+// in chunks of detail::CHUNK elements: it writes the chunk's gradient, collects the chunk's
+// per-element loss terms in a buffer that stays in L1, and sums them pairwise. Chunk sums
+// are accumulated with compensation, then combined per reduction block by
+// Parallel::parallelSum, so the loss stays accurate on wide outputs and is identical for
+// any thread count.
+//
+// Where the gradient cancels against the output activation's derivative, lossAndDelta()
+// returns the gradient with respect to the activation's input instead:
+//   BinaryCrossEntropy after Sigmoid   (y - t) / n
+//   CrossEntropy after Softmax         (y - t) / rows
+// so training writes the output layer's delta directly and skips the activation backward.
 namespace Loss {
+    namespace detail {
+        // Elements per chunk of a fused loss pass
+        constexpr size_t CHUNK = 256;
+
+        // Pairwise sum of terms[0, count) for count <= CHUNK; overwrites terms
+        // The halving loop vectorizes, and the rounding error grows with log2(count)
+        template<typename T>
+        T pairwiseSum(T* terms, size_t count) {
+            if (count == 0) return 0;
+            size_t width = 1;
+            while (width < count) width *= 2;
+            std::fill(terms + count, terms + width, T(0));
+            for (width /= 2; width > 0; width /= 2) {
+                for (size_t i = 0; i < width; ++i) terms[i] += terms[i + width];
+            }
+            return terms[0];
+        }
+
+        // Sum of the loss terms of elements [0, count)
+        // chunk(first, n, terms) handles elements [first, first + n) and writes their n terms
+        template<typename T, typename Chunk>
+        T chunkedSum(size_t count, const Chunk& chunk) {
+            return Parallel::parallelSum<T>(count, [&](size_t lo, size_t hi) {
+                alignas(Memory::CACHE_LINE) T terms[CHUNK];
+                Parallel::CompensatedSum<T> sum;
+                for (size_t first = lo; first < hi; first += CHUNK) {
+                    const size_t n = std::min(CHUNK, hi - first);
+                    chunk(first, n, terms);
+                    sum.add(pairwiseSum(terms, n));
+                }
+                return sum.value();
+            });
+        }
+
+        // Smallest argument passed to log(): keeps loss terms finite when a probability is 0
+        template<typename T>
+        constexpr T LOG_FLOOR = std::numeric_limits<T>::min();
+
+        // Probabilities are clamped to [GRADIENT_FLOOR, 1 - GRADIENT_FLOOR] where a gradient
+        // divides by them
+        template<typename T>
+        constexpr T GRADIENT_FLOOR = std::numeric_limits<T>::epsilon();
+    }
+
     // Base class for loss functions
     // Defines interface for loss calculation and derivatives
     template<typename T>
     class LossFunction {
     public:
         // Calculate loss value between predicted and expected outputs
-        virtual T calculate(const Matrix<T>& predicted, const Matrix<T>& expected) const = 0;
-        
+        // Views let callers pass row slices of a larger batch without copying
+        virtual T calculate(MatrixView<const T> predicted, MatrixView<const T> expected) const = 0;
+
         // Calculate loss derivative for backpropagation
-        virtual Matrix<T> derivative(const Matrix<T>& predicted, const Matrix<T>& expected) const = 0;
-        
+        virtual Matrix<T> derivative(MatrixView<const T> predicted, MatrixView<const T> expected) const = 0;
+
+        // Derivative scaled by `scale`, written into a caller-owned matrix
+        // Losses override this to reuse out's allocation; the default goes through derivative()
+        virtual void derivativeInto(MatrixView<const T> predicted, MatrixView<const T> expected,
+                                    Matrix<T>& out, T scale = 1) const {
+            out = derivative(predicted, expected);
+            if (scale != 1) out *= scale;
+        }
+
+        // Loss times `scale`, with the derivative times `scale` written into `gradient`, which is
+        // caller memory shaped like predicted (e.g. a network workspace tensor)
+        // Losses override this with a single pass; the default makes two
+        virtual T lossAndGradient(MatrixView<const T> predicted, MatrixView<const T> expected,
+                                  MatrixView<T> gradient, T scale = 1) const {
+            checkGradient(predicted, gradient);
+            Matrix<T> derivative_values(0, 0);
+            derivativeInto(predicted, expected, derivative_values, scale);
+            for (size_t i = 0; i < gradient.getRows(); ++i) {
+                std::copy(derivative_values.row(i).data(), derivative_values.row(i).data() + gradient.getCols(),
+                          gradient.row(i).data());
+            }
+            return calculate(predicted, expected) * scale;
+        }
+
+        // Same into a matrix, resized like predicted
+        T lossAndGradient(MatrixView<const T> predicted, MatrixView<const T> expected,
+                          Matrix<T>& gradient, T scale = 1) const {
+            gradient.resize(predicted.getRows(), predicted.getCols());
+            return lossAndGradient(predicted, expected, gradient.view(), scale);
+        }
+
+        // True when lossAndDelta() can differentiate through `activation` on the output layer
+        virtual bool fusesActivation(const Activation::ActivationFunction<T>& activation) const {
+            (void)activation;
+            return false;
+        }
+
+        // Like lossAndGradient(), but `delta` receives the gradient with respect to the input
+        // of the output activation, whose derivative cancels in closed form
+        // predicted is the activation's output; throws unless fusesActivation(activation)
+        virtual T lossAndDelta(const Activation::ActivationFunction<T>& activation, MatrixView<const T> predicted,
+                               MatrixView<const T> expected, MatrixView<T> delta, T scale = 1) const {
+            (void)predicted;
+            (void)expected;
+            (void)delta;
+            (void)scale;
+            throw std::invalid_argument(std::string("Loss cannot differentiate through the ") +
+                                        (activation.name() ? activation.name() : "given") + " activation");
+        }
+
+        // Same into a matrix, resized like predicted
+        T lossAndDelta(const Activation::ActivationFunction<T>& activation, MatrixView<const T> predicted,
+                       MatrixView<const T> expected, Matrix<T>& delta, T scale = 1) const {
+            delta.resize(predicted.getRows(), predicted.getCols());
+            return lossAndDelta(activation, predicted, expected, delta.view(), scale);
+        }
+
+        // Identifier stored in checkpoints (see create()); nullptr for losses that cannot be saved
+        virtual const char* name() const { return nullptr; }
+
         virtual ~LossFunction() = default;
+
+    protected:
+        static void checkShapes(MatrixView<const T> predicted, MatrixView<const T> expected) {
+            if (predicted.getRows() != expected.getRows() || predicted.getCols() != expected.getCols()) {
+                throw std::invalid_argument("Matrix dimensions don't match for loss calculation");
+            }
+        }
+
+        // Shape check for a fused pass; false when the views must be copied to contiguous
+        // matrices first
+        static bool readyForPass(MatrixView<const T> predicted, MatrixView<const T> expected) {
+            checkShapes(predicted, expected);
+            return predicted.isContiguous() && expected.isContiguous();
+        }
+
+        // Size `out` like predicted and return its storage
+        static T* gradientStorage(MatrixView<const T> predicted, Matrix<T>& out) {
+            out.resize(predicted.getRows(), predicted.getCols());
+            return out.data();
+        }
+
+        static void checkGradient(MatrixView<const T> predicted, MatrixView<T> gradient) {
+            if (gradient.getRows() != predicted.getRows() || gradient.getCols() != predicted.getCols() ||
+                gradient.colStride() != 1) {
+                throw std::invalid_argument("Gradient output doesn't match the predictions");
+            }
+        }
+
+        // Storage of a caller-provided gradient for a fused pass, which writes it contiguously
+        static T* gradientStorage(MatrixView<const T> predicted, MatrixView<T> gradient) {
+            checkGradient(predicted, gradient);
+            if (!gradient.isContiguous()) {
+                throw std::invalid_argument("Loss gradient output must be contiguous");
+            }
+            return gradient.data();
+        }
     };
 
     // Mean Squared Error (MSE) loss function
     // L = 1/n * Σ(y - ŷ)²
     template<typename T>
     class MSE : public LossFunction<T> {
+        using Base = LossFunction<T>;
+
     public:
+        using Base::lossAndGradient;
+
+        const char* name() const override { return "mse"; }
+
         // Calculate MSE loss
         // Average squared difference between predicted and expected values
-        T calculate(const Matrix<T>& predicted, const Matrix<T>& expected) const override {
-            T sum = 0;
-            for (size_t i = 0; i < predicted.getRows(); ++i) {
-                for (size_t j = 0; j < predicted.getCols(); ++j) {
-                    T diff = predicted.at(i, j) - expected.at(i, j);
-                    sum += diff * diff;  // Square the difference
-                }
-            }
-            // Return average error across all elements
-            return sum / (predicted.getRows() * predicted.getCols());
+        // Summed in fixed-size blocks, so the result is identical for any thread count
+        T calculate(MatrixView<const T> predicted, MatrixView<const T> expected) const override {
+            if (!Base::readyForPass(predicted, expected)) return calculate(Matrix<T>(predicted), Matrix<T>(expected));
+            return pass(predicted, expected, nullptr, 0) / elements(predicted);
         }
 
         // Calculate MSE derivative
         // d/dx(MSE) = 2/n * (predicted - expected)
-        Matrix<T> derivative(const Matrix<T>& predicted, const Matrix<T>& expected) const override {
+        Matrix<T> derivative(MatrixView<const T> predicted, MatrixView<const T> expected) const override {
+            Matrix<T> result(0, 0);
+            derivativeInto(predicted, expected, result);
+            return result;
+        }
+
+        // MSE derivative times `scale`, computed in one pass into `out`
+        void derivativeInto(MatrixView<const T> predicted, MatrixView<const T> expected,
+                            Matrix<T>& out, T scale = 1) const override {
+            if (!Base::readyForPass(predicted, expected)) {
+                derivativeInto(Matrix<T>(predicted), Matrix<T>(expected), out, scale);
+                return;
+            }
             // Compute element-wise difference and scale by 2/n
-            return (predicted - expected) * (2.0 / (predicted.getRows() * predicted.getCols()));
+            const T factor = scale * T(2) / elements(predicted);
+            const T* p = predicted.data();
+            const T* e = expected.data();
+            T* result = Base::gradientStorage(predicted, out);
+            Parallel::parallelFor(0, out.size(), Parallel::ELEMENTWISE_GRAIN, [&](size_t lo, size_t hi) {
+                for (size_t i = lo; i < hi; ++i) {
+                    result[i] = (p[i] - e[i]) * factor;
+                }
+            });
+        }
+
+        // Loss and derivative, both times `scale`, from one pass
+        T lossAndGradient(MatrixView<const T> predicted, MatrixView<const T> expected,
+                          MatrixView<T> gradient, T scale = 1) const override {
+            if (!Base::readyForPass(predicted, expected)) {
+                return lossAndGradient(Matrix<T>(predicted), Matrix<T>(expected), gradient, scale);
+            }
+            T* out = Base::gradientStorage(predicted, gradient);
+            return pass(predicted, expected, out, scale * T(2) / elements(predicted)) * scale / elements(predicted);
+        }
+
+    private:
+        static T elements(MatrixView<const T> m) { return static_cast<T>(m.getRows() * m.getCols()); }
+
+        // Sum of squared differences; also writes (p - e) * factor into gradient unless it is null
+        static T pass(MatrixView<const T> predicted, MatrixView<const T> expected, T* gradient, T factor) {
+            const T* p = predicted.data();
+            const T* e = expected.data();
+            return detail::chunkedSum<T>(predicted.getRows() * predicted.getCols(), [&](size_t first, size_t n, T* terms) {
+                const T* y = p + first;
+                const T* t = e + first;
+                if (gradient) {
+                    for (size_t j = 0; j < n; ++j) gradient[first + j] = (y[j] - t[j]) * factor;
+                }
+                for (size_t j = 0; j < n; ++j) {
+                    const T diff = y[j] - t[j];
+                    terms[j] = diff * diff;  // Square the difference
+                }
+            });
+        }
+    };
+
+    // Binary cross-entropy: independent probabilities y in [0, 1] against targets t in [0, 1]
+    // L = -1/n * Σ(t log(y) + (1 - t) log(1 - y))
+    // After a Sigmoid output layer, dL/dz = (y - t) / n: the y(1 - y) of the sigmoid
+    // derivative cancels, so lossAndDelta() skips it (and its saturation) entirely
+    template<typename T>
+    class BinaryCrossEntropy : public LossFunction<T> {
+        using Base = LossFunction<T>;
+
+    public:
+        using Base::lossAndGradient;
+        using Base::lossAndDelta;
+
+        const char* name() const override { return "bce"; }
+
+        T calculate(MatrixView<const T> predicted, MatrixView<const T> expected) const override {
+            if (!Base::readyForPass(predicted, expected)) return calculate(Matrix<T>(predicted), Matrix<T>(expected));
+            return pass(predicted, expected, nullptr, 0, false) / elements(predicted);
+        }
+
+        // dL/dy = (y - t) / (y (1 - y)) / n, with y clamped away from 0 and 1 in the denominator
+        Matrix<T> derivative(MatrixView<const T> predicted, MatrixView<const T> expected) const override {
+            Matrix<T> result(0, 0);
+            lossAndGradient(predicted, expected, result);
+            return result;
+        }
+
+        void derivativeInto(MatrixView<const T> predicted, MatrixView<const T> expected,
+                            Matrix<T>& out, T scale = 1) const override {
+            lossAndGradient(predicted, expected, out, scale);
+        }
+
+        T lossAndGradient(MatrixView<const T> predicted, MatrixView<const T> expected,
+                          MatrixView<T> gradient, T scale = 1) const override {
+            if (!Base::readyForPass(predicted, expected)) {
+                return lossAndGradient(Matrix<T>(predicted), Matrix<T>(expected), gradient, scale);
+            }
+            T* out = Base::gradientStorage(predicted, gradient);
+            return pass(predicted, expected, out, scale / elements(predicted), false) * scale / elements(predicted);
+        }
+
+        bool fusesActivation(const Activation::ActivationFunction<T>& activation) const override {
+            return dynamic_cast<const Activation::Sigmoid<T>*>(&activation) != nullptr;
+        }
+
+        T lossAndDelta(const Activation::ActivationFunction<T>& activation, MatrixView<const T> predicted,
+                       MatrixView<const T> expected, MatrixView<T> delta, T scale = 1) const override {
+            if (!fusesActivation(activation)) return Base::lossAndDelta(activation, predicted, expected, delta, scale);
+            if (!Base::readyForPass(predicted, expected)) {
+                return lossAndDelta(activation, Matrix<T>(predicted), Matrix<T>(expected), delta, scale);
+            }
+            T* out = Base::gradientStorage(predicted, delta);
+            return pass(predicted, expected, out, scale / elements(predicted), true) * scale / elements(predicted);
+        }
+
+    private:
+        static T elements(MatrixView<const T> m) { return static_cast<T>(m.getRows() * m.getCols()); }
+
+        // Sum of the per-element losses; also writes the gradient times factor unless it is null,
+        // with respect to the sigmoid's input when through_sigmoid is set
+        static T pass(MatrixView<const T> predicted, MatrixView<const T> expected, T* gradient, T factor,
+                      bool through_sigmoid) {
+            const T* p = predicted.data();
+            const T* e = expected.data();
+            return detail::chunkedSum<T>(predicted.getRows() * predicted.getCols(), [&](size_t first, size_t n, T* terms) {
+                const T* y = p + first;
+                const T* t = e + first;
+                if (gradient && through_sigmoid) {
+                    for (size_t j = 0; j < n; ++j) gradient[first + j] = (y[j] - t[j]) * factor;
+                } else if (gradient) {
+                    const T lo = detail::GRADIENT_FLOOR<T>;
+                    for (size_t j = 0; j < n; ++j) {
+                        const T clamped = std::min(std::max(y[j], lo), T(1) - lo);
+                        gradient[first + j] = (y[j] - t[j]) / (clamped * (T(1) - clamped)) * factor;
+                    }
+                }
+                alignas(Memory::CACHE_LINE) T complement[detail::CHUNK];
+                for (size_t j = 0; j < n; ++j) {
+                    terms[j] = std::max(y[j], detail::LOG_FLOOR<T>);
+                    complement[j] = std::max(T(1) - y[j], detail::LOG_FLOOR<T>);
+                }
+                VectorMath::log(terms, terms, n);
+                VectorMath::log(complement, complement, n);
+                for (size_t j = 0; j < n; ++j) terms[j] = -(t[j] * terms[j] + (T(1) - t[j]) * complement[j]);
+            });
         }
     };
+
+    // Categorical cross-entropy: each row of y is a probability distribution over classes and
+    // each row of t a target distribution (one-hot or soft labels summing to 1)
+    // L = -1/rows * Σ t log(y)
+    // After a Softmax output layer, dL/dz = (y - t) / rows: the softmax Jacobian cancels, so
+    // lossAndDelta() needs neither it nor the per-row reductions of Softmax::backwardInto()
+    template<typename T>
+    class CrossEntropy : public LossFunction<T> {
+        using Base = LossFunction<T>;
+
+    public:
+        using Base::lossAndGradient;
+        using Base::lossAndDelta;
+
+        const char* name() const override { return "cross_entropy"; }
+
+        T calculate(MatrixView<const T> predicted, MatrixView<const T> expected) const override {
+            if (!Base::readyForPass(predicted, expected)) return calculate(Matrix<T>(predicted), Matrix<T>(expected));
+            return pass(predicted, expected, nullptr, 0, false) / rows(predicted);
+        }
+
+        // dL/dy = -t / y / rows, with y clamped away from 0
+        Matrix<T> derivative(MatrixView<const T> predicted, MatrixView<const T> expected) const override {
+            Matrix<T> result(0, 0);
+            lossAndGradient(predicted, expected, result);
+            return result;
+        }
+
+        void derivativeInto(MatrixView<const T> predicted, MatrixView<const T> expected,
+                            Matrix<T>& out, T scale = 1) const override {
+            lossAndGradient(predicted, expected, out, scale);
+        }
+
+        T lossAndGradient(MatrixView<const T> predicted, MatrixView<const T> expected,
+                          MatrixView<T> gradient, T scale = 1) const override {
+            if (!Base::readyForPass(predicted, expected)) {
+                return lossAndGradient(Matrix<T>(predicted), Matrix<T>(expected), gradient, scale);
+            }
+            T* out = Base::gradientStorage(predicted, gradient);
+            return pass(predicted, expected, out, scale / rows(predicted), false) * scale / rows(predicted);
+        }
+
+        bool fusesActivation(const Activation::ActivationFunction<T>& activation) const override {
+            return dynamic_cast<const Activation::Softmax<T>*>(&activation) != nullptr;
+        }
+
+        T lossAndDelta(const Activation::ActivationFunction<T>& activation, MatrixView<const T> predicted,
+                       MatrixView<const T> expected, MatrixView<T> delta, T scale = 1) const override {
+            if (!fusesActivation(activation)) return Base::lossAndDelta(activation, predicted, expected, delta, scale);
+            if (!Base::readyForPass(predicted, expected)) {
+                return lossAndDelta(activation, Matrix<T>(predicted), Matrix<T>(expected), delta, scale);
+            }
+            T* out = Base::gradientStorage(predicted, delta);
+            return pass(predicted, expected, out, scale / rows(predicted), true) * scale / rows(predicted);
+        }
+
+    private:
+        static T rows(MatrixView<const T> m) { return static_cast<T>(m.getRows()); }
+
+        // Sum of -t log(y) over all elements; also writes the gradient times factor unless it is
+        // null, with respect to the softmax's input when through_softmax is set
+        // The loss is a plain sum over elements, so rows need no separate treatment here
+        static T pass(MatrixView<const T> predicted, MatrixView<const T> expected, T* gradient, T factor,
+                      bool through_softmax) {
+            const T* p = predicted.data();
+            const T* e = expected.data();
+            return detail::chunkedSum<T>(predicted.getRows() * predicted.getCols(), [&](size_t first, size_t n, T* terms) {
+                const T* y = p + first;
+                const T* t = e + first;
+                if (gradient && through_softmax) {
+                    for (size_t j = 0; j < n; ++j) gradient[first + j] = (y[j] - t[j]) * factor;
+                } else if (gradient) {
+                    for (size_t j = 0; j < n; ++j) {
+                        gradient[first + j] = -t[j] / std::max(y[j], detail::GRADIENT_FLOOR<T>) * factor;
+                    }
+                }
+                for (size_t j = 0; j < n; ++j) terms[j] = std::max(y[j], detail::LOG_FLOOR<T>);
+                VectorMath::log(terms, terms, n);
+                for (size_t j = 0; j < n; ++j) terms[j] = -t[j] * terms[j];
+            });
+        }
+    };
+
+    // Loss function for a name() value
+    template<typename T>
+    std::shared_ptr<LossFunction<T>> create(const std::string& name) {
+        if (name == "mse") return std::make_shared<MSE<T>>();
+        if (name == "bce") return std::make_shared<BinaryCrossEntropy<T>>();
+        if (name == "cross_entropy") return std::make_shared<CrossEntropy<T>>();
+        throw std::invalid_argument("Unknown loss function '" + name + "'");
+    }
 }
@@ -1,17 +1,17 @@
 
+#include <fstream>
 #include <iostream>
 #include <memory>
+#include <string>
+#include "checkpoint.hpp"
 #include "neural_network.hpp"
+#include "quantized.hpp"
 #include "utils.hpp"
 
-int main() {
-    // Define the core network parameters as constants
-    using T = double;  // Use double precision floating point for all calculations
-    const size_t TRAIN_SAMPLES = 1000;  // Number of training examples to generate
-    const size_t TEST_SAMPLES = 100;    // Number of test examples to evaluate on
-    const T LEARNING_RATE = 0.1;        // Step size for gradient descent
-    const size_t EPOCHS = 1000;         // Number of complete passes through the training data
-
+// Build the XOR network and train it on (train_x, train_y)
+template<typename T>
+std::shared_ptr<NeuralNetwork<T>> train(Precision::Format storage, const Matrix<T>& train_x,
+                                        const Matrix<T>& train_y, T learning_rate, size_t epochs) {
     // Initialize the neural network with Mean Squared Error loss function
     // Using smart pointer for automatic memory management
     auto nn = std::make_shared<NeuralNetwork<T>>(std::make_shared<Loss::MSE<T>>());
@@ -24,27 +24,60 @@ int main() {
     // Layer 2: Hidden(4) -> Output(1) with Sigmoid activation
     // This layer reduces 4D hidden state to single output probability
     nn->addLayer(std::make_shared<Layer<T>>(4, 1, std::make_shared<Activation::Sigmoid<T>>()));
+    nn->setStorageFormat(storage);
 
-    // Generate synthetic XOR training data
-    // train_x: Matrix of input pairs (e.g., [0,1], [1,0])
-    // train_y: Matrix of expected outputs (e.g., [1], [1])
-    auto [train_x, train_y] = Utils::DataGenerator<T>::generateXORData(TRAIN_SAMPLES);
+    // Adam adapts the step size per parameter and fits XOR in far fewer epochs than plain SGD
+    nn->setOptimizer(std::make_shared<Optim::Adam<T>>());
 
     // Begin training process
     std::cout << "Training started..." << std::endl;
-    for (size_t epoch = 0; epoch < EPOCHS; ++epoch) {
+    for (size_t epoch = 0; epoch < epochs; ++epoch) {
         T total_loss = 0;
 
         // Perform one complete pass through training data
-        // Updates weights and biases using backpropagation
-        total_loss = nn->train(train_x, train_y, LEARNING_RATE);
+        // Updates weights and biases using backpropagation and the optimizer
+        total_loss = nn->train(train_x, train_y, learning_rate);
 
         // Print progress every 100 epochs
         if ((epoch + 1) % 100 == 0) {
-            std::cout << "Epoch " << epoch + 1 << "/" << EPOCHS 
+            std::cout << "Epoch " << epoch + 1 << "/" << epochs 
                       << ", Loss: " << total_loss << std::endl;
         }
     }
+    return nn;
+}
+
+// Train and evaluate the XOR network with element type T
+// storage selects mixed precision: weights and activations kept in bf16/fp16
+// checkpoint (optional): load the trained network from this file if it exists, otherwise
+// train and save it there
+template<typename T>
+int run(Precision::Format storage, const std::string& checkpoint) {
+    // Define the core network parameters as constants
+    const size_t TRAIN_SAMPLES = 1000;  // Number of training examples to generate
+    const size_t TEST_SAMPLES = 100;    // Number of test examples to evaluate on
+    const T LEARNING_RATE = T(0.05);    // Base step size of the Adam optimizer
+    const size_t EPOCHS = 300;          // Number of complete passes through the training data
+
+    // Generate synthetic XOR training data
+    // train_x: Matrix of input pairs (e.g., [0,1], [1,0])
+    // train_y: Matrix of expected outputs (e.g., [1], [1])
+    auto [train_x, train_y] = Utils::DataGenerator<T>::generateXORData(TRAIN_SAMPLES);
+
+    std::shared_ptr<NeuralNetwork<T>> nn;
+    if (!checkpoint.empty() && std::ifstream(checkpoint).good()) {
+        // Weights are mapped from the file, not copied
+        nn = Checkpoint::load<T>(checkpoint);
+        // The checkpoint restores the format it was saved with; the command line wins
+        nn->setStorageFormat(storage);
+        std::cout << "Loaded checkpoint " << checkpoint << std::endl;
+    } else {
+        nn = train<T>(storage, train_x, train_y, LEARNING_RATE, EPOCHS);
+        if (!checkpoint.empty()) {
+            Checkpoint::save(*nn, checkpoint);
+            std::cout << "Saved checkpoint " << checkpoint << std::endl;
+        }
+    }
 
     // Generate separate test dataset for evaluation
     auto [test_x, test_y] = Utils::DataGenerator<T>::generateXORData(TEST_SAMPLES);
@@ -57,6 +90,12 @@ int main() {
     std::cout << "\nTest Results:" << std::endl;
     std::cout << "Accuracy: " << accuracy * 100 << "%" << std::endl;
 
+    // Freeze an int8 copy, calibrated on the training inputs, and compare accuracy
+    Quantized::Model<T> int8_model(*nn, train_x);
+    auto report = Quantized::compareAccuracy(*nn, int8_model, test_x, test_y);
+    std::cout << "Int8 accuracy: " << report.quantized * 100 << "% (delta "
+              << report.delta() * 100 << "%)" << std::endl;
+
     // Show example predictions for visual verification
     std::cout << "\nExample Predictions:" << std::endl;
     for (size_t i = 0; i < 5; ++i) {
@@ -67,3 +106,23 @@ int main() {
 
     return 0;
 }
+
+// Usage: neural_network [double|float|bf16|fp16] [checkpoint]
+// bf16 and fp16 train in float with 16-bit weight and activation storage
+int main(int argc, char** argv) {
+    const std::string mode = argc > 1 ? argv[1] : "double";
+    std::cout << "Precision: " << mode << std::endl;
+    std::cout << "Seed: " << Random::globalSeed() << " (set NN_SEED to change)" << std::endl;
+    const std::string checkpoint = argc > 2 ? argv[2] : "";
+    try {
+        if (mode == "double") return run<double>(Precision::Format::Native, checkpoint);
+        if (mode == "float") return run<float>(Precision::Format::Native, checkpoint);
+        if (mode == "bf16") return run<float>(Precision::Format::BFloat16, checkpoint);
+        if (mode == "fp16") return run<float>(Precision::Format::Float16, checkpoint);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    std::cerr << "Unknown precision '" << mode << "', expected double, float, bf16 or fp16" << std::endl;
+    return 1;
+}
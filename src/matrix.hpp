@@ -1,143 +1,333 @@
-
 #pragma once
 #include <vector>
 #include <stdexcept>
-#include <random>
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
+#include <type_traits>
+#include "memory.hpp"
+#include "expression.hpp"
+#include "gemm.hpp"
+#include "random.hpp"
+
+template<typename T>
+class Matrix;
+
+template<typename T>
+class MatrixView;
+
+// Mixed-format multiplication, defined after MatrixView below
+template<typename CodecA, typename CodecB, typename T>
+void multiplyInto(MatrixView<const typename CodecA::Storage> a, MatrixView<const typename CodecB::Storage> b,
+                  MatrixView<T> out, Gemm::Transpose trans_a = Gemm::Transpose::No,
+                  Gemm::Transpose trans_b = Gemm::Transpose::No, const Gemm::Epilogue<T>* epilogue = nullptr,
+                  bool accumulate = false);
+
+// MatrixView class: Non-owning window onto matrix storage
+// Describes elements through row and column strides, so row, column,
+// block and transposed views all share the parent's memory without copying
+template<typename T>
+class MatrixView {
+private:
+    T* ptr = nullptr;         // First element of the view
+    size_t rows = 0;          // Number of rows visible through the view
+    size_t cols = 0;          // Number of columns visible through the view
+    size_t row_stride = 0;    // Elements between vertically adjacent entries
+    size_t col_stride = 1;    // Elements between horizontally adjacent entries
+
+public:
+    using value_type = std::remove_const_t<T>;
+
+    MatrixView() = default;
+
+    // Constructor: Describe an existing buffer with explicit strides
+    MatrixView(T* ptr, size_t rows, size_t cols, size_t row_stride, size_t col_stride = 1)
+        : ptr(ptr), rows(rows), cols(cols), row_stride(row_stride), col_stride(col_stride) {}
+
+    // Conversion: Mutable views can be used wherever a read-only view is expected
+    template<typename U, typename = std::enable_if_t<std::is_same_v<const U, T>>>
+    MatrixView(const MatrixView<U>& other)
+        : ptr(other.data()), rows(other.getRows()), cols(other.getCols()),
+          row_stride(other.rowStride()), col_stride(other.colStride()) {}
+
+    // Single row as a [1 x cols] view
+    MatrixView<T> row(size_t i) const {
+        if (i >= rows) {
+            throw std::out_of_range("Row index out of range");
+        }
+        return MatrixView<T>(ptr + i * row_stride, 1, cols, row_stride, col_stride);
+    }
+
+    // Single column as a [rows x 1] view
+    MatrixView<T> col(size_t j) const {
+        if (j >= cols) {
+            throw std::out_of_range("Column index out of range");
+        }
+        return MatrixView<T>(ptr + j * col_stride, rows, 1, row_stride, col_stride);
+    }
+
+    // Rectangular sub-block starting at (row, col)
+    MatrixView<T> block(size_t row, size_t col, size_t num_rows, size_t num_cols) const {
+        if (row + num_rows > rows || col + num_cols > cols) {
+            throw std::out_of_range("Block exceeds view bounds");
+        }
+        return MatrixView<T>(ptr + row * row_stride + col * col_stride,
+                             num_rows, num_cols, row_stride, col_stride);
+    }
+
+    // Consecutive rows [first, first + count), e.g. one mini-batch of samples
+    MatrixView<T> rowRange(size_t first, size_t count) const {
+        return block(first, 0, count, cols);
+    }
+
+    // Transposed view: swaps dimensions and strides, no data movement
+    MatrixView<T> transpose() const {
+        return MatrixView<T>(ptr, cols, rows, col_stride, row_stride);
+    }
+
+    // True when rows are packed back to back with unit column stride
+    bool isContiguous() const {
+        return col_stride == 1 && (row_stride == cols || rows <= 1);
+    }
+
+    // Matrix multiplication into a newly allocated result
+    // Transpose flags read either operand as its transpose straight from the original layout
+    Matrix<value_type> dot(MatrixView<const value_type> other,
+                           Gemm::Transpose trans_self = Gemm::Transpose::No,
+                           Gemm::Transpose trans_other = Gemm::Transpose::No) const;
+
+    // Matrix multiplication into existing storage (out must have unit column stride)
+    // The optional epilogue post-processes each finished tile, e.g. bias + activation
+    // With accumulate set the product is added to out instead of replacing it
+    void dotInto(MatrixView<const value_type> other, MatrixView<value_type> out,
+                 Gemm::Transpose trans_self = Gemm::Transpose::No,
+                 Gemm::Transpose trans_other = Gemm::Transpose::No,
+                 const Gemm::Epilogue<value_type>* epilogue = nullptr, bool accumulate = false) const;
+
+    // Access methods for view elements
+    T& at(size_t i, size_t j) const { return ptr[i * row_stride + j * col_stride]; }
+    T* data() const { return ptr; }
+    size_t getRows() const { return rows; }
+    size_t getCols() const { return cols; }
+    size_t rowStride() const { return row_stride; }
+    size_t colStride() const { return col_stride; }
+};
 
 // Matrix class: Core data structure for neural network operations
 // Implements essential matrix operations required for forward and backward propagation
 template<typename T>
 class Matrix {
 private:
-    std::vector<std::vector<T>> data;  // 2D vector storing matrix elements
+    // Row-major elements in one contiguous, cache-line aligned allocation
+    std::vector<T, Memory::AlignedAllocator<T>> storage;
     size_t rows;                       // Number of matrix rows
     size_t cols;                       // Number of matrix columns
 
+    template<typename Other>
+    void checkSameShape(const Other& other, const char* message) const {
+        if (rows != other.getRows() || cols != other.getCols()) {
+            throw std::invalid_argument(message);
+        }
+    }
+
 public:
+    using value_type = T;
+
     // Constructor: Initialize matrix with specified dimensions
-    Matrix(size_t rows, size_t cols) : rows(rows), cols(cols) {
-        data.resize(rows, std::vector<T>(cols));
+    Matrix(size_t rows, size_t cols) : storage(rows * cols), rows(rows), cols(cols) {}
+
+    // Constructor: Evaluate an elementwise expression (see expression.hpp), e.g.
+    // Matrix<T> error = (predicted - expected) * scale; runs one fused pass
+    template<typename E>
+    Matrix(const Expr::Expression<E>& expression)
+        : storage(expression.self().getRows() * expression.self().getCols()),
+          rows(expression.self().getRows()), cols(expression.self().getCols()) {
+        Expr::evaluate<Expr::Replace>(expression.self(), storage.data());
     }
 
-    // Constructor: Initialize matrix from existing 2D vector
-    Matrix(const std::vector<std::vector<T>>& input) : data(input) {
-        rows = input.size();
-        cols = input[0].size();
+    // Assign an elementwise expression in one fused pass
+    // Reuses the allocation when it is large enough; the matrix may appear in the
+    // expression itself (a = a * 0.5 + b)
+    template<typename E>
+    Matrix& operator=(const Expr::Expression<E>& expression) {
+        resize(expression.self().getRows(), expression.self().getCols());
+        Expr::evaluate<Expr::Replace>(expression.self(), storage.data());
+        return *this;
     }
 
-    // Initialize matrix with random values in range [min, max]
-    // Used for weight initialization in neural network layers
-    void randomize(T min = -1, T max = 1) {
-        std::random_device rd;  // Hardware random number generator
-        std::mt19937 gen(rd());  // Mersenne Twister PRNG
-        std::uniform_real_distribution<T> dis(min, max);  // Uniform distribution
+    // Constructor: Initialize matrix from existing 2D vector
+    Matrix(const std::vector<std::vector<T>>& input)
+        : rows(input.size()), cols(input.empty() ? 0 : input[0].size()) {
+        storage.reserve(rows * cols);
+        for (const auto& row : input) {
+            if (row.size() != cols) {
+                throw std::invalid_argument("All rows must have the same number of columns");
+            }
+            storage.insert(storage.end(), row.begin(), row.end());
+        }
+    }
 
+    // Constructor: Materialize any (possibly strided) view into owned storage
+    explicit Matrix(MatrixView<const T> source)
+        : storage(source.getRows() * source.getCols()),
+          rows(source.getRows()), cols(source.getCols()) {
         for (size_t i = 0; i < rows; ++i) {
             for (size_t j = 0; j < cols; ++j) {
-                data[i][j] = dis(gen);
+                storage[i * cols + j] = source.at(i, j);
             }
         }
     }
 
+    // Change the dimensions, reusing the existing allocation when it is large enough
+    // Element values are unspecified afterwards; callers overwrite them
+    void resize(size_t new_rows, size_t new_cols) {
+        storage.resize(new_rows * new_cols);
+        rows = new_rows;
+        cols = new_cols;
+    }
+
+    // Reserve room for rows x cols elements, so later resize() calls up to that size never allocate
+    void reserve(size_t max_rows, size_t max_cols) {
+        storage.reserve(max_rows * max_cols);
+    }
+
+    // Current allocation in elements
+    size_t capacity() const { return storage.capacity(); }
+
+    // Initialize matrix with random values in range (min, max)
+    // Used for weight initialization in neural network layers
+    // Each call draws from a stream of its own (Random::nextStream), so a fixed global seed
+    // (NN_SEED, Random::setGlobalSeed) reproduces every initialization
+    void randomize(T min = T(-1), T max = T(1)) {
+        Random::Generator generator = Random::nextStream();
+        randomize(generator, min, max);
+    }
+
+    // Same from a given generator, which moves past the values drawn
+    void randomize(Random::Generator& generator, T min, T max) {
+        static_assert(std::is_floating_point<T>::value, "randomize() needs a floating-point element type");
+        generator.fillUniform(storage.data(), storage.size(), min, max);
+    }
+
+    // Fill with normal values of the given mean and standard deviation
+    void randomizeNormal(Random::Generator& generator, T mean, T stddev) {
+        static_assert(std::is_floating_point<T>::value, "randomizeNormal() needs a floating-point element type");
+        generator.fillNormal(storage.data(), storage.size(), mean, stddev);
+    }
+
     // Matrix multiplication (dot product)
     // Essential for forward propagation (input * weights)
     // and backward propagation (error * weights_transpose)
-    Matrix<T> dot(const Matrix<T>& other) const {
-        if (cols != other.rows) {
-            throw std::invalid_argument("Matrix dimensions don't match for multiplication");
-        }
-
-        Matrix<T> result(rows, other.cols);
-        // Perform matrix multiplication: result[i,j] = sum(this[i,k] * other[k,j])
-        for (size_t i = 0; i < rows; ++i) {
-            for (size_t j = 0; j < other.cols; ++j) {
-                T sum = 0;
-                for (size_t k = 0; k < cols; ++k) {
-                    sum += data[i][k] * other.data[k][j];
-                }
-                result.data[i][j] = sum;
-            }
-        }
-        return result;
+    // e.g. a.dot(b, Transpose::No, Transpose::Yes) computes a * b^T without copying b
+    Matrix<T> dot(MatrixView<const T> other,
+                  Gemm::Transpose trans_self = Gemm::Transpose::No,
+                  Gemm::Transpose trans_other = Gemm::Transpose::No) const {
+        return view().dot(other, trans_self, trans_other);
     }
 
     // Element-wise multiplication (Hadamard product)
     // Used in backward propagation when computing gradients
-    Matrix<T> hadamard(const Matrix<T>& other) const {
-        if (rows != other.rows || cols != other.cols) {
-            throw std::invalid_argument("Matrix dimensions don't match for hadamard product");
-        }
-
-        Matrix<T> result(rows, cols);
-        for (size_t i = 0; i < rows; ++i) {
-            for (size_t j = 0; j < cols; ++j) {
-                result.data[i][j] = data[i][j] * other.data[i][j];
-            }
-        }
-        return result;
+    // Lazy like the arithmetic operators: other may be a matrix or an expression
+    template<typename R>
+    auto hadamard(const R& other) const {
+        return Expr::hadamard(*this, other);
     }
 
     // Matrix transpose operation
-    // Used in backward propagation to propagate errors
+    // Returns an owned copy; use view().transpose() to avoid the copy
     Matrix<T> transpose() const {
-        Matrix<T> result(cols, rows);
-        for (size_t i = 0; i < rows; ++i) {
-            for (size_t j = 0; j < cols; ++j) {
-                result.data[j][i] = data[i][j];
-            }
-        }
-        return result;
+        return Matrix<T>(view().transpose());
     }
 
-    // Element-wise matrix addition
-    // Used in updating weights: weights = weights + learning_rate * gradient
-    Matrix<T> operator+(const Matrix<T>& other) const {
-        if (rows != other.rows || cols != other.cols) {
-            throw std::invalid_argument("Matrix dimensions don't match for addition");
-        }
+    // Element-wise addition (a + b), subtraction (a - b) and scalar multiplication
+    // (a * s, s * a) are free operators in expression.hpp: they build lazy expressions that
+    // are evaluated in one pass when assigned to a Matrix
 
-        Matrix<T> result(rows, cols);
-        for (size_t i = 0; i < rows; ++i) {
-            for (size_t j = 0; j < cols; ++j) {
-                result.data[i][j] = data[i][j] + other.data[i][j];
-            }
+    // In-place counterparts of the operators; they never allocate
+    Matrix<T>& operator+=(const Matrix<T>& other) {
+        checkSameShape(other, "Matrix dimensions don't match for addition");
+        for (size_t i = 0; i < storage.size(); ++i) {
+            storage[i] += other.storage[i];
         }
-        return result;
+        return *this;
     }
 
-    // Element-wise matrix subtraction
-    // Used in computing error terms: error = predicted - expected
-    Matrix<T> operator-(const Matrix<T>& other) const {
-        if (rows != other.rows || cols != other.cols) {
-            throw std::invalid_argument("Matrix dimensions don't match for subtraction");
+    Matrix<T>& operator-=(const Matrix<T>& other) {
+        checkSameShape(other, "Matrix dimensions don't match for subtraction");
+        for (size_t i = 0; i < storage.size(); ++i) {
+            storage[i] -= other.storage[i];
         }
+        return *this;
+    }
 
-        Matrix<T> result(rows, cols);
-        for (size_t i = 0; i < rows; ++i) {
-            for (size_t j = 0; j < cols; ++j) {
-                result.data[i][j] = data[i][j] - other.data[i][j];
-            }
+    // Accumulate an expression in one fused pass: weights -= gradient * learning_rate
+    template<typename E>
+    Matrix<T>& operator+=(const Expr::Expression<E>& expression) {
+        checkSameShape(expression.self(), "Matrix dimensions don't match for addition");
+        Expr::evaluate<Expr::Add>(expression.self(), storage.data());
+        return *this;
+    }
+
+    template<typename E>
+    Matrix<T>& operator-=(const Expr::Expression<E>& expression) {
+        checkSameShape(expression.self(), "Matrix dimensions don't match for subtraction");
+        Expr::evaluate<Expr::Sub>(expression.self(), storage.data());
+        return *this;
+    }
+
+    Matrix<T>& operator*=(T scalar) {
+        for (auto& value : storage) {
+            value *= scalar;
         }
-        return result;
+        return *this;
     }
 
-    // Scalar multiplication
-    // Used in scaling gradients by learning rate
-    Matrix<T> operator*(T scalar) const {
-        Matrix<T> result(rows, cols);
-        for (size_t i = 0; i < rows; ++i) {
-            for (size_t j = 0; j < cols; ++j) {
-                result.data[i][j] = data[i][j] * scalar;
-            }
+    // Scaled accumulation (BLAS axpy): this += alpha * x
+    // Gradient descent step without temporaries: weights.axpy(-learning_rate, gradient)
+    Matrix<T>& axpy(T alpha, const Matrix<T>& x) {
+        checkSameShape(x, "Matrix dimensions don't match for axpy");
+        for (size_t i = 0; i < storage.size(); ++i) {
+            storage[i] += alpha * x.storage[i];
         }
-        return result;
+        return *this;
+    }
+
+    // Matrix multiplication into an existing matrix: out = op(this) * op(other)
+    // out is resized to the product shape, reusing its allocation when large enough
+    void dotInto(MatrixView<const T> other, Matrix<T>& out,
+                 Gemm::Transpose trans_self = Gemm::Transpose::No,
+                 Gemm::Transpose trans_other = Gemm::Transpose::No) const {
+        out.resize(trans_self == Gemm::Transpose::Yes ? cols : rows,
+                   trans_other == Gemm::Transpose::Yes ? other.getRows() : other.getCols());
+        view().dotInto(other, out.view(), trans_self, trans_other);
     }
 
+    // Views over the matrix storage
+    // Row, column and block views alias this matrix and stay valid until it is resized or destroyed
+    MatrixView<T> view() { return MatrixView<T>(storage.data(), rows, cols, cols); }
+    MatrixView<const T> view() const { return MatrixView<const T>(storage.data(), rows, cols, cols); }
+    MatrixView<T> row(size_t i) { return view().row(i); }
+    MatrixView<const T> row(size_t i) const { return view().row(i); }
+    MatrixView<T> col(size_t j) { return view().col(j); }
+    MatrixView<const T> col(size_t j) const { return view().col(j); }
+    MatrixView<T> block(size_t row, size_t col, size_t num_rows, size_t num_cols) {
+        return view().block(row, col, num_rows, num_cols);
+    }
+    MatrixView<const T> block(size_t row, size_t col, size_t num_rows, size_t num_cols) const {
+        return view().block(row, col, num_rows, num_cols);
+    }
+    MatrixView<T> rowRange(size_t first, size_t count) { return view().rowRange(first, count); }
+    MatrixView<const T> rowRange(size_t first, size_t count) const { return view().rowRange(first, count); }
+
+    // Implicit conversion so a Matrix can be passed wherever a read-only view is accepted
+    operator MatrixView<const T>() const { return view(); }
+
     // Access methods for matrix elements
-    T& at(size_t i, size_t j) { return data[i][j]; }
-    const T& at(size_t i, size_t j) const { return data[i][j]; }
+    T& at(size_t i, size_t j) { return storage[i * cols + j]; }
+    const T& at(size_t i, size_t j) const { return storage[i * cols + j]; }
+    T* data() { return storage.data(); }
+    const T* data() const { return storage.data(); }
+    size_t size() const { return storage.size(); }
     size_t getRows() const { return rows; }
     size_t getCols() const { return cols; }
 
@@ -145,10 +335,55 @@ public:
     void print() const {
         for (size_t i = 0; i < rows; ++i) {
             for (size_t j = 0; j < cols; ++j) {
-                std::cout << std::setw(8) << std::fixed << std::setprecision(4) << data[i][j] << " ";
+                std::cout << std::setw(8) << std::fixed << std::setprecision(4) << at(i, j) << " ";
             }
             std::cout << std::endl;
         }
         std::cout << std::endl;
     }
 };
+
+// Matrix multiplication on views: result[i,j] = sum(op(this)[i,k] * op(other)[k,j])
+// Accepts any strides; a transposed operand only swaps its strides, nothing is copied
+template<typename T>
+Matrix<typename MatrixView<T>::value_type> MatrixView<T>::dot(MatrixView<const value_type> other,
+                                                              Gemm::Transpose trans_self,
+                                                              Gemm::Transpose trans_other) const {
+    const size_t result_rows = trans_self == Gemm::Transpose::Yes ? cols : rows;
+    const size_t result_cols = trans_other == Gemm::Transpose::Yes ? other.getRows() : other.getCols();
+    Matrix<value_type> result(result_rows, result_cols);
+    dotInto(other, result.view(), trans_self, trans_other);
+    return result;
+}
+
+template<typename T>
+void MatrixView<T>::dotInto(MatrixView<const value_type> other, MatrixView<value_type> out,
+                            Gemm::Transpose trans_self, Gemm::Transpose trans_other,
+                            const Gemm::Epilogue<value_type>* epilogue, bool accumulate) const {
+    multiplyInto<Precision::Native<value_type>, Precision::Native<value_type>>(
+        MatrixView<const value_type>(*this), other, out, trans_self, trans_other, epilogue, accumulate);
+}
+
+// Multiplication with operands in any storage format: out = op(a) * op(b), or
+// out += op(a) * op(b) with accumulate set
+// Operands stored in a 16-bit format (see precision.hpp) are decoded while GEMM packs
+// them, so the product is accumulated in T either way
+template<typename CodecA, typename CodecB, typename T>
+void multiplyInto(MatrixView<const typename CodecA::Storage> a_view,
+                  MatrixView<const typename CodecB::Storage> b_view, MatrixView<T> out,
+                  Gemm::Transpose trans_a, Gemm::Transpose trans_b,
+                  const Gemm::Epilogue<T>* epilogue, bool accumulate) {
+    const auto a = trans_a == Gemm::Transpose::Yes ? a_view.transpose() : a_view;
+    const auto b = trans_b == Gemm::Transpose::Yes ? b_view.transpose() : b_view;
+    if (a.getCols() != b.getRows()) {
+        throw std::invalid_argument("Matrix dimensions don't match for multiplication");
+    }
+    if (out.getRows() != a.getRows() || out.getCols() != b.getCols() || out.colStride() != 1) {
+        throw std::invalid_argument("Output matrix has the wrong shape or layout for multiplication");
+    }
+
+    Gemm::gemm<T, CodecA, CodecB>(a.getRows(), b.getCols(), a.getCols(), T(1),
+                                  a.data(), a.rowStride(), a.colStride(),
+                                  b.data(), b.rowStride(), b.colStride(),
+                                  accumulate ? T(1) : T(0), out.data(), out.rowStride(), epilogue);
+}
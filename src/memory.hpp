@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <limits>
+#include "profiler.hpp"
+
+namespace Memory {
+    // Cache line size used to align every matrix buffer
+    // 64 bytes also satisfies the alignment of AVX-512 vector loads
+    constexpr std::size_t CACHE_LINE = 64;
+
+    // Standard-library compatible allocator returning aligned storage
+    // Lets std::vector hold matrix data that vector kernels can load directly
+    template<typename T, std::size_t Alignment = CACHE_LINE>
+    class AlignedAllocator {
+    public:
+        using value_type = T;
+
+        // Rebind support so containers can allocate their internal node types
+        template<typename U>
+        struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+        AlignedAllocator() noexcept = default;
+
+        template<typename U>
+        AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+        // Allocate storage for n elements on an Alignment-byte boundary
+        T* allocate(std::size_t n) {
+            if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) {
+                throw std::bad_alloc();
+            }
+            NN_PROFILE_ALLOCATION(n * sizeof(T));
+            return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+        }
+
+        // Release storage obtained from allocate()
+        void deallocate(T* ptr, std::size_t) noexcept {
+            ::operator delete(ptr, std::align_val_t(Alignment));
+        }
+
+        template<typename U>
+        bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+
+        template<typename U>
+        bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept { return false; }
+    };
+}
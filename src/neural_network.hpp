@@ -1,69 +1,448 @@
 
 #pragma once
+#include "dataset.hpp"
+#include "graph.hpp"
 #include "layer.hpp"
 #include "loss.hpp"
+#include "optimizer.hpp"
+#include "profiler.hpp"
 #include <vector>
 #include <memory>
+#include <algorithm>
 
 // Neural Network class: Orchestrates the interaction between layers
 // Manages forward and backward propagation through the network
+//
+// The layers form a compute graph (see graph.hpp). addLayer(layer) appends to a chain;
+// branches and residual connections take node handles:
+//   auto x = nn.input();
+//   auto h = nn.addLayer(first, x);
+//   auto r = nn.addLayer(second, h);
+//   nn.addLayer(head, nn.add({h, r}));   // head reads h + second(h)
+// The node added last is the network output. Every pass runs in one workspace buffer laid
+// out by the graph's memory plan, so activations and gradients share memory wherever
+// their lifetimes allow.
 template<typename T>
 class NeuralNetwork {
 private:
-    // Collection of network layers in sequence
-    std::vector<std::shared_ptr<Layer<T>>> layers;
+    // Topology: the layers and how their outputs feed each other
+    Graph::ComputeGraph<T> graph;
     
     // Loss function used to compute error and gradients
     std::shared_ptr<Loss::LossFunction<T>> loss_function;
 
+    // Private forward/backward state of one data-parallel shard
+    // Each shard owns its activations and gradient buffers, so shards never share writes
+    struct Shard {
+        Graph::Workspace<T> workspace;        // Activations and gradients of the shard's rows
+        ParameterArena<T> gradient_arena;     // Same layout as the parameter arena
+        std::vector<LayerGradients<T>> gradients;  // Per-layer views into gradient_arena
+        T loss = 0;
+    };
+
+    // Training workspace: every buffer a train() step writes, sized from the graph's
+    // training plan and the largest shard seen so far. Once sized, steps reuse it and
+    // perform no heap allocations.
+    std::vector<Shard> shards;          // Reused across training steps
+    size_t shard_count;                 // Number of shards a training batch is split into
+    size_t workspace_rows = 0;          // Shard rows the workspace is currently reserved for
+    Precision::Format storage_format = Precision::Format::Native;
+    bool flush_denormals = true;        // Run train()/predict() with denormals flushed to zero
+
+    // Every layer's weights and bias in one flat buffer (w0, b0, w1, b1, ...), which the
+    // layers read and the optimizer updates in place. Built by the first train() call, so
+    // networks only used for inference (e.g. memory-mapped checkpoints) never copy their
+    // parameters. Shared with the layers, which keep it alive while bound to it.
+    std::shared_ptr<ParameterArena<T>> parameters;
+    std::shared_ptr<Optim::Optimizer<T>> optimizer = std::make_shared<Optim::SGD<T>>();
+    std::shared_ptr<const Optim::Schedule<T>> schedule;  // Constant rate when null
+    size_t step_count = 0;              // train() updates so far; the schedule's step
+
+    // State of the per-call forward()/backward() pair
+    Graph::Workspace<T> pass;
+    ParameterArena<T> pass_gradient_arena;
+    std::vector<LayerGradients<T>> pass_gradients;
+
+    // Run the graph on input into output (shapes already checked), under the caller's
+    // denormal mode. Intermediate activations live in the thread's workspace, laid out by
+    // the inference plan; it is borrowed for the call: a thread waiting on the pool inside
+    // a GEMM may run another inference task, which then gets its own.
+    void inferRows(MatrixView<const T> input, MatrixView<T> output) const {
+        thread_local Graph::Workspace<T> cache;
+        Graph::Workspace<T> scratch;
+        std::swap(scratch, cache);
+        graph.infer(scratch, input, output);
+        std::swap(scratch, cache);
+    }
+
+    // True when every layer reads its parameters from the current arena
+    bool parametersBound() const {
+        const auto& layers = graph.getLayers();
+        if (!parameters || parameters->tensorCount() != 2 * layers.size()) return false;
+        for (size_t l = 0; l < layers.size(); ++l) {
+            if (layers[l]->getWeights().data() != parameters->tensor(2 * l).data()) return false;
+        }
+        return true;
+    }
+
+    // (Re)build the parameter arena when layers were added or rebound elsewhere
+    // The optimizer state describes the old layout, so it starts over
+    void prepareParameters() {
+        if (parametersBound()) return;
+        const auto& layers = graph.getLayers();
+        auto arena = std::make_shared<ParameterArena<T>>(parameterLayout());
+        for (size_t l = 0; l < layers.size(); ++l) {
+            layers[l]->bindParameters(arena->tensor(2 * l), arena->tensor(2 * l + 1), arena);
+        }
+        parameters = arena;
+        optimizer->reset();
+    }
+
+    // (Re)build the workspace when the shard count, topology or batch size grew
+    void prepareShards(size_t count, size_t max_shard_rows) {
+        const auto& layers = graph.getLayers();
+        const bool topology_changed = !shards.empty() && !shards[0].gradient_arena.sameLayout(*parameters);
+        if (shards.size() < count || topology_changed) {
+            shards.resize(std::max(count, shards.size()));
+            for (auto& shard : shards) {
+                shard.gradient_arena = ParameterArena<T>(parameterLayout());
+                shard.gradients.clear();
+                for (size_t l = 0; l < layers.size(); ++l) {
+                    shard.gradients.push_back(layers[l]->gradientsIn(shard.gradient_arena, 2 * l));
+                }
+            }
+            workspace_rows = 0;
+        }
+        if (max_shard_rows <= workspace_rows) return;
+        for (auto& shard : shards) shard.workspace.reserve(graph.trainingPlan(), max_shard_rows);
+        workspace_rows = max_shard_rows;
+    }
+
+    // Shapes of every layer's parameters, in arena order (w0, b0, w1, b1, ...)
+    std::vector<typename ParameterArena<T>::Shape> parameterLayout() const {
+        std::vector<typename ParameterArena<T>::Shape> layout;
+        for (const auto& layer : graph.getLayers()) {
+            for (const auto& shape : layer->parameterShapes()) layout.push_back(shape);
+        }
+        return layout;
+    }
+
+    // Gradient buffers of backward(); rebuilt when the layers changed
+    void preparePassGradients() {
+        const auto& layers = graph.getLayers();
+        bool current = pass_gradients.size() == layers.size();
+        for (size_t l = 0; current && l < layers.size(); ++l) {
+            current = pass_gradients[l].weights.getRows() == layers[l]->getWeights().getRows() &&
+                      pass_gradients[l].weights.getCols() == layers[l]->getWeights().getCols();
+        }
+        if (current) return;
+        pass_gradient_arena = ParameterArena<T>(parameterLayout());
+        pass_gradients.clear();
+        for (size_t l = 0; l < layers.size(); ++l) {
+            pass_gradients.push_back(layers[l]->gradientsIn(pass_gradient_arena, 2 * l));
+        }
+    }
+
+    // Number of shards a batch of `rows` rows is split into
+    size_t shardsFor(size_t rows) const {
+        return std::max<size_t>(1, std::min(shard_count, rows / MIN_SHARD_ROWS));
+    }
+
+    // Deterministic tree all-reduce: sums every shard's gradients into shard 0
+    // Pairs are combined in a fixed order, so the result depends only on the shard count;
+    // each pair is one flat add over the gradient arenas
+    void reduceGradients(size_t count) {
+        NN_PROFILE_SCOPE("op", "reduce");
+        for (size_t stride = 1; stride < count; stride *= 2) {
+            const size_t pairs = (count + 2 * stride - 1) / (2 * stride);
+            Parallel::parallelFor(0, pairs, 1, [&](size_t lo, size_t hi) {
+                for (size_t pair = lo; pair < hi; ++pair) {
+                    const size_t target = pair * 2 * stride;
+                    if (target + stride >= count) continue;
+                    T* into = shards[target].gradient_arena.data();
+                    const T* from = shards[target + stride].gradient_arena.data();
+                    const size_t size = shards[target].gradient_arena.size();
+                    for (size_t i = 0; i < size; ++i) into[i] += from[i];
+                    shards[target].loss += shards[target + stride].loss;
+                }
+            });
+        }
+    }
+
 public:
+    // Minimum rows per task when predict() splits a batch across threads
+    static constexpr size_t PREDICT_GRAIN = 256;
+
+    // Minimum rows per data-parallel shard; smaller batches use fewer shards
+    static constexpr size_t MIN_SHARD_ROWS = 32;
+
     // Constructor: Initialize network with specified loss function
+    // Training batches are split into one shard per pool thread by default
     NeuralNetwork(std::shared_ptr<Loss::LossFunction<T>> loss) 
-        : loss_function(loss) {}
+        : loss_function(loss), shard_count(Parallel::numThreads()) {}
+
+    // Set how many shards train() splits each batch into
+    // Results depend only on this number, not on how many threads execute the shards,
+    // so fixing it makes training bit-reproducible across machines and thread counts
+    void setDataParallelShards(size_t count) { shard_count = count > 0 ? count : 1; }
+    size_t getDataParallelShards() const { return shard_count; }
+
+    // Add new layer to network, reading the current output
+    // Layers added this way are processed in sequence during forward/backward passes
+    Graph::NodeId addLayer(std::shared_ptr<Layer<T>> layer) { return addLayer(std::move(layer), graph.output()); }
+
+    // Graph front end: add a layer reading node `from`, an elementwise sum of equally
+    // wide nodes (residual connection) or nodes side by side; each returns the new node,
+    // which becomes the network output
+    Graph::NodeId addLayer(std::shared_ptr<Layer<T>> layer, Graph::NodeId from) {
+        if (layer) layer->setStorageFormat(storage_format);
+        const Graph::NodeId node = graph.addDense(std::move(layer), from);
+        workspace_rows = 0;
+        return node;
+    }
+
+    Graph::NodeId add(const std::vector<Graph::NodeId>& nodes) {
+        const Graph::NodeId node = graph.addSum(nodes);
+        workspace_rows = 0;
+        return node;
+    }
+
+    Graph::NodeId concat(const std::vector<Graph::NodeId>& nodes) {
+        const Graph::NodeId node = graph.addConcat(nodes);
+        workspace_rows = 0;
+        return node;
+    }
+
+    // The network input and its current output
+    Graph::NodeId input() const { return graph.input(); }
+    Graph::NodeId output() const { return graph.output(); }
+
+    // Input and output widths (0 before the first layer)
+    size_t inputSize() const { return graph.inputWidth(); }
+    size_t outputSize() const { return graph.outputWidth(); }
 
-    // Add new layer to network
-    // Layers are processed in sequence during forward/backward passes
-    void addLayer(std::shared_ptr<Layer<T>> layer) {
-        layers.push_back(layer);
+    const Graph::ComputeGraph<T>& getGraph() const { return graph; }
+
+    // True when the layers form a plain chain (everything addLayer(layer) builds)
+    bool isSequential() const { return graph.isSequential(); }
+
+    // Dense layers in the order they were added
+    const std::vector<std::shared_ptr<Layer<T>>>& getLayers() const { return graph.getLayers(); }
+    const std::shared_ptr<Loss::LossFunction<T>>& getLossFunction() const { return loss_function; }
+
+    // Update rule applied by train() (plain SGD by default), e.g.
+    //   nn.setOptimizer(std::make_shared<Optim::Adam<float>>());
+    //   nn.setOptimizer(Optim::adamW<float>(1e-4f));
+    // The optimizer keeps per-parameter state for this network; do not share one instance
+    // between networks
+    void setOptimizer(std::shared_ptr<Optim::Optimizer<T>> update_rule) {
+        if (!update_rule) throw std::invalid_argument("Optimizer must not be null");
+        optimizer = std::move(update_rule);
+        optimizer->reset();
+    }
+    const std::shared_ptr<Optim::Optimizer<T>>& getOptimizer() const { return optimizer; }
+
+    // Learning-rate schedule: train() uses schedule->rate(step, learning_rate) for its
+    // step-th update (counted from 0); null keeps the rate passed to train()
+    void setLearningRateSchedule(std::shared_ptr<const Optim::Schedule<T>> rate_schedule) {
+        schedule = std::move(rate_schedule);
+    }
+
+    // Number of train() updates so far; resetStepCount() restarts the schedule
+    size_t getStepCount() const { return step_count; }
+    void resetStepCount() { step_count = 0; }
+
+    // Mixed-precision mode: store weights and activations in a 16-bit format
+    // (Precision::Format::BFloat16 or Float16) while gradients, updates and GEMM
+    // accumulation stay in T; Format::Native switches back to plain T storage.
+    // bf16 keeps float's range; fp16 is more precise but overflows above 65504.
+    void setStorageFormat(Precision::Format format) {
+        storage_format = format;
+        for (auto& layer : graph.getLayers()) layer->setStorageFormat(format);
+        graph.invalidate();  // The training plan holds 16-bit copies only in mixed precision
+        workspace_rows = 0;
+    }
+    Precision::Format getStorageFormat() const { return storage_format; }
+
+    // Magnitude-prune every layer to the given sparsity (see Layer::prune); forward passes,
+    // predict() and infer() then multiply by the stored weight blocks only. Further training
+    // keeps the pruned weights at zero. Sparsity 0 switches a network whose weights were
+    // pruned before (e.g. loaded from a checkpoint) to the sparse kernels.
+    void prune(double sparsity, Sparse::Layout layout) {
+        for (auto& layer : graph.getLayers()) layer->prune(sparsity, layout);
+        graph.invalidate();  // Sparse layers read T inputs, which mixed-precision plans may drop
+        workspace_rows = 0;
+    }
+
+    // Back to dense products in every layer
+    void makeDense() {
+        for (auto& layer : graph.getLayers()) layer->makeDense();
+        graph.invalidate();
+        workspace_rows = 0;
+    }
+
+    // Re-initialize every layer with the given scheme (see WeightInit); layer l draws from
+    // generator.split(l), so the result depends only on the generator's seed and stream
+    // Optimizer state from earlier training is kept
+    void initialize(WeightInit init, const Random::Generator& generator) {
+        const auto& layers = graph.getLayers();
+        for (size_t l = 0; l < layers.size(); ++l) {
+            Random::Generator stream = generator.split(l);
+            layers[l]->initialize(init, stream);
+        }
+    }
+
+    void initialize(WeightInit init) { initialize(init, Random::nextStream()); }
+
+    // Flush denormals to zero during train() and predict() (on by default)
+    // Denormal arithmetic is so slow that a float network whose gradients decay into the
+    // denormal range can train several times slower than the same network in double.
+    // The caller's own floating-point mode is restored when each call returns.
+    void setFlushDenormals(bool enabled) { flush_denormals = enabled; }
+    bool getFlushDenormals() const { return flush_denormals; }
+
+    // Size the training workspace for batches of up to max_batch_rows rows up front
+    // Optional: train() grows the workspace on demand, this only moves the allocations
+    // out of the first step
+    void reserveWorkspace(size_t max_batch_rows) {
+        if (graph.getLayers().empty()) return;
+        const size_t count = shardsFor(max_batch_rows);
+        prepareParameters();
+        prepareShards(count, (max_batch_rows + count - 1) / count);
     }
 
     // Forward propagation: Process input through all layers
     // Returns final layer output (network prediction)
-    Matrix<T> forward(const Matrix<T>& input) {
-        Matrix<T> current = input;
-        // Pass data through each layer sequentially
-        for (auto& layer : layers) {
-            current = layer->forward(current);
-        }
-        return current;
+    // The activations stay in the network's workspace, and the input is read in place:
+    // it must stay alive until backward() runs
+    Matrix<T> forward(MatrixView<const T> input) {
+        if (graph.getLayers().empty()) return Matrix<T>(input);
+        return Matrix<T>(graph.forward(pass, input));
     }
 
     // Backward propagation: Update network weights based on error
-    // Returns computed loss value for monitoring training progress
+    // Every layer takes a plain gradient descent step on the gradients of the last forward()
+    // Returns the loss of the last forward() output, for monitoring training progress
     T backward(const Matrix<T>& expected, T learning_rate) {
-        // Compute initial error from loss function derivative
-        Matrix<T> error = loss_function->derivative(layers.back()->getOutput(), expected);
-        
-        // Propagate error backward through network
-        // Each layer updates its weights and returns propagated error
-        for (auto it = layers.rbegin(); it != layers.rend(); ++it) {
-            error = (*it)->backward(error, learning_rate);
+        preparePassGradients();
+        const T loss = graph.backward(pass, *loss_function, expected, T(1), pass_gradients);
+        const auto& layers = graph.getLayers();
+        for (size_t l = 0; l < layers.size(); ++l) layers[l]->applyGradients(pass_gradients[l], learning_rate);
+        return loss;
+    }
+
+    // Training step: one optimizer update on the whole batch
+    // The batch is split into row shards processed in parallel, each with its own
+    // cached activations and gradients; the shard gradients are tree-reduced and
+    // applied in a single optimizer step over the parameter arena. learning_rate is the
+    // base rate handed to the schedule, if any. Returns the loss before the update.
+    // Accepts views, so mini-batches can be sliced from a larger dataset without copying
+    T train(MatrixView<const T> input, MatrixView<const T> expected, T learning_rate) {
+        const size_t rows = input.getRows();
+        if (expected.getRows() != rows) {
+            throw std::invalid_argument("Input and expected batches have different row counts");
         }
+        const auto& layers = graph.getLayers();
+        if (layers.empty() || rows == 0) return 0;
+        NN_PROFILE_SCOPE("step", "train");
+        Simd::DenormalModeGuard denormals(flush_denormals ? Simd::FLUSH_DENORMALS : Simd::denormalMode());
+
+        const size_t count = shardsFor(rows);
+        prepareParameters();
+        prepareShards(count, (rows + count - 1) / count);
+
+        Parallel::parallelFor(0, count, 1, [&](size_t lo, size_t hi) {
+            for (size_t s = lo; s < hi; ++s) {
+                Shard& shard = shards[s];
+                const size_t first = rows * s / count;
+                const size_t size = rows * (s + 1) / count - first;
+
+                // Forward pass over this shard's rows
+                graph.forward(shard.workspace, input.rowRange(first, size));
 
-        // Return final loss value
-        return loss_function->calculate(layers.back()->getOutput(), expected);
+                // The loss is a mean over the batch: weight this shard by its share of rows
+                // Backward pass: gradients only, weights stay fixed until every shard is done
+                const T weight = static_cast<T>(size) / static_cast<T>(rows);
+                shard.loss = graph.backward(shard.workspace, *loss_function, expected.rowRange(first, size), weight,
+                                            shard.gradients);
+            }
+        });
+
+        reduceGradients(count);
+        const T rate = schedule ? schedule->rate(step_count, learning_rate) : learning_rate;
+        optimizer->step(parameters->data(), shards[0].gradient_arena.data(), parameters->size(), rate);
+        ++step_count;
+        for (auto& layer : layers) layer->refreshWeightCopies();
+        return shards[0].loss;
     }
 
-    // Training step: Combine forward and backward passes
-    // Returns loss value for current training step
-    T train(const Matrix<T>& input, const Matrix<T>& expected, T learning_rate) {
-        forward(input);
-        return backward(expected, learning_rate);
+    // One pass over a dataset in consecutive mini-batches of batch_size rows
+    // Each mini-batch is a view into the dataset and gets its own update
+    // Returns the row-weighted mean loss over the epoch
+    T trainEpoch(MatrixView<const T> input, MatrixView<const T> expected,
+                 size_t batch_size, T learning_rate) {
+        const size_t rows = input.getRows();
+        if (batch_size == 0) batch_size = rows;
+        T total_loss = 0;
+        for (size_t first = 0; first < rows; first += batch_size) {
+            const size_t size = std::min(batch_size, rows - first);
+            total_loss += train(input.rowRange(first, size), expected.rowRange(first, size), learning_rate) * size;
+        }
+        return rows > 0 ? total_loss / rows : 0;
+    }
+
+    // One pass over a streamed dataset, one update per batch the stream yields
+    // The stream is rewound afterwards, so it can prefetch the next epoch's first batch
+    // Returns the row-weighted mean loss over the epoch
+    T trainEpoch(Data::Stream<T>& stream, T learning_rate) {
+        size_t rows = 0;
+        T total_loss = 0;
+        while (const Data::Batch<T>* batch = stream.next()) {
+            total_loss += train(batch->input, batch->expected, learning_rate) * batch->input.getRows();
+            rows += batch->input.getRows();
+        }
+        stream.rewind();
+        return rows > 0 ? total_loss / rows : 0;
     }
 
     // Generate predictions for new input data
     // Used for inference after training
-    Matrix<T> predict(const Matrix<T>& input) {
-        return forward(input);
+    // Large batches are split into row blocks that run through the layers in parallel;
+    // each block runs in its thread's own workspace, so predict() may be called from
+    // several threads
+    Matrix<T> predict(MatrixView<const T> input) const {
+        if (graph.getLayers().empty()) return Matrix<T>(input);
+        Matrix<T> result(input.getRows(), graph.outputWidth());
+        checkInferenceShapes(input, result);
+        Simd::DenormalModeGuard denormals(flush_denormals ? Simd::FLUSH_DENORMALS : Simd::denormalMode());
+
+        Parallel::parallelFor(0, input.getRows(), PREDICT_GRAIN, [&](size_t lo, size_t hi) {
+            inferRows(input.rowRange(lo, hi - lo), result.view().rowRange(lo, hi - lo));
+        });
+        return result;
+    }
+
+    // Low-latency inference into caller-owned output ([input rows x output size])
+    // const and reentrant: any number of threads may call it at once on the same network,
+    // as long as no thread trains it meanwhile. Runs on the calling thread; intermediate
+    // activations live in a per-thread workspace, so once a thread has seen a batch size,
+    // later calls of that size perform no heap allocations.
+    void infer(MatrixView<const T> input, MatrixView<T> output) const {
+        if (graph.getLayers().empty()) {
+            throw std::invalid_argument("Cannot run inference on a network without layers");
+        }
+        checkInferenceShapes(input, output);
+        Simd::DenormalModeGuard denormals(flush_denormals ? Simd::FLUSH_DENORMALS : Simd::denormalMode());
+        inferRows(input, output);
+    }
+
+private:
+    void checkInferenceShapes(MatrixView<const T> input, MatrixView<const T> output) const {
+        if (input.getCols() != graph.inputWidth()) {
+            throw std::invalid_argument("Input does not match the network input size");
+        }
+        if (output.getRows() != input.getRows() || output.getCols() != graph.outputWidth()) {
+            throw std::invalid_argument("Output does not match the input rows and network output size");
+        }
     }
 };
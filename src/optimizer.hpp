@@ -0,0 +1,292 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "memory.hpp"
+#include "profiler.hpp"
+#include "simd.hpp"
+#include "thread_pool.hpp"
+
+// Optimizers: parameter update rules applied to a flat parameter buffer
+//
+// A network keeps all of its parameters in one ParameterArena and the summed gradients in
+// another with the same layout, so an optimizer step is one call over two flat arrays
+// (plus the optimizer's own state arrays of the same length). Each step is a single fused,
+// in-place pass dispatched to the scalar, AVX2 or AVX-512 kernel picked by
+// Simd::activeLevel() and split across the thread pool.
+//
+//   SGD    plain or momentum / Nesterov, optional L2 weight decay
+//   Adam   Adam with L2 weight decay, or AdamW with decoupled weight decay
+//
+// Learning-rate schedules map the step number and the base rate passed to train() to the
+// rate of that step.
+namespace Optim {
+    namespace detail {
+        // Per-step constants of the SGD kernels
+        template<typename T>
+        struct SgdConfig {
+            T learning_rate;
+            T momentum;
+            T weight_decay;
+            bool nesterov;
+        };
+
+        // Per-step constants of the Adam kernel, bias corrections folded in
+        template<typename T>
+        struct AdamConfig {
+            T step_size;              // learning_rate / (1 - beta1^t)
+            T inv_sqrt_correction2;   // 1 / sqrt(1 - beta2^t)
+            T beta1;
+            T beta2;
+            T eps;
+            T weight_decay;           // L2 penalty added to the gradient (Adam)
+            T decay;                  // Factor applied to the parameters first (AdamW)
+        };
+
+        namespace portable {
+#include "optimizer_kernel.inl"
+        }
+
+#if NN_SIMD_X86
+NN_SIMD_BEGIN_AVX2
+        namespace avx2 {
+#include "optimizer_kernel.inl"
+        }
+NN_SIMD_END
+
+NN_SIMD_BEGIN_AVX512
+        namespace avx512 {
+#include "optimizer_kernel.inl"
+        }
+NN_SIMD_END
+#endif
+
+        // Update kernels for one instruction set
+        template<typename T>
+        struct Kernels {
+            void (*sgd)(T*, const T*, size_t, const SgdConfig<T>&);
+            void (*momentum)(T*, const T*, T*, size_t, const SgdConfig<T>&);
+            void (*adam)(T*, const T*, T*, T*, size_t, const AdamConfig<T>&);
+        };
+
+        template<typename T>
+        const Kernels<T>& select(Simd::Level level) {
+            using Scalar = Simd::ScalarOps<T>;
+            static const Kernels<T> scalar{&portable::sgd<Scalar>, &portable::momentum<Scalar>, &portable::adam<Scalar>};
+#if NN_SIMD_X86
+            static const Kernels<T> avx2{&avx2::sgd<Simd::Avx2Ops<T>>, &avx2::momentum<Simd::Avx2Ops<T>>,
+                                         &avx2::adam<Simd::Avx2Ops<T>>};
+            static const Kernels<T> avx512{&avx512::sgd<Simd::Avx512Ops<T>>, &avx512::momentum<Simd::Avx512Ops<T>>,
+                                           &avx512::adam<Simd::Avx512Ops<T>>};
+            if (level == Simd::Level::AVX512) return avx512;
+            if (level == Simd::Level::AVX2) return avx2;
+#else
+            (void)level;
+#endif
+            return scalar;
+        }
+
+        template<typename T>
+        using Buffer = std::vector<T, Memory::AlignedAllocator<T>>;
+
+        // Zeroed state buffer of count elements; kept when it already has that size
+        template<typename T>
+        void sizeState(Buffer<T>& state, size_t count) {
+            if (state.size() != count) state.assign(count, T(0));
+        }
+
+        inline void checkFraction(double value, const char* what) {
+            if (!(value >= 0 && value < 1)) {
+                throw std::invalid_argument(std::string(what) + " must be in [0, 1)");
+            }
+        }
+    }
+
+    // Base class of all update rules
+    // An optimizer instance belongs to one parameter buffer: its state arrays are sized on
+    // the first step and start over (as after reset()) when the element count changes
+    template<typename T>
+    class Optimizer {
+    public:
+        virtual ~Optimizer() = default;
+
+        // Update count parameters in place from their gradients
+        virtual void step(T* params, const T* grads, size_t count, T learning_rate) = 0;
+
+        // Forget all state (moments, step counter)
+        virtual void reset() = 0;
+
+        virtual std::string name() const = 0;
+    };
+
+    // Stochastic gradient descent, optionally with (Nesterov) momentum and L2 weight decay
+    template<typename T>
+    class SGD : public Optimizer<T> {
+    private:
+        T momentum;
+        T weight_decay;
+        bool nesterov;
+        detail::Buffer<T> velocity;
+
+    public:
+        explicit SGD(T momentum = 0, T weight_decay = 0, bool nesterov = false)
+            : momentum(momentum), weight_decay(weight_decay), nesterov(nesterov) {
+            detail::checkFraction(momentum, "Momentum");
+            if (!(weight_decay >= 0)) throw std::invalid_argument("Weight decay must not be negative");
+            if (nesterov && momentum == 0) throw std::invalid_argument("Nesterov momentum needs a momentum above 0");
+        }
+
+        void step(T* params, const T* grads, size_t count, T learning_rate) override {
+            NN_PROFILE_SCOPE_WORK("op", "update", count * (momentum > 0 ? 5 : 4),
+                                  count * (momentum > 0 ? 5 : 3) * sizeof(T));
+            const detail::SgdConfig<T> config{learning_rate, momentum, weight_decay, nesterov};
+            const detail::Kernels<T>& kernels = detail::select<T>(Simd::activeLevel());
+            if (momentum == 0) {
+                Parallel::parallelFor(0, count, Parallel::ELEMENTWISE_GRAIN, [&](size_t lo, size_t hi) {
+                    kernels.sgd(params + lo, grads + lo, hi - lo, config);
+                });
+                return;
+            }
+            detail::sizeState(velocity, count);
+            T* v = velocity.data();
+            Parallel::parallelFor(0, count, Parallel::ELEMENTWISE_GRAIN, [&](size_t lo, size_t hi) {
+                kernels.momentum(params + lo, grads + lo, v + lo, hi - lo, config);
+            });
+        }
+
+        void reset() override { velocity.clear(); }
+
+        std::string name() const override { return momentum > 0 ? (nesterov ? "sgd-nesterov" : "sgd-momentum") : "sgd"; }
+    };
+
+    // Adam (Kingma & Ba) with bias-corrected moment estimates
+    // decoupled = true gives AdamW: weight decay shrinks the parameters directly instead of
+    // being added to the gradient, so it is not rescaled by the adaptive step size
+    template<typename T>
+    class Adam : public Optimizer<T> {
+    private:
+        T beta1;
+        T beta2;
+        T eps;
+        T weight_decay;
+        bool decoupled;
+        size_t steps = 0;
+        detail::Buffer<T> first;      // Moving average of the gradients
+        detail::Buffer<T> second;     // Moving average of the squared gradients
+
+    public:
+        explicit Adam(T beta1 = T(0.9), T beta2 = T(0.999), T eps = T(1e-8), T weight_decay = 0, bool decoupled = false)
+            : beta1(beta1), beta2(beta2), eps(eps), weight_decay(weight_decay), decoupled(decoupled) {
+            detail::checkFraction(beta1, "beta1");
+            detail::checkFraction(beta2, "beta2");
+            if (!(eps > 0)) throw std::invalid_argument("Adam epsilon must be positive");
+            if (!(weight_decay >= 0)) throw std::invalid_argument("Weight decay must not be negative");
+        }
+
+        void step(T* params, const T* grads, size_t count, T learning_rate) override {
+            NN_PROFILE_SCOPE_WORK("op", "update", count * 13, count * 7 * sizeof(T));
+            if (first.size() != count) steps = 0;
+            detail::sizeState(first, count);
+            detail::sizeState(second, count);
+            ++steps;
+
+            // Bias corrections in double: beta^t underflows gracefully and 1 - beta^t keeps its digits
+            const double correction1 = 1.0 - std::pow(double(beta1), double(steps));
+            const double correction2 = 1.0 - std::pow(double(beta2), double(steps));
+            const detail::AdamConfig<T> config{
+                static_cast<T>(learning_rate / correction1),
+                static_cast<T>(1.0 / std::sqrt(correction2)),
+                beta1, beta2, eps,
+                decoupled ? T(0) : weight_decay,
+                decoupled ? T(1) - learning_rate * weight_decay : T(1)};
+            const detail::Kernels<T>& kernels = detail::select<T>(Simd::activeLevel());
+            T* m = first.data();
+            T* v = second.data();
+            Parallel::parallelFor(0, count, Parallel::ELEMENTWISE_GRAIN, [&](size_t lo, size_t hi) {
+                kernels.adam(params + lo, grads + lo, m + lo, v + lo, hi - lo, config);
+            });
+        }
+
+        void reset() override {
+            first.clear();
+            second.clear();
+            steps = 0;
+        }
+
+        std::string name() const override { return decoupled ? "adamw" : "adam"; }
+    };
+
+    // AdamW: Adam with decoupled weight decay (Loshchilov & Hutter)
+    template<typename T>
+    std::shared_ptr<Adam<T>> adamW(T weight_decay = T(0.01), T beta1 = T(0.9), T beta2 = T(0.999), T eps = T(1e-8)) {
+        return std::make_shared<Adam<T>>(beta1, beta2, eps, weight_decay, true);
+    }
+
+    // Learning-rate schedule: rate of step `step` (counted from 0) given the base rate
+    template<typename T>
+    class Schedule {
+    public:
+        virtual ~Schedule() = default;
+        virtual T rate(size_t step, T base_rate) const = 0;
+    };
+
+    // Multiply the rate by gamma every `interval` steps
+    template<typename T>
+    class StepDecay : public Schedule<T> {
+    private:
+        size_t interval;
+        T gamma;
+
+    public:
+        StepDecay(size_t interval, T gamma) : interval(interval), gamma(gamma) {
+            if (interval == 0) throw std::invalid_argument("Step decay interval must be positive");
+        }
+
+        T rate(size_t step, T base_rate) const override {
+            return base_rate * static_cast<T>(std::pow(double(gamma), double(step / interval)));
+        }
+    };
+
+    // Cosine annealing from the base rate down to floor_fraction * base over total_steps,
+    // then constant at the floor
+    template<typename T>
+    class CosineDecay : public Schedule<T> {
+    private:
+        static constexpr double PI = 3.14159265358979323846;
+        size_t total_steps;
+        T floor_fraction;
+
+    public:
+        explicit CosineDecay(size_t total_steps, T floor_fraction = 0)
+            : total_steps(total_steps), floor_fraction(floor_fraction) {
+            if (total_steps == 0) throw std::invalid_argument("Cosine decay needs at least one step");
+        }
+
+        T rate(size_t step, T base_rate) const override {
+            const double progress = step >= total_steps ? 1.0 : double(step) / double(total_steps);
+            const double factor = floor_fraction + (1.0 - floor_fraction) * 0.5 * (1.0 + std::cos(PI * progress));
+            return static_cast<T>(base_rate * factor);
+        }
+    };
+
+    // Linear warm-up over the first warmup_steps steps, then `after` (counted from the end
+    // of the warm-up) or the constant base rate
+    template<typename T>
+    class Warmup : public Schedule<T> {
+    private:
+        size_t warmup_steps;
+        std::shared_ptr<const Schedule<T>> after;
+
+    public:
+        explicit Warmup(size_t warmup_steps, std::shared_ptr<const Schedule<T>> after = nullptr)
+            : warmup_steps(warmup_steps), after(std::move(after)) {}
+
+        T rate(size_t step, T base_rate) const override {
+            if (step < warmup_steps) return base_rate * static_cast<T>(step + 1) / static_cast<T>(warmup_steps);
+            return after ? after->rate(step - warmup_steps, base_rate) : base_rate;
+        }
+    };
+}
@@ -0,0 +1,81 @@
+// Fused optimizer update kernels
+// Included once per SIMD region (AVX2, AVX-512) and once without target options (scalar)
+// by optimizer.hpp. Do not include directly.
+//
+// Every kernel makes a single in-place pass: each element's parameter, gradient and state
+// are loaded once, combined in registers and stored back. Full vectors go through Ops, the
+// tail through Simd::ScalarOps with the same formula.
+//
+// Ops: lane operations from simd.hpp; SgdConfig / AdamConfig are defined in optimizer.hpp
+
+// p -= lr * (g + weight_decay * p)
+template<typename L>
+inline void sgdLanes(typename L::T* params, const typename L::T* grads, const SgdConfig<typename L::T>& config) {
+    typename L::V p = L::load(params);
+    typename L::V g = L::fma(L::broadcast(config.weight_decay), p, L::load(grads));
+    L::store(params, L::fma(L::broadcast(-config.learning_rate), g, p));
+}
+
+// Heavy-ball momentum: v = momentum * v + g;  p -= lr * v
+// Nesterov: p -= lr * (g + momentum * v) with the updated v
+template<typename L>
+inline void momentumLanes(typename L::T* params, const typename L::T* grads, typename L::T* velocity,
+                          const SgdConfig<typename L::T>& config) {
+    const typename L::V momentum = L::broadcast(config.momentum);
+    typename L::V p = L::load(params);
+    typename L::V g = L::fma(L::broadcast(config.weight_decay), p, L::load(grads));
+    typename L::V v = L::fma(momentum, L::load(velocity), g);
+    typename L::V step = config.nesterov ? L::fma(momentum, v, g) : v;
+    L::store(velocity, v);
+    L::store(params, L::fma(L::broadcast(-config.learning_rate), step, p));
+}
+
+// Adam / AdamW:
+//   p *= decay                           (AdamW decoupled weight decay; 1 for Adam)
+//   g += weight_decay * p                (Adam L2 penalty; 0 for AdamW)
+//   m = beta1 * m + (1 - beta1) * g
+//   v = beta2 * v + (1 - beta2) * g^2
+//   p -= step_size * m / (sqrt(v) * inv_sqrt_correction2 + eps)
+// step_size and inv_sqrt_correction2 carry the bias corrections of the current step
+template<typename L>
+inline void adamLanes(typename L::T* params, const typename L::T* grads, typename L::T* first, typename L::T* second,
+                      const AdamConfig<typename L::T>& config) {
+    using T = typename L::T;
+    typename L::V p = L::mul(L::load(params), L::broadcast(config.decay));
+    typename L::V g = L::fma(L::broadcast(config.weight_decay), p, L::load(grads));
+    typename L::V m = L::fma(L::broadcast(config.beta1), L::load(first), L::mul(L::broadcast(T(1) - config.beta1), g));
+    typename L::V v = L::fma(L::broadcast(config.beta2), L::load(second),
+                             L::mul(L::broadcast(T(1) - config.beta2), L::mul(g, g)));
+    typename L::V denominator = L::fma(L::sqrt(v), L::broadcast(config.inv_sqrt_correction2), L::broadcast(config.eps));
+    L::store(first, m);
+    L::store(second, v);
+    L::store(params, L::sub(p, L::div(L::mul(L::broadcast(config.step_size), m), denominator)));
+}
+
+template<typename Ops>
+void sgd(typename Ops::T* params, const typename Ops::T* grads, size_t count,
+         const SgdConfig<typename Ops::T>& config) {
+    size_t i = 0;
+    for (; i + Ops::lanes <= count; i += Ops::lanes) sgdLanes<Ops>(params + i, grads + i, config);
+    for (; i < count; ++i) sgdLanes<Simd::ScalarOps<typename Ops::T>>(params + i, grads + i, config);
+}
+
+template<typename Ops>
+void momentum(typename Ops::T* params, const typename Ops::T* grads, typename Ops::T* velocity, size_t count,
+              const SgdConfig<typename Ops::T>& config) {
+    using Scalar = Simd::ScalarOps<typename Ops::T>;
+    size_t i = 0;
+    for (; i + Ops::lanes <= count; i += Ops::lanes) momentumLanes<Ops>(params + i, grads + i, velocity + i, config);
+    for (; i < count; ++i) momentumLanes<Scalar>(params + i, grads + i, velocity + i, config);
+}
+
+template<typename Ops>
+void adam(typename Ops::T* params, const typename Ops::T* grads, typename Ops::T* first, typename Ops::T* second,
+          size_t count, const AdamConfig<typename Ops::T>& config) {
+    using Scalar = Simd::ScalarOps<typename Ops::T>;
+    size_t i = 0;
+    for (; i + Ops::lanes <= count; i += Ops::lanes) {
+        adamLanes<Ops>(params + i, grads + i, first + i, second + i, config);
+    }
+    for (; i < count; ++i) adamLanes<Scalar>(params + i, grads + i, first + i, second + i, config);
+}
@@ -0,0 +1,260 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include "simd.hpp"
+#include "thread_pool.hpp"
+
+// Reduced-precision storage formats for mixed-precision training
+// Values are stored as 16-bit patterns (uint16_t) and always computed on in T (float or
+// double): codecs decode while GEMM packs its panels and encode when results are stored.
+namespace Precision {
+    // Storage format of weights and activations
+    // Native stores T itself; the 16-bit formats keep a T master copy of the weights
+    enum class Format { Native, BFloat16, Float16 };
+
+    inline const char* name(Format format) {
+        switch (format) {
+            case Format::BFloat16: return "bf16";
+            case Format::Float16: return "fp16";
+            default: return "native";
+        }
+    }
+
+    namespace detail {
+        inline uint32_t bits(float value) {
+            uint32_t result;
+            std::memcpy(&result, &value, sizeof(result));
+            return result;
+        }
+
+        inline float fromBits(uint32_t value) {
+            float result;
+            std::memcpy(&result, &value, sizeof(result));
+            return result;
+        }
+    }
+
+    // Identity codec: operands already stored as T
+    template<typename T>
+    struct Native {
+        using Storage = T;
+        static T decode(T value) { return value; }
+        static T encode(T value) { return value; }
+    };
+
+    // bfloat16: the upper half of an IEEE float (8-bit exponent, 7-bit mantissa)
+    // Same range as float, so no overflow handling; encode rounds to nearest even
+    struct BFloat16 {
+        using Storage = uint16_t;
+
+        static float decode(uint16_t value) {
+            return detail::fromBits(static_cast<uint32_t>(value) << 16);
+        }
+
+        static uint16_t encode(float value) {
+            const uint32_t f = detail::bits(value);
+            if ((f & 0x7fffffffu) > 0x7f800000u) {
+                return static_cast<uint16_t>((f >> 16) | 0x0040u);  // Keep NaN quiet
+            }
+            return static_cast<uint16_t>((f + 0x7fffu + ((f >> 16) & 1u)) >> 16);
+        }
+    };
+
+    // IEEE half precision (5-bit exponent, 10-bit mantissa), max 65504
+    // encode rounds to nearest even, flushes overflow to inf and keeps subnormals
+    struct Float16 {
+        using Storage = uint16_t;
+
+        static float decode(uint16_t value) {
+            const uint32_t shifted_exponent = 0x7c00u << 13;
+            uint32_t out = (value & 0x7fffu) << 13;
+            const uint32_t exponent = out & shifted_exponent;
+            out += (127u - 15u) << 23;  // Rebias the exponent
+            if (exponent == shifted_exponent) {
+                out += (128u - 16u) << 23;  // Inf / NaN
+            } else if (exponent == 0) {
+                // Zero / subnormal: renormalize through a float subtraction
+                out += 1u << 23;
+                out = detail::bits(detail::fromBits(out) - detail::fromBits(113u << 23));
+            }
+            return detail::fromBits(out | (static_cast<uint32_t>(value & 0x8000u) << 16));
+        }
+
+        static uint16_t encode(float value) {
+            const uint32_t infinity = 255u << 23;
+            const uint32_t overflow = (127u + 16u) << 23;   // First float that rounds to inf
+            const uint32_t denormal_magic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+            uint32_t f = detail::bits(value);
+            const uint32_t sign = f & 0x80000000u;
+            f ^= sign;
+
+            uint32_t out;
+            if (f >= overflow) {
+                out = f > infinity ? 0x7e00u : 0x7c00u;
+            } else if (f < (113u << 23)) {
+                // Result is subnormal: let the FPU round by adding a magic number
+                out = detail::bits(detail::fromBits(f) + detail::fromBits(denormal_magic)) - denormal_magic;
+            } else {
+                const uint32_t mantissa_odd = (f >> 13) & 1u;
+                f += (static_cast<uint32_t>(15 - 127) << 23) + 0xfffu + mantissa_odd;
+                out = f >> 13;
+            }
+            return static_cast<uint16_t>(out | (sign >> 16));
+        }
+    };
+
+    namespace detail {
+        // fp16 <-> float runs: F16C / AVX-512F convert 8 / 16 lanes per instruction with the
+        // same round-to-nearest-even as Float16 (NaN payloads aside); tails use the codec.
+        // Full-mask AVX-512 forms for the same GCC warning as in simd.hpp
+        namespace portable {
+            inline void encodeHalf(const float* in, uint16_t* out, size_t count) {
+                for (size_t i = 0; i < count; ++i) out[i] = Float16::encode(in[i]);
+            }
+
+            inline void decodeHalf(const uint16_t* in, float* out, size_t count) {
+                for (size_t i = 0; i < count; ++i) out[i] = Float16::decode(in[i]);
+            }
+        }
+
+#if NN_SIMD_X86
+NN_SIMD_BEGIN_AVX2F16C
+        namespace avx2 {
+            inline void encodeHalf(const float* in, uint16_t* out, size_t count) {
+                size_t i = 0;
+                for (; i + 8 <= count; i += 8) {
+                    const __m128i half = _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), half);
+                }
+                portable::encodeHalf(in + i, out + i, count - i);
+            }
+
+            inline void decodeHalf(const uint16_t* in, float* out, size_t count) {
+                size_t i = 0;
+                for (; i + 8 <= count; i += 8) {
+                    const __m128i half = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+                    _mm256_storeu_ps(out + i, _mm256_cvtph_ps(half));
+                }
+                portable::decodeHalf(in + i, out + i, count - i);
+            }
+        }
+NN_SIMD_END
+
+NN_SIMD_BEGIN_AVX512
+        namespace avx512 {
+            inline void encodeHalf(const float* in, uint16_t* out, size_t count) {
+                size_t i = 0;
+                for (; i + 16 <= count; i += 16) {
+                    const __m256i half = _mm512_mask_cvtps_ph(_mm256_setzero_si256(), 0xFFFF, _mm512_loadu_ps(in + i),
+                                                              _MM_FROUND_TO_NEAREST_INT);
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), half);
+                }
+                portable::encodeHalf(in + i, out + i, count - i);
+            }
+
+            inline void decodeHalf(const uint16_t* in, float* out, size_t count) {
+                size_t i = 0;
+                for (; i + 16 <= count; i += 16) {
+                    const __m256i half = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+                    _mm512_storeu_ps(out + i, _mm512_mask_cvtph_ps(_mm512_setzero_ps(), 0xFFFF, half));
+                }
+                portable::decodeHalf(in + i, out + i, count - i);
+            }
+        }
+NN_SIMD_END
+#endif
+
+        // fp16 run kernels for one instruction set
+        struct HalfKernels {
+            void (*encode)(const float*, uint16_t*, size_t);
+            void (*decode)(const uint16_t*, float*, size_t);
+        };
+
+        inline const HalfKernels& selectHalf(Simd::Level level) {
+            static const HalfKernels scalar{&portable::encodeHalf, &portable::decodeHalf};
+#if NN_SIMD_X86
+            static const HalfKernels avx2{&avx2::encodeHalf, &avx2::decodeHalf};
+            static const HalfKernels avx512{&avx512::encodeHalf, &avx512::decodeHalf};
+            if (level == Simd::Level::AVX512) return avx512;
+            if (level == Simd::Level::AVX2 && Simd::hasF16c()) return avx2;
+#else
+            (void)level;
+#endif
+            return scalar;
+        }
+
+        template<typename Codec, typename T>
+        constexpr bool vectorHalf = std::is_same<Codec, Float16>::value && std::is_same<T, float>::value;
+    }
+
+    // Encode / decode one contiguous run on the calling thread
+    // fp16 runs of floats go through the dispatched conversion kernels
+    template<typename Codec, typename T>
+    void encodeRun(const T* in, typename Codec::Storage* out, size_t count) {
+        if constexpr (detail::vectorHalf<Codec, T>) {
+            detail::selectHalf(Simd::activeLevel()).encode(in, out, count);
+        } else {
+            for (size_t i = 0; i < count; ++i) out[i] = Codec::encode(static_cast<float>(in[i]));
+        }
+    }
+
+    template<typename Codec, typename T>
+    void decodeRun(const typename Codec::Storage* in, T* out, size_t count) {
+        if constexpr (detail::vectorHalf<Codec, T>) {
+            detail::selectHalf(Simd::activeLevel()).decode(in, out, count);
+        } else {
+            for (size_t i = 0; i < count; ++i) out[i] = static_cast<T>(Codec::decode(in[i]));
+        }
+    }
+
+    // encodeRun / decodeRun for a format chosen at runtime; nullptr for Format::Native
+    template<typename T>
+    using Encoder = void (*)(const T* in, uint16_t* out, size_t count);
+
+    template<typename T>
+    using Decoder = void (*)(const uint16_t* in, T* out, size_t count);
+
+    template<typename T>
+    Encoder<T> encoder(Format format) {
+        if (format == Format::BFloat16) return &encodeRun<BFloat16, T>;
+        if (format == Format::Float16) return &encodeRun<Float16, T>;
+        return nullptr;
+    }
+
+    template<typename T>
+    Decoder<T> decoder(Format format) {
+        if (format == Format::BFloat16) return &decodeRun<BFloat16, T>;
+        if (format == Format::Float16) return &decodeRun<Float16, T>;
+        return nullptr;
+    }
+
+    // Bulk conversions, split across the thread pool for large arrays
+    template<typename Codec, typename T>
+    void encode(const T* in, typename Codec::Storage* out, size_t count) {
+        Parallel::parallelFor(0, count, Parallel::ELEMENTWISE_GRAIN, [&](size_t lo, size_t hi) {
+            encodeRun<Codec>(in + lo, out + lo, hi - lo);
+        });
+    }
+
+    template<typename Codec, typename T>
+    void decode(const typename Codec::Storage* in, T* out, size_t count) {
+        Parallel::parallelFor(0, count, Parallel::ELEMENTWISE_GRAIN, [&](size_t lo, size_t hi) {
+            decodeRun<Codec>(in + lo, out + lo, hi - lo);
+        });
+    }
+
+    // Runtime-format wrappers for the 16-bit formats
+    template<typename T>
+    void encode(Format format, const T* in, uint16_t* out, size_t count) {
+        if (format == Format::BFloat16) encode<BFloat16>(in, out, count);
+        else if (format == Format::Float16) encode<Float16>(in, out, count);
+    }
+
+    template<typename T>
+    void decode(Format format, const uint16_t* in, T* out, size_t count) {
+        if (format == Format::BFloat16) decode<BFloat16>(in, out, count);
+        else if (format == Format::Float16) decode<Float16>(in, out, count);
+    }
+}
@@ -0,0 +1,261 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Training profiler: scoped timers with FLOP, byte and allocation counters
+//
+// Build with -DNN_PROFILE to compile the instrumentation in. Without it every NN_PROFILE_*
+// macro expands to nothing (its arguments are not even evaluated), so the library code
+// carries no profiling cost at all.
+//
+// Scopes are grouped by category:
+//   step   whole NeuralNetwork::train() calls
+//   layer  forward / backward of one layer (the name carries the layer index)
+//   op     gemm, bias, activation, activation_backward, bias_gradient, loss, reduce, update
+// GEMMs with a fused epilogue include the bias and activation applied to each tile; the
+// separate bias / activation scopes only appear for activations without fused kernels.
+//
+// Each thread records into its own buffer, so scopes on pool threads cost two clock reads
+// and a push_back. Read results (summary / writeChromeTrace) while no profiled work runs.
+//
+//   NN_PROFILE_SCOPE(category, name)
+//   NN_PROFILE_SCOPE_INDEX(category, name, index)         e.g. layer index
+//   NN_PROFILE_SCOPE_WORK(category, name, flops, bytes)   counts work done in the scope
+//   NN_PROFILE_ALLOCATION(bytes)                          called by Memory::AlignedAllocator
+
+#ifdef NN_PROFILE
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace Profile {
+    // One finished scope
+    struct Event {
+        const char* category;
+        const char* name;
+        int64_t index;          // -1 when the scope has no index
+        uint64_t start_ns;      // Since the profiler's epoch
+        uint64_t duration_ns;
+        uint64_t flops;         // Work done in the scope, nested scopes on the same thread included
+        uint64_t bytes;
+        uint64_t allocations;   // Allocator calls made inside the scope on its thread
+        uint64_t allocated_bytes;
+        uint32_t thread;
+    };
+
+    namespace detail {
+        using Clock = std::chrono::steady_clock;
+
+        // Events are reserved in blocks this large, so recording rarely allocates
+        constexpr size_t EVENT_BLOCK = 1 << 15;
+
+        struct ThreadLog {
+            std::vector<Event> events;
+            uint32_t thread = 0;
+            // Running totals; scopes record the difference over their lifetime
+            uint64_t flops = 0;
+            uint64_t bytes = 0;
+            uint64_t allocations = 0;
+            uint64_t allocated_bytes = 0;
+        };
+
+        struct Registry {
+            std::mutex mutex;
+            std::vector<std::shared_ptr<ThreadLog>> logs;
+            std::atomic<bool> enabled{true};
+            const Clock::time_point epoch = Clock::now();
+        };
+
+        inline Registry& registry() {
+            static Registry instance;
+            return instance;
+        }
+
+        // The calling thread's log, registered on first use; logs outlive their threads
+        inline ThreadLog& threadLog() {
+            thread_local std::shared_ptr<ThreadLog> log = [] {
+                auto created = std::make_shared<ThreadLog>();
+                created->events.reserve(EVENT_BLOCK);
+                Registry& reg = registry();
+                std::lock_guard<std::mutex> lock(reg.mutex);
+                created->thread = static_cast<uint32_t>(reg.logs.size());
+                reg.logs.push_back(created);
+                return created;
+            }();
+            return *log;
+        }
+
+        inline uint64_t now() {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                Clock::now() - registry().epoch).count());
+        }
+
+        // "name" or "name[index]"
+        inline std::string label(const Event& event) {
+            if (event.index < 0) return event.name;
+            return std::string(event.name) + "[" + std::to_string(event.index) + "]";
+        }
+    }
+
+    // Pause or resume recording (on by default when compiled in)
+    inline void setEnabled(bool on) { detail::registry().enabled.store(on, std::memory_order_relaxed); }
+    inline bool isEnabled() { return detail::registry().enabled.load(std::memory_order_relaxed); }
+
+    inline void countAllocation(size_t bytes) {
+        detail::ThreadLog& log = detail::threadLog();
+        ++log.allocations;
+        log.allocated_bytes += bytes;
+    }
+
+    // Times its own lifetime and records it as an Event
+    class Scope {
+    private:
+        const char* category;
+        const char* name;
+        int64_t index;
+        uint64_t flops;
+        uint64_t bytes;
+        detail::ThreadLog* log = nullptr;  // Null when recording is paused
+        uint64_t start = 0;
+        uint64_t flops_before = 0;
+        uint64_t bytes_before = 0;
+        uint64_t allocations = 0;
+        uint64_t allocated_bytes = 0;
+
+    public:
+        Scope(const char* category, const char* name, int64_t index = -1, uint64_t flops = 0, uint64_t bytes = 0)
+            : category(category), name(name), index(index), flops(flops), bytes(bytes) {
+            if (!isEnabled()) return;
+            log = &detail::threadLog();
+            flops_before = log->flops;
+            bytes_before = log->bytes;
+            allocations = log->allocations;
+            allocated_bytes = log->allocated_bytes;
+            start = detail::now();
+        }
+
+        ~Scope() {
+            if (!log) return;
+            const uint64_t end = detail::now();
+            log->flops += flops;
+            log->bytes += bytes;
+            if (log->events.size() == log->events.capacity()) log->events.reserve(log->events.size() + detail::EVENT_BLOCK);
+            log->events.push_back(Event{category, name, index, start, end - start, log->flops - flops_before,
+                                        log->bytes - bytes_before, log->allocations - allocations,
+                                        log->allocated_bytes - allocated_bytes, log->thread});
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    // Every recorded event of every thread, ordered by start time
+    inline std::vector<Event> events() {
+        detail::Registry& reg = detail::registry();
+        std::vector<Event> all;
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        for (const auto& log : reg.logs) all.insert(all.end(), log->events.begin(), log->events.end());
+        std::sort(all.begin(), all.end(), [](const Event& a, const Event& b) { return a.start_ns < b.start_ns; });
+        return all;
+    }
+
+    // Drop all recorded events (allocation counters keep running)
+    inline void reset() {
+        detail::Registry& reg = detail::registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        for (const auto& log : reg.logs) log->events.clear();
+    }
+
+    // Chrome trace-event JSON (chrome://tracing, Perfetto): one complete ("X") event per scope
+    inline void writeChromeTrace(const std::string& path) {
+        std::ofstream out(path);
+        if (!out) throw std::runtime_error("Cannot create " + path);
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        bool first = true;
+        char buffer[160];
+        for (const Event& event : events()) {
+            // Names come from string literals in the library, so they need no escaping
+            out << (first ? "\n" : ",\n") << "{\"name\":\"" << detail::label(event) << "\",\"cat\":\""
+                << event.category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread;
+            std::snprintf(buffer, sizeof(buffer), ",\"ts\":%.3f,\"dur\":%.3f", event.start_ns / 1e3,
+                          event.duration_ns / 1e3);
+            out << buffer << ",\"args\":{\"flops\":" << event.flops << ",\"bytes\":" << event.bytes
+                << ",\"allocations\":" << event.allocations << ",\"allocated_bytes\":" << event.allocated_bytes << "}}";
+            first = false;
+        }
+        out << "\n]}\n";
+        if (!out) throw std::runtime_error("Cannot write " + path);
+    }
+
+    // Table of every (category, scope) with call count, total and mean time, share of the
+    // profiled wall time (summed over threads, so parallel scopes can exceed 100%),
+    // achieved GFLOP/s and GB/s, and allocations, slowest first
+    inline void summary(std::ostream& out) {
+        struct Row {
+            uint64_t calls = 0, ns = 0, flops = 0, bytes = 0, allocations = 0;
+        };
+        std::map<std::tuple<std::string, std::string>, Row> rows;
+        uint64_t first_start = UINT64_MAX, last_end = 0;
+        for (const Event& event : events()) {
+            Row& row = rows[std::make_tuple(std::string(event.category), detail::label(event))];
+            ++row.calls;
+            row.ns += event.duration_ns;
+            row.flops += event.flops;
+            row.bytes += event.bytes;
+            row.allocations += event.allocations;
+            first_start = std::min(first_start, event.start_ns);
+            last_end = std::max(last_end, event.start_ns + event.duration_ns);
+        }
+        const double wall = last_end > first_start ? double(last_end - first_start) : 1.0;
+
+        std::vector<std::pair<std::tuple<std::string, std::string>, Row>> sorted(rows.begin(), rows.end());
+        std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second.ns > b.second.ns; });
+
+        char line[200];
+        std::snprintf(line, sizeof(line), "%-6s %-22s %9s %11s %10s %7s %9s %8s %8s\n", "cat", "scope", "calls",
+                      "total ms", "mean us", "wall%", "GFLOP/s", "GB/s", "allocs");
+        out << line;
+        for (const auto& [key, row] : sorted) {
+            const double seconds = row.ns / 1e9;
+            std::snprintf(line, sizeof(line), "%-6s %-22s %9llu %11.3f %10.2f %7.1f %9.2f %8.2f %8llu\n",
+                          std::get<0>(key).c_str(), std::get<1>(key).c_str(), (unsigned long long)row.calls,
+                          row.ns / 1e6, row.ns / 1e3 / row.calls, 100.0 * row.ns / wall,
+                          row.flops && seconds > 0 ? row.flops / seconds / 1e9 : 0.0,
+                          row.bytes && seconds > 0 ? row.bytes / seconds / 1e9 : 0.0,
+                          (unsigned long long)row.allocations);
+            out << line;
+        }
+        std::snprintf(line, sizeof(line), "wall %.3f ms across %zu scopes\n", wall / 1e6, rows.size());
+        out << line;
+    }
+}
+
+#define NN_PROFILE_CONCAT_(a, b) a##b
+#define NN_PROFILE_CONCAT(a, b) NN_PROFILE_CONCAT_(a, b)
+#define NN_PROFILE_SCOPE(category, name) \
+    ::Profile::Scope NN_PROFILE_CONCAT(nn_profile_scope_, __LINE__)(category, name)
+#define NN_PROFILE_SCOPE_INDEX(category, name, index) \
+    ::Profile::Scope NN_PROFILE_CONCAT(nn_profile_scope_, __LINE__)(category, name, static_cast<int64_t>(index))
+#define NN_PROFILE_SCOPE_WORK(category, name, flops, bytes) \
+    ::Profile::Scope NN_PROFILE_CONCAT(nn_profile_scope_, __LINE__)(category, name, -1, (flops), (bytes))
+#define NN_PROFILE_ALLOCATION(bytes) ::Profile::countAllocation(bytes)
+
+#else
+
+#define NN_PROFILE_SCOPE(category, name)
+#define NN_PROFILE_SCOPE_INDEX(category, name, index)
+#define NN_PROFILE_SCOPE_WORK(category, name, flops, bytes)
+#define NN_PROFILE_ALLOCATION(bytes)
+
+#endif
@@ -0,0 +1,454 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "memory.hpp"
+#include "neural_network.hpp"
+#include "simd.hpp"
+#include "thread_pool.hpp"
+#include "utils.hpp"
+
+// Int8 inference for trained networks
+// Model freezes a NeuralNetwork into 8-bit weights and activations:
+//   weights      symmetric int8 per output channel, scale = max|w| / 127
+//   activations  asymmetric uint8 per layer input, range measured on a calibration batch
+// Each layer computes u8 x s8 dot products into int32, removes the zero point with the
+// precomputed channel sums, rescales to T and applies bias + activation in T
+// (ActivationFunction::forwardFused). The result is quantized again for the next layer;
+// the last layer returns T.
+namespace Quantized {
+    // Reduction length is padded to this multiple with zero weights, so the SIMD kernels
+    // never need a tail loop
+    constexpr size_t K_ALIGN = 64;
+
+    // Output channels computed together, sharing each load of the activations
+    constexpr size_t CHANNEL_BLOCK = 4;
+
+    // Widest layer input whose worst-case dot product (255 * 127 per term) fits in int32
+    constexpr size_t MAX_INPUTS = 66000;
+
+    inline size_t paddedLength(size_t k) { return (k + K_ALIGN - 1) / K_ALIGN * K_ALIGN; }
+
+    // Affine mapping of a layer input to uint8: real = scale * (q - zero_point)
+    struct ActivationRange {
+        float scale = 1.0f;
+        int32_t zero_point = 0;
+
+        // Range covering [min, max] and 0, so that zero padding and ReLU zeros are exact
+        static ActivationRange fromBounds(float min, float max) {
+            min = std::min(min, 0.0f);
+            max = std::max(max, 0.0f);
+            ActivationRange range;
+            if (max > min) {
+                range.scale = (max - min) / 255.0f;
+                range.zero_point = static_cast<int32_t>(std::nearbyint(-min / range.scale));
+                range.zero_point = std::clamp(range.zero_point, 0, 255);
+            }
+            return range;
+        }
+    };
+
+    namespace detail {
+        // out[i] = clamp(in[i] * inverse + offset, 0, 255), truncated; offset carries the
+        // zero point plus 0.5, so truncation rounds half up
+        template<typename T>
+        void quantizeScalar(const T* in, size_t count, float inverse, float offset, uint8_t* out) {
+            for (size_t i = 0; i < count; ++i) {
+                float value = static_cast<float>(in[i]) * inverse + offset;
+                value = std::min(std::max(value, 0.0f), 255.0f);
+                out[i] = static_cast<uint8_t>(static_cast<int32_t>(value));
+            }
+        }
+
+        // out[i * n + j] = sum_p a[i * k + p] * w[j * k + p] for i < rows, j < n
+        // k is a multiple of K_ALIGN; the SIMD kernels compute tiles of rows x channels so
+        // every activation and weight load feeds several dot products
+        using DotKernel = void (*)(const uint8_t* a, size_t rows, const int8_t* w, size_t k, size_t n, int32_t* out);
+
+        inline void dotScalar(const uint8_t* a, size_t rows, const int8_t* w, size_t k, size_t n, int32_t* out) {
+            for (size_t i = 0; i < rows; ++i) {
+                for (size_t j = 0; j < n; ++j) {
+                    int32_t sum = 0;
+                    for (size_t p = 0; p < k; ++p) sum += static_cast<int32_t>(a[i * k + p]) * w[j * k + p];
+                    out[i * n + j] = sum;
+                }
+            }
+        }
+
+#if NN_SIMD_X86
+NN_SIMD_BEGIN_AVX2
+        namespace avx2 {
+            constexpr size_t ROWS = 2;  // 2 x 4 accumulators stay within the 16 ymm registers
+
+            inline int32_t horizontalSum(__m256i v) {
+                __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+                sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+                sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+                return _mm_cvtsi128_si32(sum);
+            }
+
+            // Widen both operands to int16 and use madd: each pair sum is at most
+            // 2 * 255 * 128, so unlike maddubs nothing saturates
+            template<size_t R, size_t C>
+            inline void tile(const uint8_t* a, const int8_t* w, size_t k, size_t n, int32_t* out) {
+                __m256i acc[R][C];
+#pragma GCC unroll 4
+                for (size_t r = 0; r < R; ++r)
+#pragma GCC unroll 4
+                    for (size_t c = 0; c < C; ++c) acc[r][c] = _mm256_setzero_si256();
+                for (size_t p = 0; p < k; p += 16) {
+                    __m256i va[R];
+#pragma GCC unroll 4
+                    for (size_t r = 0; r < R; ++r) {
+                        va[r] = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + r * k + p)));
+                    }
+#pragma GCC unroll 4
+                    for (size_t c = 0; c < C; ++c) {
+                        const __m256i vw = _mm256_cvtepi8_epi16(
+                            _mm_loadu_si128(reinterpret_cast<const __m128i*>(w + c * k + p)));
+#pragma GCC unroll 4
+                        for (size_t r = 0; r < R; ++r) {
+                            acc[r][c] = _mm256_add_epi32(acc[r][c], _mm256_madd_epi16(va[r], vw));
+                        }
+                    }
+                }
+#pragma GCC unroll 4
+                for (size_t r = 0; r < R; ++r)
+#pragma GCC unroll 4
+                    for (size_t c = 0; c < C; ++c) out[r * n + c] = horizontalSum(acc[r][c]);
+            }
+
+            template<size_t R>
+            inline void rowBlock(const uint8_t* a, const int8_t* w, size_t k, size_t n, int32_t* out) {
+                size_t j = 0;
+                for (; j + CHANNEL_BLOCK <= n; j += CHANNEL_BLOCK) tile<R, CHANNEL_BLOCK>(a, w + j * k, k, n, out + j);
+                for (; j < n; ++j) tile<R, 1>(a, w + j * k, k, n, out + j);
+            }
+
+            inline void dot(const uint8_t* a, size_t rows, const int8_t* w, size_t k, size_t n, int32_t* out) {
+                size_t i = 0;
+                for (; i + ROWS <= rows; i += ROWS) rowBlock<ROWS>(a + i * k, w, k, n, out + i * n);
+                for (; i < rows; ++i) rowBlock<1>(a + i * k, w, k, n, out + i * n);
+            }
+
+            // 8 floats per step: clamp, truncate to int32, then pack down to bytes
+            inline void quantize(const float* in, size_t count, float inverse, float offset, uint8_t* out) {
+                const __m256 scale = _mm256_set1_ps(inverse), shift = _mm256_set1_ps(offset);
+                const __m256 lo = _mm256_setzero_ps(), hi = _mm256_set1_ps(255.0f);
+                size_t i = 0;
+                for (; i + 8 <= count; i += 8) {
+                    __m256 v = _mm256_fmadd_ps(_mm256_loadu_ps(in + i), scale, shift);
+                    const __m256i q = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(v, lo), hi));
+                    const __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(q), _mm256_extracti128_si256(q, 1));
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(words, words));
+                }
+                quantizeScalar(in + i, count - i, inverse, offset, out + i);
+            }
+        }
+NN_SIMD_END
+
+NN_SIMD_BEGIN_AVX512VNNI
+        namespace vnni {
+            constexpr size_t ROWS = 4;  // 4 x 4 accumulators of the 32 zmm registers
+
+            // Masked extracts: the unmasked forms (and the 256-bit cast) trip GCC 12's
+            // -Wmaybe-uninitialized, like the masked min/max in simd.hpp
+            inline int32_t horizontalSum(__m512i v) {
+                const __m256i low = _mm512_mask_extracti64x4_epi64(_mm256_setzero_si256(), 0xFF, v, 0);
+                const __m256i high = _mm512_mask_extracti64x4_epi64(_mm256_setzero_si256(), 0xFF, v, 1);
+                return avx2::horizontalSum(_mm256_add_epi32(low, high));
+            }
+
+            // vpdpbusd: 64 u8 x s8 products summed into 16 int32 lanes per instruction
+            template<size_t R, size_t C>
+            inline void tile(const uint8_t* a, const int8_t* w, size_t k, size_t n, int32_t* out) {
+                __m512i acc[R][C];
+#pragma GCC unroll 4
+                for (size_t r = 0; r < R; ++r)
+#pragma GCC unroll 4
+                    for (size_t c = 0; c < C; ++c) acc[r][c] = _mm512_setzero_si512();
+                for (size_t p = 0; p < k; p += 64) {
+                    __m512i va[R];
+#pragma GCC unroll 4
+                    for (size_t r = 0; r < R; ++r) va[r] = _mm512_loadu_si512(a + r * k + p);
+#pragma GCC unroll 4
+                    for (size_t c = 0; c < C; ++c) {
+                        const __m512i vw = _mm512_loadu_si512(w + c * k + p);
+#pragma GCC unroll 4
+                        for (size_t r = 0; r < R; ++r) acc[r][c] = _mm512_dpbusd_epi32(acc[r][c], va[r], vw);
+                    }
+                }
+#pragma GCC unroll 4
+                for (size_t r = 0; r < R; ++r)
+#pragma GCC unroll 4
+                    for (size_t c = 0; c < C; ++c) out[r * n + c] = horizontalSum(acc[r][c]);
+            }
+
+            template<size_t R>
+            inline void rowBlock(const uint8_t* a, const int8_t* w, size_t k, size_t n, int32_t* out) {
+                size_t j = 0;
+                for (; j + CHANNEL_BLOCK <= n; j += CHANNEL_BLOCK) tile<R, CHANNEL_BLOCK>(a, w + j * k, k, n, out + j);
+                for (; j < n; ++j) tile<R, 1>(a, w + j * k, k, n, out + j);
+            }
+
+            inline void dot(const uint8_t* a, size_t rows, const int8_t* w, size_t k, size_t n, int32_t* out) {
+                size_t i = 0;
+                for (; i + ROWS <= rows; i += ROWS) rowBlock<ROWS>(a + i * k, w, k, n, out + i * n);
+                for (; i < rows; ++i) rowBlock<1>(a + i * k, w, k, n, out + i * n);
+            }
+
+            // 16 floats per step; vpmovdb narrows the clamped int32 lanes to bytes
+            // (masked forms throughout, for the same GCC 12 warning as horizontalSum)
+            inline void quantize(const float* in, size_t count, float inverse, float offset, uint8_t* out) {
+                const __m512 scale = _mm512_set1_ps(inverse), shift = _mm512_set1_ps(offset);
+                const __m512 lo = _mm512_setzero_ps(), hi = _mm512_set1_ps(255.0f);
+                size_t i = 0;
+                for (; i + 16 <= count; i += 16) {
+                    __m512 v = _mm512_fmadd_ps(_mm512_loadu_ps(in + i), scale, shift);
+                    v = _mm512_mask_min_ps(v, 0xFFFF, _mm512_mask_max_ps(v, 0xFFFF, v, lo), hi);
+                    const __m512i q = _mm512_mask_cvttps_epi32(_mm512_setzero_si512(), 0xFFFF, v);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                                     _mm512_mask_cvtepi32_epi8(_mm_setzero_si128(), 0xFFFF, q));
+                }
+                quantizeScalar(in + i, count - i, inverse, offset, out + i);
+            }
+        }
+NN_SIMD_END
+#endif
+
+        template<typename T>
+        using QuantizeKernel = void (*)(const T* in, size_t count, float inverse, float offset, uint8_t* out);
+
+        template<typename T>
+        struct Kernels {
+            DotKernel dot;
+            QuantizeKernel<T> quantize;
+        };
+
+        // VNNI when the CPU has it and NN_SIMD allows AVX-512, else AVX2, else scalar
+        // Quantization is vectorized for float inputs; double uses the scalar loop
+        template<typename T>
+        Kernels<T> selectKernels() {
+            Kernels<T> kernels{&dotScalar, &quantizeScalar<T>};
+#if NN_SIMD_X86
+            if (Simd::hasVnni()) {
+                kernels.dot = &vnni::dot;
+                if constexpr (std::is_same_v<T, float>) kernels.quantize = &vnni::quantize;
+            } else if (Simd::activeLevel() >= Simd::Level::AVX2) {
+                kernels.dot = &avx2::dot;
+                if constexpr (std::is_same_v<T, float>) kernels.quantize = &avx2::quantize;
+            }
+#endif
+            return kernels;
+        }
+    }
+
+    // Quantize count values with range; out-of-range values saturate to 0 / 255
+    template<typename T>
+    void quantizeRow(const T* in, size_t count, const ActivationRange& range, uint8_t* out) {
+        detail::selectKernels<T>().quantize(in, count, 1.0f / range.scale,
+                                            static_cast<float>(range.zero_point) + 0.5f, out);
+    }
+
+    // One frozen fully connected layer
+    template<typename T>
+    struct FrozenLayer {
+        size_t inputs = 0;
+        size_t outputs = 0;
+        size_t padded_inputs = 0;                             // inputs rounded up to K_ALIGN
+        std::vector<int8_t, Memory::AlignedAllocator<int8_t>> weights;  // [outputs x padded_inputs]
+        std::vector<T> scales;                                // input scale * weight scale, per channel
+        std::vector<int32_t> zero_point_offsets;              // zero_point * sum of channel weights
+        std::vector<T> bias;
+        std::shared_ptr<Activation::ActivationFunction<T>> activation;
+        ActivationRange input;                                // Quantization of this layer's input
+    };
+
+    // Int8 copy of a trained network for CPU inference
+    // Immutable after construction; predict() is const and safe to call from several threads
+    template<typename T>
+    class Model {
+    private:
+        std::vector<FrozenLayer<T>> layers;
+        bool flush_denormals = true;
+
+        // Per-thread buffers reused across calls, so steady-state predict() only
+        // allocates its result
+        struct Scratch {
+            std::vector<uint8_t, Memory::AlignedAllocator<uint8_t>> quantized;
+            std::vector<int32_t> accumulators;
+            std::vector<T> values;
+        };
+
+        static std::pair<T, T> bounds(MatrixView<const T> values) {
+            T min = 0, max = 0;
+            for (size_t i = 0; i < values.getRows(); ++i) {
+                const T* row = values.row(i).data();
+                for (size_t j = 0; j < values.getCols(); ++j) {
+                    min = std::min(min, row[j]);
+                    max = std::max(max, row[j]);
+                }
+            }
+            return {min, max};
+        }
+
+        static FrozenLayer<T> freeze(const ::Layer<T>& source, ActivationRange input) {
+            const MatrixView<const T> w = source.getWeights();  // [inputs x outputs]
+            if (w.getRows() > MAX_INPUTS) {
+                throw std::invalid_argument("Layer input too wide for int32 accumulation");
+            }
+            FrozenLayer<T> layer;
+            layer.inputs = w.getRows();
+            layer.outputs = w.getCols();
+            layer.padded_inputs = paddedLength(layer.inputs);
+            layer.weights.assign(layer.outputs * layer.padded_inputs, 0);
+            layer.scales.resize(layer.outputs);
+            layer.zero_point_offsets.resize(layer.outputs);
+            layer.bias.assign(source.getBias().data(), source.getBias().data() + layer.outputs);
+            layer.activation = source.getActivation();
+            layer.input = input;
+
+            for (size_t j = 0; j < layer.outputs; ++j) {
+                T max_abs = 0;
+                for (size_t p = 0; p < layer.inputs; ++p) max_abs = std::max(max_abs, std::abs(w.at(p, j)));
+                const T scale = max_abs > 0 ? max_abs / T(127) : T(1);
+
+                int8_t* row = layer.weights.data() + j * layer.padded_inputs;
+                int32_t sum = 0;
+                for (size_t p = 0; p < layer.inputs; ++p) {
+                    const long q = std::lround(w.at(p, j) / scale);
+                    row[p] = static_cast<int8_t>(std::clamp(q, -127L, 127L));
+                    sum += row[p];
+                }
+                layer.scales[j] = static_cast<T>(input.scale) * scale;
+                layer.zero_point_offsets[j] = input.zero_point * sum;
+            }
+            return layer;
+        }
+
+        // Run rows [lo, hi) through all layers, ROW_BLOCK rows at a time so each pass over a
+        // layer's weights serves several rows
+        void predictRows(MatrixView<const T> input, size_t lo, size_t hi, Matrix<T>& result) const {
+            static thread_local Scratch scratch;
+            size_t max_inputs = 0, max_outputs = 0;
+            for (const FrozenLayer<T>& layer : layers) {
+                max_inputs = std::max(max_inputs, layer.padded_inputs);
+                max_outputs = std::max(max_outputs, layer.outputs);
+            }
+            if (scratch.quantized.size() < ROW_BLOCK * max_inputs) scratch.quantized.resize(ROW_BLOCK * max_inputs);
+            if (scratch.accumulators.size() < ROW_BLOCK * max_outputs) scratch.accumulators.resize(ROW_BLOCK * max_outputs);
+            if (scratch.values.size() < ROW_BLOCK * max_outputs) scratch.values.resize(ROW_BLOCK * max_outputs);
+
+            const detail::Kernels<T> kernels = detail::selectKernels<T>();
+            uint8_t* quantized = scratch.quantized.data();
+            int32_t* accumulators = scratch.accumulators.data();
+            T* values = scratch.values.data();
+
+            // Quantize rows of T (row i at source(i)) into the padded uint8 layout of layer
+            auto quantizeBlock = [&](const FrozenLayer<T>& layer, size_t rows, auto source) {
+                for (size_t i = 0; i < rows; ++i) {
+                    uint8_t* out = quantized + i * layer.padded_inputs;
+                    kernels.quantize(source(i), layer.inputs, 1.0f / layer.input.scale,
+                                     static_cast<float>(layer.input.zero_point) + 0.5f, out);
+                    std::fill(out + layer.inputs, out + layer.padded_inputs, uint8_t(0));
+                }
+            };
+
+            for (size_t start = lo; start < hi; start += ROW_BLOCK) {
+                const size_t rows = std::min(ROW_BLOCK, hi - start);
+                quantizeBlock(layers.front(), rows, [&](size_t i) { return input.row(start + i).data(); });
+
+                for (size_t l = 0; l < layers.size(); ++l) {
+                    const FrozenLayer<T>& layer = layers[l];
+                    const size_t n = layer.outputs;
+                    kernels.dot(quantized, rows, layer.weights.data(), layer.padded_inputs, n, accumulators);
+                    for (size_t i = 0; i < rows; ++i) {
+                        const int32_t* acc = accumulators + i * n;
+                        T* row = values + i * n;
+                        for (size_t j = 0; j < n; ++j) {
+                            row[j] = static_cast<T>(acc[j] - layer.zero_point_offsets[j]) * layer.scales[j];
+                        }
+                        layer.activation->forwardFused(row, layer.bias.data(), n);
+                    }
+
+                    if (l + 1 == layers.size()) {
+                        for (size_t i = 0; i < rows; ++i) {
+                            std::copy(values + i * n, values + (i + 1) * n, result.row(start + i).data());
+                        }
+                    } else {
+                        quantizeBlock(layers[l + 1], rows, [&](size_t i) { return values + i * n; });
+                    }
+                }
+            }
+        }
+
+    public:
+        // Minimum rows per task when predict() splits a batch across threads
+        static constexpr size_t PREDICT_GRAIN = 64;
+
+        // Rows that go through the layers together
+        static constexpr size_t ROW_BLOCK = 16;
+
+        // Quantize a trained network; calibration should be a representative input batch,
+        // since it fixes the activation ranges (values outside them saturate)
+        Model(const NeuralNetwork<T>& network, MatrixView<const T> calibration)
+            : flush_denormals(network.getFlushDenormals()) {
+            const auto& source = network.getLayers();
+            if (source.empty()) {
+                throw std::invalid_argument("Cannot quantize a network without layers");
+            }
+            if (!network.isSequential()) {
+                throw std::invalid_argument("Only sequential networks can be quantized");
+            }
+            if (calibration.getRows() == 0 || calibration.getCols() != source.front()->getWeights().getRows()) {
+                throw std::invalid_argument("Calibration batch does not match the network input size");
+            }
+
+            Matrix<T> current(calibration);
+            for (const auto& layer : source) {
+                const std::pair<T, T> range = bounds(current);
+                layers.push_back(freeze(*layer, ActivationRange::fromBounds(
+                    static_cast<float>(range.first), static_cast<float>(range.second))));
+                current = layer->infer(current);
+            }
+        }
+
+        // Inference on a batch; large batches are split into row blocks across the pool
+        Matrix<T> predict(MatrixView<const T> input) const {
+            if (input.getCols() != layers.front().inputs) {
+                throw std::invalid_argument("Input does not match the model input size");
+            }
+            Simd::DenormalModeGuard denormals(flush_denormals ? Simd::FLUSH_DENORMALS : Simd::denormalMode());
+
+            Matrix<T> result(input.getRows(), layers.back().outputs);
+            Parallel::parallelFor(0, input.getRows(), PREDICT_GRAIN, [&](size_t lo, size_t hi) {
+                predictRows(input, lo, hi, result);
+            });
+            return result;
+        }
+
+        const std::vector<FrozenLayer<T>>& getLayers() const { return layers; }
+        size_t inputSize() const { return layers.front().inputs; }
+        size_t outputSize() const { return layers.back().outputs; }
+    };
+
+    // Classification accuracy of the original network and of its int8 copy on one dataset
+    template<typename T>
+    struct AccuracyReport {
+        T reference;   // NeuralNetwork::predict
+        T quantized;   // Model::predict
+        T delta() const { return quantized - reference; }
+    };
+
+    template<typename T>
+    AccuracyReport<T> compareAccuracy(const NeuralNetwork<T>& network, const Model<T>& model,
+                                      const Matrix<T>& input, const Matrix<T>& expected) {
+        return AccuracyReport<T>{Utils::Metrics<T>::accuracy(network.predict(input), expected),
+                                 Utils::Metrics<T>::accuracy(model.predict(input), expected)};
+    }
+}
@@ -0,0 +1,318 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <type_traits>
+#include "simd.hpp"
+#include "thread_pool.hpp"
+#include "vector_math.hpp"
+
+// Counter-based random numbers: Philox4x32-10 (Salmon et al., "Parallel Random Numbers:
+// As Easy as 1, 2, 3", SC 2011)
+//
+// A draw is a pure function of (seed, stream, position): block n of a stream is Philox's
+// ten rounds applied to the counter {n, stream} under the key seed, giving four 32-bit
+// words. Nothing carries over from one block to the next, so
+//   - any range of a stream can be computed on any thread: bulk fills are split across
+//     the pool and give the same values for every thread count;
+//   - tensors, datasets and threads each get a stream of their own (nextStream, split)
+//     instead of sharing, or re-seeding, one engine.
+// Bulk fills generate GROUP_BLOCKS blocks at a time with the scalar, AVX2 or AVX-512 kernel
+// picked by Simd::activeLevel(). Normal draws use the inverse normal CDF (Acklam's
+// rational approximation, relative error below 1.2e-9), one uniform per value.
+//
+// The global seed is NN_SEED if set, otherwise DEFAULT_SEED, so runs are reproducible;
+// nextStream() hands out consecutive streams under it. Values then depend on the order
+// of nextStream() calls, not on timing or thread count.
+namespace Random {
+    constexpr uint64_t DEFAULT_SEED = 20240601;
+
+    // Philox4x32 round multipliers and key increments
+    constexpr int PHILOX_ROUNDS = 10;
+    constexpr uint32_t PHILOX_M0 = 0xD2511F53u;
+    constexpr uint32_t PHILOX_M1 = 0xCD9E8D57u;
+    constexpr uint32_t PHILOX_W0 = 0x9E3779B9u;
+    constexpr uint32_t PHILOX_W1 = 0xBB67AE85u;
+
+    // Blocks generated together by the bulk kernels (four AVX-512 vectors of counters);
+    // fills start on a group boundary
+    constexpr size_t GROUP_BLOCKS = 64;
+
+    namespace detail {
+        struct Key {
+            uint64_t seed;
+            uint64_t stream;
+        };
+
+        // Values per group of GROUP_BLOCKS blocks: one word per float, two per double
+        // Value w * GROUP_BLOCKS + l of a group comes from word w (words 2w, 2w + 1 for
+        // double) of the group's block l
+        template<typename T>
+        struct Layout {
+            static_assert(std::is_same<T, float>::value || std::is_same<T, double>::value,
+                          "Bulk kernels generate float or double");
+            static constexpr size_t PER_GROUP = GROUP_BLOCKS * (sizeof(T) == 4 ? 4 : 2);
+        };
+
+        // Acklam's inverse normal CDF: a rational function of q = u - 1/2 on
+        // [low, 1 - low], and of sqrt(-2 log u) in the tails
+        struct NormalQuantile {
+            static constexpr double low = 0.02425;
+            static constexpr double a[6] = {-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+                                            1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00};
+            static constexpr double b[5] = {-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+                                            6.680131188771972e+01, -1.328068155288572e+01};
+            static constexpr double c[6] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+                                            -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00};
+            static constexpr double d[4] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+                                            3.754408661907416e+00};
+        };
+
+        // One Philox4x32-10 block: the four words of counter `block` in the key's stream
+        inline void philox(const Key& key, uint64_t block, uint32_t (&out)[4]) {
+            uint32_t c0 = static_cast<uint32_t>(block), c1 = static_cast<uint32_t>(block >> 32);
+            uint32_t c2 = static_cast<uint32_t>(key.stream), c3 = static_cast<uint32_t>(key.stream >> 32);
+            uint32_t k0 = static_cast<uint32_t>(key.seed), k1 = static_cast<uint32_t>(key.seed >> 32);
+            for (int round = 0; round < PHILOX_ROUNDS; ++round) {
+                const uint64_t p0 = static_cast<uint64_t>(PHILOX_M0) * c0;
+                const uint64_t p1 = static_cast<uint64_t>(PHILOX_M1) * c2;
+                c0 = static_cast<uint32_t>(p1 >> 32) ^ c1 ^ k0;
+                c2 = static_cast<uint32_t>(p0 >> 32) ^ c3 ^ k1;
+                c1 = static_cast<uint32_t>(p1);
+                c3 = static_cast<uint32_t>(p0);
+                k0 += PHILOX_W0;
+                k1 += PHILOX_W1;
+            }
+            out[0] = c0;
+            out[1] = c1;
+            out[2] = c2;
+            out[3] = c3;
+        }
+
+        // SplitMix64 finalizer: decorrelates derived stream ids
+        inline uint64_t mix(uint64_t x) {
+            x += 0x9E3779B97F4A7C15ull;
+            x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+            x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+            return x ^ (x >> 31);
+        }
+
+        namespace portable {
+#include "random_kernel.inl"
+        }
+
+#if NN_SIMD_X86
+NN_SIMD_BEGIN_AVX2
+        namespace avx2 {
+#include "random_kernel.inl"
+        }
+NN_SIMD_END
+
+NN_SIMD_BEGIN_AVX512
+        namespace avx512 {
+#include "random_kernel.inl"
+        }
+NN_SIMD_END
+#endif
+
+        // Fill kernels for one instruction set: whole groups starting at a group index
+        template<typename T>
+        struct Kernels {
+            using Fill = void (*)(const Key&, uint64_t, size_t, T, T, T*);
+            Fill uniform;   // (min, scale)
+            Fill normal;    // (mean, stddev)
+        };
+
+        template<typename T>
+        const Kernels<T>& select(Simd::Level level) {
+            using ScalarWords = Simd::ScalarOps<uint32_t>;
+            static const Kernels<T> scalar{&portable::uniform<ScalarWords, T>,
+                                           &portable::normal<ScalarWords, Simd::ScalarOps<T>>};
+#if NN_SIMD_X86
+            using Avx2Words = Simd::Avx2Ops<uint32_t>;
+            using Avx512Words = Simd::Avx512Ops<uint32_t>;
+            static const Kernels<T> avx2{&avx2::uniform<Avx2Words, T>, &avx2::normal<Avx2Words, Simd::Avx2Ops<T>>};
+            static const Kernels<T> avx512{&avx512::uniform<Avx512Words, T>,
+                                           &avx512::normal<Avx512Words, Simd::Avx512Ops<T>>};
+            if (level == Simd::Level::AVX512) return avx512;
+            if (level == Simd::Level::AVX2) return avx2;
+#else
+            (void)level;
+#endif
+            return scalar;
+        }
+    }
+
+    // One stream of random numbers
+    // Single draws (next, uniform, normal) take words from the stream in order; a fill
+    // starts at the next group boundary and leaves the stream after its last group, so a
+    // sequence of draws and fills always replays the same values.
+    class Generator {
+    private:
+        detail::Key key;
+        uint64_t block = 0;        // Next block not yet used
+        uint32_t buffer[4] = {};   // Current block of the single draws
+        unsigned buffered = 0;     // Words of buffer not yet drawn (from the back)
+
+        template<typename T>
+        void fill(T* out, size_t count, T a, T b, bool normal) {
+            if (count == 0) return;
+            using Layout = detail::Layout<T>;
+            constexpr size_t N = Layout::PER_GROUP;
+            const auto& kernels = detail::select<T>(Simd::activeLevel());
+            const auto kernel = normal ? kernels.normal : kernels.uniform;
+            const uint64_t first = (block + GROUP_BLOCKS - 1) / GROUP_BLOCKS;
+            const size_t whole = count / N;
+            const size_t rest = count % N;
+            const size_t grain = std::max<size_t>(1, Parallel::ELEMENTWISE_GRAIN / N);
+            Parallel::parallelFor(0, whole, grain, [&](size_t lo, size_t hi) {
+                kernel(key, first + lo, hi - lo, a, b, out + lo * N);
+            });
+            if (rest > 0) {
+                T last[N];
+                kernel(key, first + whole, 1, a, b, last);
+                std::copy(last, last + rest, out + whole * N);
+            }
+            block = (first + whole + (rest > 0 ? 1 : 0)) * GROUP_BLOCKS;
+            buffered = 0;
+        }
+
+    public:
+        explicit Generator(uint64_t seed, uint64_t stream = 0) : key{seed, stream} {}
+
+        // Next 32 random bits
+        uint32_t next() {
+            if (buffered == 0) {
+                detail::philox(key, block++, buffer);
+                buffered = 4;
+            }
+            return buffer[4 - buffered--];
+        }
+
+        uint64_t next64() {
+            const uint64_t high = next();
+            return (high << 32) | next();
+        }
+
+        // Uniform integer in [0, bound), bound > 0: the high word of next64() * bound, with
+        // rejection of the few low words that would bias it (Lemire's method). Unlike
+        // std::uniform_int_distribution it draws the same values on every standard library
+        uint64_t below(uint64_t bound) {
+            unsigned __int128 product = static_cast<unsigned __int128>(next64()) * bound;
+            if (static_cast<uint64_t>(product) < bound) {
+                const uint64_t threshold = (0 - bound) % bound;  // 2^64 mod bound
+                while (static_cast<uint64_t>(product) < threshold) {
+                    product = static_cast<unsigned __int128>(next64()) * bound;
+                }
+            }
+            return static_cast<uint64_t>(product >> 64);
+        }
+
+        // Uniform in (min, max); 23 random bits for float, 52 for double and wider types
+        template<typename T>
+        T uniform(T min, T max) {
+            static_assert(std::is_floating_point<T>::value, "uniform() draws floating-point values");
+            if constexpr (std::is_same<T, float>::value) {
+                const uint32_t bits = ((next() >> 9) << 1) | 1u;
+                return min + (max - min) * (static_cast<float>(bits) * 5.9604644775390625e-08f);
+            } else {
+                const uint64_t bits = ((next64() >> 12) << 1) | 1u;
+                return min + (max - min) * static_cast<T>(static_cast<double>(bits) * 1.1102230246251565e-16);
+            }
+        }
+
+        // Normal with the given mean and standard deviation, through the inverse CDF
+        template<typename T>
+        T normal(T mean, T stddev) {
+            using C = detail::NormalQuantile;
+            const double u = uniform<double>(0.0, 1.0);
+            double x;
+            if (u >= C::low && u <= 1.0 - C::low) {
+                const double q = u - 0.5, r = q * q;
+                x = (((((C::a[0] * r + C::a[1]) * r + C::a[2]) * r + C::a[3]) * r + C::a[4]) * r + C::a[5]) * q /
+                    (((((C::b[0] * r + C::b[1]) * r + C::b[2]) * r + C::b[3]) * r + C::b[4]) * r + 1.0);
+            } else {
+                const double q = std::sqrt(-2.0 * std::log(u < 0.5 ? u : 1.0 - u));
+                x = (((((C::c[0] * q + C::c[1]) * q + C::c[2]) * q + C::c[3]) * q + C::c[4]) * q + C::c[5]) /
+                    ((((C::d[0] * q + C::d[1]) * q + C::d[2]) * q + C::d[3]) * q + 1.0);
+                if (u > 0.5) x = -x;
+            }
+            return mean + stddev * static_cast<T>(x);
+        }
+
+        // out[i] = uniform in (min, max), split across the thread pool
+        template<typename T>
+        void fillUniform(T* out, size_t count, T min, T max) {
+            static_assert(std::is_floating_point<T>::value, "fillUniform() fills floating-point values");
+            if constexpr (std::is_same<T, float>::value || std::is_same<T, double>::value) {
+                fill(out, count, min, max - min, false);
+            } else {
+                for (size_t i = 0; i < count; ++i) out[i] = uniform<T>(min, max);
+            }
+        }
+
+        // out[i] = normal with the given mean and standard deviation, split across the pool
+        template<typename T>
+        void fillNormal(T* out, size_t count, T mean, T stddev) {
+            static_assert(std::is_floating_point<T>::value, "fillNormal() fills floating-point values");
+            if constexpr (std::is_same<T, float>::value || std::is_same<T, double>::value) {
+                fill(out, count, mean, stddev, true);
+            } else {
+                for (size_t i = 0; i < count; ++i) out[i] = normal<T>(mean, stddev);
+            }
+        }
+
+        // Word `index` of this generator's stream, without moving it; position-addressed
+        // draws for loops that split across threads
+        uint32_t word(uint64_t index) const {
+            uint32_t words[4];
+            detail::philox(key, index / 4, words);
+            return words[index % 4];
+        }
+
+        // Independent stream derived from this one, e.g. one per worker or per tensor
+        Generator split(uint64_t id) const { return Generator(key.seed, detail::mix(key.stream ^ detail::mix(id))); }
+
+        uint64_t getSeed() const { return key.seed; }
+        uint64_t getStream() const { return key.stream; }
+    };
+
+    namespace detail {
+        inline uint64_t initialSeed() {
+            if (const char* env = std::getenv("NN_SEED")) {
+                char* end = nullptr;
+                const unsigned long long value = std::strtoull(env, &end, 10);
+                if (end != env) return value;
+            }
+            return DEFAULT_SEED;
+        }
+
+        struct GlobalState {
+            std::atomic<uint64_t> seed{initialSeed()};
+            std::atomic<uint64_t> next_stream{0};
+        };
+
+        inline GlobalState& global() {
+            static GlobalState state;
+            return state;
+        }
+    }
+
+    inline uint64_t globalSeed() { return detail::global().seed.load(); }
+
+    // Reseed; later nextStream() calls start over from the first stream
+    // Not thread-safe with concurrent nextStream() calls
+    inline void setGlobalSeed(uint64_t seed) {
+        detail::global().seed.store(seed);
+        detail::global().next_stream.store(0);
+    }
+
+    // Generator on the next unused stream of the global seed
+    // Used by Matrix::randomize, layer initialization and the data generators
+    inline Generator nextStream() { return Generator(globalSeed(), detail::global().next_stream.fetch_add(1)); }
+
+    // 64-bit seed from the next stream, for engines and sources that take a plain seed
+    inline uint64_t nextSeed() { return nextStream().next64(); }
+}
@@ -0,0 +1,160 @@
+// Philox4x32-10 bulk generation kernels
+// Included once per SIMD region (AVX2, AVX-512) and once without target options (scalar)
+// by random.hpp. Do not include directly.
+//
+// A group's GROUP_BLOCKS counters run through the rounds in lockstep, one vector per Philox
+// word and Words::lanes counters; the GROUP_BLOCKS / lanes vectors of a round are
+// independent, which hides the latency of the 32-bit multiplies. All levels draw the same
+// words; values derived from them may differ in the last bit between levels where
+// multiply-adds are fused.
+//
+// Words: uint32_t lane operations from simd.hpp; Ops: lanes of the output type.
+// GROUP_BLOCKS, Key, Layout, the PHILOX_*
+// constants and the NormalQuantile coefficients are defined in random.hpp
+
+// Words of GROUP_BLOCKS consecutive blocks starting at `block`: words[w][l] is word w of
+// block + l
+template<typename Words>
+inline void philoxGroup(const Key& key, uint64_t block, uint32_t (&words)[4][GROUP_BLOCKS]) {
+    using V = typename Words::V;
+    constexpr size_t L = Words::lanes;
+    constexpr size_t N = GROUP_BLOCKS / L;
+    static_assert(GROUP_BLOCKS % L == 0, "A group must fill whole vectors");
+    for (size_t l = 0; l < GROUP_BLOCKS; ++l) {
+        const uint64_t counter = block + l;
+        words[0][l] = static_cast<uint32_t>(counter);
+        words[1][l] = static_cast<uint32_t>(counter >> 32);
+    }
+    V c0[N], c1[N], c2[N], c3[N];
+    for (size_t n = 0; n < N; ++n) {
+        c0[n] = Words::load(words[0] + n * L);
+        c1[n] = Words::load(words[1] + n * L);
+        c2[n] = Words::broadcast(static_cast<uint32_t>(key.stream));
+        c3[n] = Words::broadcast(static_cast<uint32_t>(key.stream >> 32));
+    }
+    const V m0 = Words::broadcast(PHILOX_M0);
+    const V m1 = Words::broadcast(PHILOX_M1);
+    uint32_t k0 = static_cast<uint32_t>(key.seed);
+    uint32_t k1 = static_cast<uint32_t>(key.seed >> 32);
+    for (int round = 0; round < PHILOX_ROUNDS; ++round) {
+        const V key0 = Words::broadcast(k0);
+        const V key1 = Words::broadcast(k1);
+#pragma GCC unroll 8
+        for (size_t n = 0; n < N; ++n) {
+            const V n0 = Words::bitXor(Words::bitXor(Words::mulHigh(m1, c2[n]), c1[n]), key0);
+            const V n2 = Words::bitXor(Words::bitXor(Words::mulHigh(m0, c0[n]), c3[n]), key1);
+            c1[n] = Words::mul(m1, c2[n]);
+            c3[n] = Words::mul(m0, c0[n]);
+            c0[n] = n0;
+            c2[n] = n2;
+        }
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    for (size_t n = 0; n < N; ++n) {
+        Words::store(words[0] + n * L, c0[n]);
+        Words::store(words[1] + n * L, c1[n]);
+        Words::store(words[2] + n * L, c2[n]);
+        Words::store(words[3] + n * L, c3[n]);
+    }
+}
+
+// One group of min + scale * u with u uniform in (0, 1), never exactly 0 or 1, in the order
+// of Layout<T> (see random.hpp)
+template<typename Words, typename T>
+inline void uniformGroup(const Key& key, uint64_t block, T min, T scale, T* out) {
+    uint32_t words[4][GROUP_BLOCKS];
+    philoxGroup<Words>(key, block, words);
+    if constexpr (sizeof(T) == 4) {
+        // Odd multiples of 2^-24: 23 random bits per float
+        for (size_t w = 0; w < 4; ++w) {
+            for (size_t l = 0; l < GROUP_BLOCKS; ++l) {
+                const uint32_t bits = ((words[w][l] >> 9) << 1) | 1u;
+                const T u = static_cast<T>(static_cast<int32_t>(bits)) * T(5.9604644775390625e-08);
+                out[w * GROUP_BLOCKS + l] = min + scale * u;
+            }
+        }
+    } else {
+        // Odd multiples of 2^-53: 52 random bits per double, from a pair of words
+        for (size_t h = 0; h < 2; ++h) {
+            for (size_t l = 0; l < GROUP_BLOCKS; ++l) {
+                const uint64_t pair = (static_cast<uint64_t>(words[2 * h][l]) << 32) | words[2 * h + 1][l];
+                const uint64_t bits = ((pair >> 12) << 1) | 1u;
+                const T u = static_cast<T>(static_cast<int64_t>(bits)) * T(1.1102230246251565e-16);
+                out[h * GROUP_BLOCKS + l] = min + scale * u;
+            }
+        }
+    }
+}
+
+// out = min + scale * U(0, 1) for `groups` whole groups starting at group `first`
+template<typename Words, typename T>
+void uniform(const Key& key, uint64_t first, size_t groups, T min, T scale, T* out) {
+    constexpr size_t N = Layout<T>::PER_GROUP;
+    for (size_t g = 0; g < groups; ++g) uniformGroup<Words>(key, (first + g) * GROUP_BLOCKS, min, scale, out + g * N);
+}
+
+// out = mean + stddev * Phi^-1(U(0, 1)) for `groups` whole groups starting at group `first`
+// The central region is one rational function of u - 1/2 for every lane. When a group has
+// tail draws (u < low or u > 1 - low, about 5% of draws), the tail formula, a rational
+// function of sqrt(-2 log min(u, 1 - u)), is evaluated for every lane with Ops and kept
+// where u is in a tail: branch-free vector passes cost less than handling the few tail
+// lanes one at a time. The logs are taken by VectorMath::log.
+template<typename Words, typename Ops>
+void normal(const Key& key, uint64_t first, size_t groups, typename Ops::T mean, typename Ops::T stddev,
+            typename Ops::T* out) {
+    using T = typename Ops::T;
+    using V = typename Ops::V;
+    using C = NormalQuantile;
+    constexpr size_t N = Layout<T>::PER_GROUP;
+    static_assert(N % Ops::lanes == 0, "A group must fill whole vectors");
+    for (size_t g = 0; g < groups; ++g) {
+        T* values = out + g * N;
+        T u[N];
+        uniformGroup<Words>(key, (first + g) * GROUP_BLOCKS, T(0), T(1), u);
+        int tails = 0;
+        for (size_t i = 0; i < N; ++i) {
+            const T q = u[i] - T(0.5);
+            const T r = q * q;
+            const T num = (((((T(C::a[0]) * r + T(C::a[1])) * r + T(C::a[2])) * r + T(C::a[3])) * r + T(C::a[4])) * r +
+                           T(C::a[5])) * q;
+            const T den = ((((T(C::b[0]) * r + T(C::b[1])) * r + T(C::b[2])) * r + T(C::b[3])) * r + T(C::b[4])) * r + T(1);
+            values[i] = num / den;
+            tails |= (u[i] < T(C::low)) | (u[i] > T(1 - C::low));
+        }
+        if (tails && Ops::lanes == 1) {
+            // Scalar lanes gain nothing from the branch-free form: recompute the tail draws only
+            for (size_t i = 0; i < N; ++i) {
+                if (u[i] >= T(C::low) && u[i] <= T(1 - C::low)) continue;
+                const T q = std::sqrt(T(-2) * std::log(std::min(u[i], T(1) - u[i])));
+                const T x = (((((T(C::c[0]) * q + T(C::c[1])) * q + T(C::c[2])) * q + T(C::c[3])) * q + T(C::c[4])) * q +
+                             T(C::c[5])) /
+                            ((((T(C::d[0]) * q + T(C::d[1])) * q + T(C::d[2])) * q + T(C::d[3])) * q + T(1));
+                values[i] = u[i] < T(0.5) ? x : -x;
+            }
+        } else if (tails) {
+            T p[N];
+            for (size_t i = 0; i < N; ++i) p[i] = std::min(u[i], T(1) - u[i]);
+            VectorMath::log(p, p, N);
+            const V low = Ops::broadcast(T(C::low));
+            const V high = Ops::broadcast(T(1 - C::low));
+            for (size_t i = 0; i < N; i += Ops::lanes) {
+                const V q = Ops::sqrt(Ops::mul(Ops::broadcast(T(-2)), Ops::load(p + i)));
+                V num = Ops::broadcast(T(C::c[0]));
+#pragma GCC unroll 8
+                for (size_t k = 1; k < 6; ++k) num = Ops::fma(num, q, Ops::broadcast(T(C::c[k])));
+                V den = Ops::broadcast(T(C::d[0]));
+#pragma GCC unroll 8
+                for (size_t k = 1; k < 4; ++k) den = Ops::fma(den, q, Ops::broadcast(T(C::d[k])));
+                den = Ops::fma(den, q, Ops::broadcast(T(1)));
+                const V x = Ops::div(num, den);
+                const V ui = Ops::load(u + i);
+                V v = Ops::load(values + i);
+                v = Ops::selectGreater(ui, high, Ops::sub(Ops::zero(), x), v);
+                v = Ops::selectGreater(low, ui, x, v);
+                Ops::store(values + i, v);
+            }
+        }
+        for (size_t i = 0; i < N; ++i) values[i] = mean + stddev * values[i];
+    }
+}
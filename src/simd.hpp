@@ -0,0 +1,409 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+// Compile-time switch: runtime-dispatched x86 kernels need GCC/Clang target attributes
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define NN_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define NN_SIMD_X86 0
+#endif
+
+// Region markers: code between BEGIN and END is compiled for the named
+// instruction set, independently of the global compiler flags.
+// Only call into such a region after Simd::activeLevel() confirms CPU support.
+#if NN_SIMD_X86 && defined(__clang__)
+#define NN_SIMD_BEGIN_AVX2 \
+    _Pragma("clang attribute push(__attribute__((target(\"avx2,fma\"))), apply_to = function)")
+#define NN_SIMD_BEGIN_AVX512 \
+    _Pragma("clang attribute push(__attribute__((target(\"avx512f,avx2,fma\"))), apply_to = function)")
+#define NN_SIMD_BEGIN_AVX512VNNI \
+    _Pragma("clang attribute push(__attribute__((target(\"avx512f,avx512bw,avx512vnni,avx2,fma\"))), apply_to = function)")
+#define NN_SIMD_BEGIN_AVX2F16C \
+    _Pragma("clang attribute push(__attribute__((target(\"avx2,fma,f16c\"))), apply_to = function)")
+#define NN_SIMD_END _Pragma("clang attribute pop")
+#elif NN_SIMD_X86
+#define NN_SIMD_BEGIN_AVX2 _Pragma("GCC push_options") _Pragma("GCC target(\"avx2,fma\")")
+#define NN_SIMD_BEGIN_AVX512 _Pragma("GCC push_options") _Pragma("GCC target(\"avx512f,avx2,fma\")")
+#define NN_SIMD_BEGIN_AVX512VNNI \
+    _Pragma("GCC push_options") _Pragma("GCC target(\"avx512f,avx512bw,avx512vnni,avx2,fma\")")
+#define NN_SIMD_BEGIN_AVX2F16C _Pragma("GCC push_options") _Pragma("GCC target(\"avx2,fma,f16c\")")
+#define NN_SIMD_END _Pragma("GCC pop_options")
+#endif
+
+namespace Simd {
+    // Instruction set tiers, ordered from least to most capable
+    enum class Level { Scalar = 0, AVX2 = 1, AVX512 = 2 };
+
+    // Human-readable level name for logs and benchmark output
+    inline const char* name(Level level) {
+        switch (level) {
+            case Level::AVX512: return "avx512";
+            case Level::AVX2: return "avx2";
+            default: return "scalar";
+        }
+    }
+
+    // Query the CPU once for the best supported tier
+    inline Level detect() {
+#if NN_SIMD_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2") &&
+            __builtin_cpu_supports("fma")) {
+            return Level::AVX512;
+        }
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            return Level::AVX2;
+        }
+#endif
+        return Level::Scalar;
+    }
+
+    namespace detail {
+        // Initial level: detected tier, optionally capped by the NN_SIMD
+        // environment variable ("scalar", "avx2" or "avx512")
+        inline Level initialLevel() {
+            Level level = detect();
+            if (const char* env = std::getenv("NN_SIMD")) {
+                Level cap = Level::AVX512;
+                if (std::strcmp(env, "scalar") == 0) cap = Level::Scalar;
+                else if (std::strcmp(env, "avx2") == 0) cap = Level::AVX2;
+                if (cap < level) level = cap;
+            }
+            return level;
+        }
+
+        inline Level& levelStorage() {
+            static Level level = initialLevel();
+            return level;
+        }
+    }
+
+    // Tier used by all dispatched kernels
+    inline Level activeLevel() { return detail::levelStorage(); }
+
+    // Restrict kernels to a lower tier (requests above the CPU's support are clamped)
+    // Not thread-safe: configure before running kernels concurrently
+    inline void setLevel(Level requested) {
+        Level supported = detect();
+        detail::levelStorage() = requested < supported ? requested : supported;
+    }
+
+    // AVX-512 VNNI (int8 dot products, used by quantized inference)
+    // Reported only when the active level is AVX512, so NN_SIMD caps it as well
+    inline bool hasVnni() {
+#if NN_SIMD_X86
+        static const bool supported = __builtin_cpu_supports("avx512vnni") && __builtin_cpu_supports("avx512bw");
+        return supported && activeLevel() == Level::AVX512;
+#else
+        return false;
+#endif
+    }
+
+    // F16C (half <-> float conversions, used by the fp16 storage format; AVX-512F has its own)
+    // Reported only when the active level is AVX2 or above, so NN_SIMD caps it as well
+    inline bool hasF16c() {
+#if NN_SIMD_X86
+        static const bool supported = __builtin_cpu_supports("f16c");
+        return supported && activeLevel() != Level::Scalar;
+#else
+        return false;
+#endif
+    }
+
+    // Denormal handling: the x86 MXCSR flush-to-zero and denormals-are-zero bits
+    // Arithmetic on denormals takes a microcode assist that is 10-100x slower than normal;
+    // float training produces them as sigmoid outputs saturate and gradients vanish
+    constexpr unsigned FLUSH_DENORMALS = 0x8040;
+
+    // Denormal mode of the calling thread: FLUSH_DENORMALS or 0
+    inline unsigned denormalMode() {
+#if NN_SIMD_X86
+        return _mm_getcsr() & FLUSH_DENORMALS;
+#else
+        return 0;
+#endif
+    }
+
+    // Set the calling thread's denormal mode for the lifetime of the guard
+    class DenormalModeGuard {
+    private:
+        unsigned saved = 0;
+
+    public:
+        explicit DenormalModeGuard(unsigned mode) {
+#if NN_SIMD_X86
+            saved = _mm_getcsr();
+            _mm_setcsr((saved & ~FLUSH_DENORMALS) | (mode & FLUSH_DENORMALS));
+#else
+            (void)mode;
+#endif
+        }
+
+        ~DenormalModeGuard() {
+#if NN_SIMD_X86
+            _mm_setcsr(saved);
+#endif
+        }
+
+        DenormalModeGuard(const DenormalModeGuard&) = delete;
+        DenormalModeGuard& operator=(const DenormalModeGuard&) = delete;
+    };
+}
+
+// Lane operations shared by all vector kernels (GEMM, transcendental math, ...)
+// Kernels are written once against this interface and instantiated per instruction set:
+//   T, V, lanes, zero, load, store, broadcast, add, sub, mul, div, fma (a * b + c), sqrt,
+//   min/max (return the second operand when either is NaN), round (to nearest),
+//   floor, ldexp (x * 2^n for integer-valued n), getexp/getmant (x = getmant(x) * 2^getexp(x)
+//   with getmant in [1, 2), for positive normal x), selectGreater/selectEqual (lanewise a ? x : y),
+//   gather (lane k = base[index[k]], for lanes int32 indices below 2^31)
+// Integer lanes (T = uint32_t, random number generation): zero, load, store, broadcast, add,
+//   mul (low 32 bits of the product), mulHigh (high 32 bits), bitXor
+namespace Simd {
+    // Scalar lanes: portable fallback used on any CPU
+    template<typename Scalar>
+    struct ScalarOps {
+        using T = Scalar;
+        using V = Scalar;
+        static constexpr size_t lanes = 1;
+        static V zero() { return V(0); }
+        static V load(const T* p) { return *p; }
+        static void store(T* p, V v) { *p = v; }
+        static V broadcast(T x) { return x; }
+        static V add(V a, V b) { return a + b; }
+        static V sub(V a, V b) { return a - b; }
+        static V mul(V a, V b) { return a * b; }
+        static V div(V a, V b) { return a / b; }
+        static V fma(V a, V b, V c) { return a * b + c; }
+        static V sqrt(V a) { return std::sqrt(a); }
+        static V min(V a, V b) { return a < b ? a : b; }
+        static V max(V a, V b) { return a > b ? a : b; }
+        static V round(V a) { return std::nearbyint(a); }
+        static V floor(V a) { return std::floor(a); }
+        static V ldexp(V a, V n) { return n == n ? std::ldexp(a, static_cast<int>(n)) : a + n; }
+        static V getexp(V a) { return static_cast<V>(std::ilogb(a)); }
+        static V getmant(V a) { return std::scalbn(a, -std::ilogb(a)); }
+        static V selectGreater(V a, V b, V x, V y) { return a > b ? x : y; }
+        static V selectEqual(V a, V b, V x, V y) { return a == b ? x : y; }
+        static V gather(const T* base, const uint32_t* index) { return base[*index]; }
+        static V mulHigh(V a, V b) { return static_cast<V>((static_cast<uint64_t>(a) * b) >> 32); }
+        static V bitXor(V a, V b) { return a ^ b; }
+    };
+
+#if NN_SIMD_X86
+    template<typename T> struct Avx2Ops;
+    template<typename T> struct Avx512Ops;
+
+NN_SIMD_BEGIN_AVX2
+    template<>
+    struct Avx2Ops<double> {
+        using T = double;
+        using V = __m256d;
+        static constexpr size_t lanes = 4;
+        static V zero() { return _mm256_setzero_pd(); }
+        static V load(const T* p) { return _mm256_loadu_pd(p); }
+        static void store(T* p, V v) { _mm256_storeu_pd(p, v); }
+        static V broadcast(T x) { return _mm256_set1_pd(x); }
+        static V add(V a, V b) { return _mm256_add_pd(a, b); }
+        static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+        static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+        static V div(V a, V b) { return _mm256_div_pd(a, b); }
+        static V fma(V a, V b, V c) { return _mm256_fmadd_pd(a, b, c); }
+        static V sqrt(V a) { return _mm256_sqrt_pd(a); }
+        static V min(V a, V b) { return _mm256_min_pd(a, b); }
+        static V max(V a, V b) { return _mm256_max_pd(a, b); }
+        static V round(V a) { return _mm256_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+        static V floor(V a) { return _mm256_floor_pd(a); }
+        // Split 2^n into two in-range halves so results near overflow and in the
+        // subnormal range are still formed correctly
+        static V ldexp(V a, V n) {
+            V half = floor(mul(n, broadcast(0.5)));
+            return mul(mul(a, pow2(half)), pow2(sub(n, half)));
+        }
+        // Exponent field read back as a double: 2^52 + field, minus 2^52 and the bias
+        static V getexp(V a) {
+            __m256i field = _mm256_srli_epi64(_mm256_castpd_si256(a), 52);
+            V biased = _mm256_castsi256_pd(_mm256_or_si256(field, _mm256_set1_epi64x(0x4330000000000000)));
+            return sub(biased, broadcast(4503599627370496.0 + 1023.0));
+        }
+        static V getmant(V a) {
+            __m256i bits = _mm256_and_si256(_mm256_castpd_si256(a), _mm256_set1_epi64x(0x000FFFFFFFFFFFFF));
+            return _mm256_castsi256_pd(_mm256_or_si256(bits, _mm256_set1_epi64x(0x3FF0000000000000)));
+        }
+        static V selectGreater(V a, V b, V x, V y) { return _mm256_blendv_pd(y, x, _mm256_cmp_pd(a, b, _CMP_GT_OQ)); }
+        static V selectEqual(V a, V b, V x, V y) { return _mm256_blendv_pd(y, x, _mm256_cmp_pd(a, b, _CMP_EQ_OQ)); }
+        // Full-mask form: the unmasked gather trips GCC 12's -Wmaybe-uninitialized
+        static V gather(const T* base, const uint32_t* index) {
+            const __m128i lanes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(index));
+            return _mm256_mask_i32gather_pd(zero(), base, lanes, _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), 8);
+        }
+
+    private:
+        // 2^k for integer-valued k in [-1022, 1023], built directly in the exponent field
+        static V pow2(V k) {
+            // Adding 1.5 * 2^52 leaves k as a two's complement integer in the low mantissa bits
+            __m256i bits = _mm256_castpd_si256(_mm256_add_pd(k, _mm256_set1_pd(6755399441055744.0)));
+            bits = _mm256_slli_epi64(_mm256_add_epi64(bits, _mm256_set1_epi64x(1023)), 52);
+            return _mm256_castsi256_pd(bits);
+        }
+    };
+
+    template<>
+    struct Avx2Ops<float> {
+        using T = float;
+        using V = __m256;
+        static constexpr size_t lanes = 8;
+        static V zero() { return _mm256_setzero_ps(); }
+        static V load(const T* p) { return _mm256_loadu_ps(p); }
+        static void store(T* p, V v) { _mm256_storeu_ps(p, v); }
+        static V broadcast(T x) { return _mm256_set1_ps(x); }
+        static V add(V a, V b) { return _mm256_add_ps(a, b); }
+        static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+        static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+        static V div(V a, V b) { return _mm256_div_ps(a, b); }
+        static V fma(V a, V b, V c) { return _mm256_fmadd_ps(a, b, c); }
+        static V sqrt(V a) { return _mm256_sqrt_ps(a); }
+        static V min(V a, V b) { return _mm256_min_ps(a, b); }
+        static V max(V a, V b) { return _mm256_max_ps(a, b); }
+        static V round(V a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+        static V floor(V a) { return _mm256_floor_ps(a); }
+        static V ldexp(V a, V n) {
+            V half = floor(mul(n, broadcast(0.5f)));
+            return mul(mul(a, pow2(half)), pow2(sub(n, half)));
+        }
+        static V getexp(V a) {
+            __m256i field = _mm256_srli_epi32(_mm256_castps_si256(a), 23);
+            return _mm256_cvtepi32_ps(_mm256_sub_epi32(field, _mm256_set1_epi32(127)));
+        }
+        static V getmant(V a) {
+            __m256i bits = _mm256_and_si256(_mm256_castps_si256(a), _mm256_set1_epi32(0x007FFFFF));
+            return _mm256_castsi256_ps(_mm256_or_si256(bits, _mm256_set1_epi32(0x3F800000)));
+        }
+        static V selectGreater(V a, V b, V x, V y) { return _mm256_blendv_ps(y, x, _mm256_cmp_ps(a, b, _CMP_GT_OQ)); }
+        static V selectEqual(V a, V b, V x, V y) { return _mm256_blendv_ps(y, x, _mm256_cmp_ps(a, b, _CMP_EQ_OQ)); }
+        // Full-mask form, as for double
+        static V gather(const T* base, const uint32_t* index) {
+            const __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(index));
+            return _mm256_mask_i32gather_ps(zero(), base, lanes, _mm256_castsi256_ps(_mm256_set1_epi32(-1)), 4);
+        }
+
+    private:
+        // 2^k for integer-valued k in [-126, 127]
+        static V pow2(V k) {
+            __m256i bits = _mm256_add_epi32(_mm256_cvtps_epi32(k), _mm256_set1_epi32(127));
+            return _mm256_castsi256_ps(_mm256_slli_epi32(bits, 23));
+        }
+    };
+
+    template<>
+    struct Avx2Ops<uint32_t> {
+        using T = uint32_t;
+        using V = __m256i;
+        static constexpr size_t lanes = 8;
+        static V zero() { return _mm256_setzero_si256(); }
+        static V load(const T* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+        static void store(T* p, V v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+        static V broadcast(T x) { return _mm256_set1_epi32(static_cast<int>(x)); }
+        static V add(V a, V b) { return _mm256_add_epi32(a, b); }
+        static V mul(V a, V b) { return _mm256_mullo_epi32(a, b); }
+        // 32 x 32 -> 64-bit products of the even lanes, then of the odd lanes shifted down
+        static V mulHigh(V a, V b) {
+            const __m256i even = _mm256_srli_epi64(_mm256_mul_epu32(a, b), 32);
+            const __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+            return _mm256_blend_epi32(even, odd, 0xAA);
+        }
+        static V bitXor(V a, V b) { return _mm256_xor_si256(a, b); }
+    };
+NN_SIMD_END
+
+NN_SIMD_BEGIN_AVX512
+    // Full-mask forms of sqrt/min/max/roundscale/scalef/getexp/getmant/mul_epu32/srli: the unmasked GCC intrinsics pass an
+    // undefined source vector and trip -Wmaybe-uninitialized once inlined
+    template<>
+    struct Avx512Ops<double> {
+        using T = double;
+        using V = __m512d;
+        static constexpr size_t lanes = 8;
+        static V zero() { return _mm512_setzero_pd(); }
+        static V load(const T* p) { return _mm512_loadu_pd(p); }
+        static void store(T* p, V v) { _mm512_storeu_pd(p, v); }
+        static V broadcast(T x) { return _mm512_set1_pd(x); }
+        static V add(V a, V b) { return _mm512_add_pd(a, b); }
+        static V sub(V a, V b) { return _mm512_sub_pd(a, b); }
+        static V mul(V a, V b) { return _mm512_mul_pd(a, b); }
+        static V div(V a, V b) { return _mm512_div_pd(a, b); }
+        static V fma(V a, V b, V c) { return _mm512_fmadd_pd(a, b, c); }
+        static V sqrt(V a) { return _mm512_mask_sqrt_pd(a, 0xFF, a); }
+        static V min(V a, V b) { return _mm512_mask_min_pd(a, 0xFF, a, b); }
+        static V max(V a, V b) { return _mm512_mask_max_pd(a, 0xFF, a, b); }
+        static V round(V a) { return _mm512_mask_roundscale_pd(a, 0xFF, a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+        static V floor(V a) { return _mm512_mask_roundscale_pd(a, 0xFF, a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+        static V ldexp(V a, V n) { return _mm512_mask_scalef_pd(a, 0xFF, a, n); }
+        static V getexp(V a) { return _mm512_mask_getexp_pd(a, 0xFF, a); }
+        static V getmant(V a) { return _mm512_mask_getmant_pd(a, 0xFF, a, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_zero); }
+        static V selectGreater(V a, V b, V x, V y) { return _mm512_mask_blend_pd(_mm512_cmp_pd_mask(a, b, _CMP_GT_OQ), y, x); }
+        static V selectEqual(V a, V b, V x, V y) { return _mm512_mask_blend_pd(_mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ), y, x); }
+        static V gather(const T* base, const uint32_t* index) {
+            const __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(index));
+            return _mm512_mask_i32gather_pd(zero(), 0xFF, lanes, base, 8);
+        }
+    };
+
+    template<>
+    struct Avx512Ops<float> {
+        using T = float;
+        using V = __m512;
+        static constexpr size_t lanes = 16;
+        static V zero() { return _mm512_setzero_ps(); }
+        static V load(const T* p) { return _mm512_loadu_ps(p); }
+        static void store(T* p, V v) { _mm512_storeu_ps(p, v); }
+        static V broadcast(T x) { return _mm512_set1_ps(x); }
+        static V add(V a, V b) { return _mm512_add_ps(a, b); }
+        static V sub(V a, V b) { return _mm512_sub_ps(a, b); }
+        static V mul(V a, V b) { return _mm512_mul_ps(a, b); }
+        static V div(V a, V b) { return _mm512_div_ps(a, b); }
+        static V fma(V a, V b, V c) { return _mm512_fmadd_ps(a, b, c); }
+        static V sqrt(V a) { return _mm512_mask_sqrt_ps(a, 0xFFFF, a); }
+        static V min(V a, V b) { return _mm512_mask_min_ps(a, 0xFFFF, a, b); }
+        static V max(V a, V b) { return _mm512_mask_max_ps(a, 0xFFFF, a, b); }
+        static V round(V a) { return _mm512_mask_roundscale_ps(a, 0xFFFF, a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+        static V floor(V a) { return _mm512_mask_roundscale_ps(a, 0xFFFF, a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+        static V ldexp(V a, V n) { return _mm512_mask_scalef_ps(a, 0xFFFF, a, n); }
+        static V getexp(V a) { return _mm512_mask_getexp_ps(a, 0xFFFF, a); }
+        static V getmant(V a) { return _mm512_mask_getmant_ps(a, 0xFFFF, a, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_zero); }
+        static V selectGreater(V a, V b, V x, V y) { return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(a, b, _CMP_GT_OQ), y, x); }
+        static V selectEqual(V a, V b, V x, V y) { return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ), y, x); }
+        static V gather(const T* base, const uint32_t* index) {
+            return _mm512_mask_i32gather_ps(zero(), 0xFFFF, _mm512_loadu_si512(index), base, 4);
+        }
+    };
+
+    template<>
+    struct Avx512Ops<uint32_t> {
+        using T = uint32_t;
+        using V = __m512i;
+        static constexpr size_t lanes = 16;
+        static V zero() { return _mm512_setzero_si512(); }
+        static V load(const T* p) { return _mm512_loadu_si512(p); }
+        static void store(T* p, V v) { _mm512_storeu_si512(p, v); }
+        static V broadcast(T x) { return _mm512_set1_epi32(static_cast<int>(x)); }
+        static V add(V a, V b) { return _mm512_add_epi32(a, b); }
+        static V mul(V a, V b) { return _mm512_mullo_epi32(a, b); }
+        static V mulHigh(V a, V b) {
+            const __m512i even = shiftHigh(_mm512_mask_mul_epu32(a, 0xFF, a, b));
+            const __m512i odd = _mm512_mask_mul_epu32(a, 0xFF, shiftHigh(a), shiftHigh(b));
+            return _mm512_mask_blend_epi32(0xAAAA, even, odd);
+        }
+        static V bitXor(V a, V b) { return _mm512_xor_si512(a, b); }
+
+    private:
+        // High 32 bits of each 64-bit lane moved down
+        static V shiftHigh(V a) { return _mm512_mask_srli_epi64(a, 0xFF, a, 32); }
+    };
+NN_SIMD_END
+#endif
+}
@@ -0,0 +1,292 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+#include "gemm.hpp"
+#include "matrix.hpp"
+#include "memory.hpp"
+#include "profiler.hpp"
+#include "simd.hpp"
+#include "thread_pool.hpp"
+
+// Sparse weights: magnitude pruning and sparse x dense products for pruned layers
+//
+// A weight matrix W [inputs x outputs] is stored as block-sparse rows over the output
+// channels (BlockCsr). Block row b covers channels [b * B, b * B + B) and keeps, for every
+// input p where any of those B weights is nonzero, the index p and the B weights. B = 1 is
+// plain CSR of W^T; 4x1 and 8x1 blocks group neighbouring channels, so the kernels load an
+// input once for several multiply-adds and store a quarter or an eighth of the indices.
+//
+// prune() zeroes the blocks of smallest magnitude (squared L2 norm of their B weights) down
+// to a target sparsity; BlockCsr::fromDense() then stores the blocks that are left.
+// BlockCsr::multiply computes input * W with the same Gemm::Epilogue hook as the dense GEMM,
+// so layers fuse bias and activation into it unchanged. The kernels vectorize over batch
+// rows, so one block of B weights feeds B multiply-adds per vector of rows; single rows
+// vectorize along the block instead, or gather the inputs of CSR channels.
+//
+// bench/sparse_bench.cpp sweeps the sparsity at which each layout beats the dense GEMM.
+namespace Sparse {
+    // Block shape of the stored weights: B output channels x 1 input
+    enum class Layout { CSR, Block4, Block8 };
+
+    inline size_t blockSize(Layout layout) {
+        switch (layout) {
+            case Layout::Block4: return 4;
+            case Layout::Block8: return 8;
+            default: return 1;
+        }
+    }
+
+    inline const char* name(Layout layout) {
+        switch (layout) {
+            case Layout::Block4: return "block4x1";
+            case Layout::Block8: return "block8x1";
+            default: return "csr";
+        }
+    }
+
+    // Remainders up to this many rows run one row at a time instead of as a padded tile
+    constexpr size_t ROW_KERNEL_ROWS = 4;
+
+    namespace detail {
+        // One product out = input * W, handed to the kernels as raw pointers
+        template<typename T>
+        struct Operands {
+            const T* input;
+            size_t input_row_stride;
+            size_t input_col_stride;
+            size_t inputs;
+            const size_t* offsets;        // Block row b's blocks are [offsets[b], offsets[b + 1])
+            const uint32_t* indices;      // Input index of each block
+            const T* values;              // B weights per block
+            size_t block_rows;
+            T* out;
+            size_t out_stride;
+            size_t outputs;
+            const Gemm::Epilogue<T>* epilogue;
+        };
+
+        namespace portable {
+#include "sparse_kernel.inl"
+        }
+
+#if NN_SIMD_X86
+NN_SIMD_BEGIN_AVX2
+        namespace avx2 {
+#include "sparse_kernel.inl"
+        }
+NN_SIMD_END
+
+NN_SIMD_BEGIN_AVX512
+        namespace avx512 {
+#include "sparse_kernel.inl"
+        }
+NN_SIMD_END
+#endif
+
+        // Product kernels for one instruction set, one per layout; lanes is the tile height
+        template<typename T>
+        struct Kernels {
+            using RowKernel = void (*)(const Operands<T>&, size_t, size_t, T*);
+            RowKernel csr;
+            RowKernel block4;
+            RowKernel block8;
+            size_t lanes;
+
+            RowKernel forLayout(Layout layout) const {
+                switch (layout) {
+                    case Layout::Block4: return block4;
+                    case Layout::Block8: return block8;
+                    default: return csr;
+                }
+            }
+        };
+
+        template<typename T>
+        const Kernels<T>& select(Simd::Level level) {
+            using Scalar = Simd::ScalarOps<T>;
+            static const Kernels<T> scalar{&portable::multiplyRows<Scalar, Scalar, 1>,
+                                           &portable::multiplyRows<Scalar, Scalar, 4>,
+                                           &portable::multiplyRows<Scalar, Scalar, 8>, Scalar::lanes};
+#if NN_SIMD_X86
+            // Single rows of 4x1 / 8x1 blocks use 256-bit vectors at both levels
+            using Avx2 = Simd::Avx2Ops<T>;
+            using Avx512 = Simd::Avx512Ops<T>;
+            static const Kernels<T> avx2{&avx2::multiplyRows<Avx2, Avx2, 1>, &avx2::multiplyRows<Avx2, Avx2, 4>,
+                                         &avx2::multiplyRows<Avx2, Avx2, 8>, Avx2::lanes};
+            static const Kernels<T> avx512{&avx512::multiplyRows<Avx512, Avx2, 1>,
+                                           &avx512::multiplyRows<Avx512, Avx2, 4>,
+                                           &avx512::multiplyRows<Avx512, Avx2, 8>, Avx512::lanes};
+            if (level == Simd::Level::AVX512) return avx512;
+            if (level == Simd::Level::AVX2) return avx2;
+#else
+            (void)level;
+#endif
+            return scalar;
+        }
+
+        // Squared L2 norm of each B x 1 block of weights, block row major (b * inputs + p)
+        // Channels past the last column of a partial block row count as zero
+        template<typename T>
+        std::vector<T> blockScores(MatrixView<const T> weights, size_t block) {
+            const size_t inputs = weights.getRows();
+            const size_t outputs = weights.getCols();
+            const size_t block_rows = (outputs + block - 1) / block;
+            std::vector<T> scores(block_rows * inputs, T(0));
+            for (size_t p = 0; p < inputs; ++p) {
+                for (size_t j = 0; j < outputs; ++j) {
+                    const T w = weights.at(p, j);
+                    scores[(j / block) * inputs + p] += w * w;
+                }
+            }
+            return scores;
+        }
+    }
+
+    // Magnitude pruning: zero the fraction `sparsity` (in [0, 1]) of the B x 1 blocks of
+    // weights [inputs x outputs] with the smallest squared L2 norm, B from the layout
+    // Returns the number of blocks zeroed. Blocks that were zero already count towards
+    // the target, so pruning a pruned matrix again to the same sparsity changes nothing.
+    template<typename T>
+    size_t prune(MatrixView<T> weights, double sparsity, Layout layout) {
+        if (!(sparsity >= 0.0 && sparsity <= 1.0)) {
+            throw std::invalid_argument("Sparsity must be between 0 and 1");
+        }
+        const size_t block = blockSize(layout);
+        const size_t inputs = weights.getRows();
+        const std::vector<T> scores = detail::blockScores<T>(weights, block);
+        const size_t target = static_cast<size_t>(sparsity * static_cast<double>(scores.size()));
+        if (target == 0) return 0;
+
+        std::vector<size_t> order(scores.size());
+        std::iota(order.begin(), order.end(), size_t(0));
+        std::nth_element(order.begin(), order.begin() + (target - 1), order.end(),
+                         [&](size_t a, size_t b) { return scores[a] < scores[b] || (scores[a] == scores[b] && a < b); });
+        for (size_t k = 0; k < target; ++k) {
+            const size_t p = order[k] % inputs;
+            const size_t first = (order[k] / inputs) * block;
+            const size_t last = std::min(first + block, weights.getCols());
+            for (size_t j = first; j < last; ++j) weights.at(p, j) = T(0);
+        }
+        return target;
+    }
+
+    // Block-sparse weights for products input * W, W [inputs x outputs]
+    // Holds only the nonzero blocks of W; the dense matrix it was built from stays the
+    // source of truth (see refresh)
+    template<typename T>
+    class BlockCsr {
+    private:
+        Layout layout = Layout::CSR;
+        size_t inputs = 0;
+        size_t outputs = 0;
+        std::vector<size_t> offsets;      // block_rows + 1 entries
+        std::vector<uint32_t> indices;    // Input index per stored block
+        std::vector<T, Memory::AlignedAllocator<T>> values;  // B weights per stored block, channel order
+
+        size_t blockRows() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+
+    public:
+        BlockCsr() = default;
+
+        // Store every block of weights that has a nonzero entry
+        static BlockCsr fromDense(MatrixView<const T> weights, Layout layout) {
+            if (weights.getRows() > static_cast<size_t>(INT32_MAX)) {
+                throw std::invalid_argument("Sparse weights support at most 2^31 - 1 inputs");
+            }
+            BlockCsr result;
+            result.layout = layout;
+            result.inputs = weights.getRows();
+            result.outputs = weights.getCols();
+            const size_t block = blockSize(layout);
+            const size_t block_rows = (result.outputs + block - 1) / block;
+            result.offsets.assign(1, 0);
+            for (size_t b = 0; b < block_rows; ++b) {
+                const size_t first = b * block;
+                const size_t last = std::min(first + block, result.outputs);
+                for (size_t p = 0; p < result.inputs; ++p) {
+                    bool nonzero = false;
+                    for (size_t j = first; j < last; ++j) nonzero = nonzero || weights.at(p, j) != T(0);
+                    if (!nonzero) continue;
+                    result.indices.push_back(static_cast<uint32_t>(p));
+                    for (size_t j = first; j < first + block; ++j) {
+                        result.values.push_back(j < last ? weights.at(p, j) : T(0));
+                    }
+                }
+                result.offsets.push_back(result.indices.size());
+            }
+            return result;
+        }
+
+        // Re-read the stored blocks from updated dense weights of the same shape, and zero
+        // every weight outside them, so further training keeps the pruned pattern
+        void refresh(MatrixView<T> weights) {
+            if (weights.getRows() != inputs || weights.getCols() != outputs) {
+                throw std::invalid_argument("Weights do not match the sparse pattern");
+            }
+            const size_t block = blockSize(layout);
+            for (size_t b = 0; b < blockRows(); ++b) {
+                const size_t first = b * block;
+                const size_t last = std::min(first + block, outputs);
+                size_t q = offsets[b];
+                for (size_t p = 0; p < inputs; ++p) {
+                    const bool stored = q < offsets[b + 1] && indices[q] == p;
+                    for (size_t j = first; j < last; ++j) {
+                        if (stored) values[q * block + (j - first)] = weights.at(p, j);
+                        else weights.at(p, j) = T(0);
+                    }
+                    if (stored) ++q;
+                }
+            }
+        }
+
+        // out = input * W, then the epilogue on each finished tile of rows (all columns)
+        // input is [rows x inputs]; out is [rows x outputs] with unit column stride
+        void multiply(MatrixView<const T> input, MatrixView<T> out, const Gemm::Epilogue<T>* epilogue = nullptr) const {
+            const size_t rows = input.getRows();
+            if (input.getCols() != inputs || out.getRows() != rows || out.getCols() != outputs ||
+                out.colStride() != 1) {
+                throw std::invalid_argument("Sparse product shapes do not match");
+            }
+            if (rows == 0 || outputs == 0) return;
+            NN_PROFILE_SCOPE_WORK("op", "sparse_gemm", 2 * rows * values.size(),
+                                  (rows * (inputs + outputs)) * sizeof(T) + values.size() * sizeof(T) +
+                                      indices.size() * sizeof(uint32_t));
+
+            const detail::Kernels<T>& kernels = detail::select<T>(Simd::activeLevel());
+            const auto kernel = kernels.forLayout(layout);
+            const size_t lanes = kernels.lanes;
+            const detail::Operands<T> op{input.data(), input.rowStride(), input.colStride(), inputs,
+                                         offsets.data(), indices.data(), values.data(), blockRows(),
+                                         out.data(), out.rowStride(), outputs, epilogue};
+            const size_t scratch_size = (inputs + blockRows() * blockSize(layout)) * lanes;
+
+            // Tiles of `lanes` rows, enough of them per task to amortize scheduling
+            const size_t tiles = (rows + lanes - 1) / lanes;
+            const size_t tile_work = std::max<size_t>(1, values.size() * lanes);
+            const size_t grain = std::max<size_t>(1, Parallel::ELEMENTWISE_GRAIN * 16 / tile_work);
+            Parallel::parallelFor(0, tiles, grain, [&](size_t lo, size_t hi) {
+                thread_local std::vector<T, Memory::AlignedAllocator<T>> scratch;
+                if (scratch.size() < scratch_size) scratch.resize(scratch_size);
+                kernel(op, lo * lanes, std::min(hi * lanes, rows), scratch.data());
+            });
+        }
+
+        bool empty() const { return offsets.empty(); }
+        Layout getLayout() const { return layout; }
+        size_t getInputs() const { return inputs; }
+        size_t getOutputs() const { return outputs; }
+        // Stored blocks, and the fraction of all blocks they make up
+        size_t blocks() const { return indices.size(); }
+        double density() const {
+            const size_t total = blockRows() * inputs;
+            return total == 0 ? 0.0 : static_cast<double>(blocks()) / static_cast<double>(total);
+        }
+        // Memory held by the pattern and values
+        size_t bytes() const {
+            return offsets.size() * sizeof(size_t) + indices.size() * sizeof(uint32_t) + values.size() * sizeof(T);
+        }
+    };
+}
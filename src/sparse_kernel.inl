@@ -0,0 +1,174 @@
+// Sparse x dense product kernels
+// Included once per SIMD region (AVX2, AVX-512) and once without target options (scalar)
+// by sparse.hpp. Do not include directly.
+//
+// A tile of input rows is packed input-major first (packed[p * lanes + r]), so one vector
+// load fetches input p of every row in the tile and each stored weight costs one broadcast
+// multiply-add per row vector. The block-row sums are staged channel-major and then
+// transposed into the output rows, where the epilogue runs on them.
+//
+// Ops: lane operations from simd.hpp; Operands and ROW_KERNEL_ROWS are defined in sparse.hpp
+
+// staged[j * L + r] = sum over the stored blocks of block row j / B, for the L packed rows
+// Independent accumulator groups (U) hide the multiply-add latency when blocks are narrow
+template<typename Ops, size_t B>
+inline void blockRows(const Operands<typename Ops::T>& op, const typename Ops::T* packed, typename Ops::T* staged) {
+    using V = typename Ops::V;
+    constexpr size_t L = Ops::lanes;
+    constexpr size_t U = B >= 8 ? 1 : 8 / B;
+    for (size_t block = 0; block < op.block_rows; ++block) {
+        V acc[U][B];
+#pragma GCC unroll 8
+        for (size_t u = 0; u < U; ++u)
+#pragma GCC unroll 8
+            for (size_t b = 0; b < B; ++b) acc[u][b] = Ops::zero();
+
+        size_t q = op.offsets[block];
+        const size_t end = op.offsets[block + 1];
+        for (; q + U <= end; q += U) {
+#pragma GCC unroll 8
+            for (size_t u = 0; u < U; ++u) {
+                const V x = Ops::load(packed + size_t(op.indices[q + u]) * L);
+                const typename Ops::T* w = op.values + (q + u) * B;
+#pragma GCC unroll 8
+                for (size_t b = 0; b < B; ++b) acc[u][b] = Ops::fma(Ops::broadcast(w[b]), x, acc[u][b]);
+            }
+        }
+        for (; q < end; ++q) {
+            const V x = Ops::load(packed + size_t(op.indices[q]) * L);
+            const typename Ops::T* w = op.values + q * B;
+#pragma GCC unroll 8
+            for (size_t b = 0; b < B; ++b) acc[0][b] = Ops::fma(Ops::broadcast(w[b]), x, acc[0][b]);
+        }
+
+#pragma GCC unroll 8
+        for (size_t u = 1; u < U; ++u)
+#pragma GCC unroll 8
+            for (size_t b = 0; b < B; ++b) acc[0][b] = Ops::add(acc[0][b], acc[u][b]);
+#pragma GCC unroll 8
+        for (size_t b = 0; b < B; ++b) Ops::store(staged + (block * B + b) * L, acc[0][b]);
+    }
+}
+
+// Output rows [first, first + count) with count <= Ops::lanes; missing rows are packed as zeros
+template<typename Ops, size_t B>
+inline void tile(const Operands<typename Ops::T>& op, size_t first, size_t count, typename Ops::T* scratch) {
+    using T = typename Ops::T;
+    constexpr size_t L = Ops::lanes;
+    T* packed = scratch;
+    T* staged = scratch + op.inputs * L;
+    for (size_t r = 0; r < L; ++r) {
+        if (r < count) {
+            const T* in = op.input + (first + r) * op.input_row_stride;
+            for (size_t p = 0; p < op.inputs; ++p) packed[p * L + r] = in[p * op.input_col_stride];
+        } else {
+            for (size_t p = 0; p < op.inputs; ++p) packed[p * L + r] = T(0);
+        }
+    }
+
+    blockRows<Ops, B>(op, packed, staged);
+
+    for (size_t r = 0; r < count; ++r) {
+        T* out = op.out + (first + r) * op.out_stride;
+        for (size_t j = 0; j < op.outputs; ++j) out[j] = staged[j * L + r];
+    }
+    if (op.epilogue) {
+        op.epilogue->apply(op.epilogue->context, op.out + first * op.out_stride, op.out_stride, first, 0, count,
+                           op.outputs);
+    }
+}
+
+// One output row: the row is packed contiguously, then each block row is summed along the
+// block (B a multiple of RowOps::lanes) or, for CSR, along the channel's stored inputs with
+// gathers of the packed row
+template<typename Ops, typename RowOps, size_t B>
+inline void row(const Operands<typename Ops::T>& op, size_t i, typename Ops::T* scratch) {
+    using T = typename Ops::T;
+    T* packed = scratch;
+    const T* in = op.input + i * op.input_row_stride;
+    for (size_t p = 0; p < op.inputs; ++p) packed[p] = in[p * op.input_col_stride];
+
+    T* out = op.out + i * op.out_stride;
+    for (size_t block = 0; block < op.block_rows; ++block) {
+        const size_t begin = op.offsets[block];
+        const size_t end = op.offsets[block + 1];
+        T sums[B];
+        if constexpr (B == 1) {
+            // Two vectors of stored inputs per step, then the scalar tail
+            constexpr size_t L = Ops::lanes;
+            typename Ops::V acc[2] = {Ops::zero(), Ops::zero()};
+            size_t q = begin;
+            for (; q + 2 * L <= end; q += 2 * L) {
+#pragma GCC unroll 2
+                for (size_t u = 0; u < 2; ++u) {
+                    acc[u] = Ops::fma(Ops::load(op.values + q + u * L), Ops::gather(packed, op.indices + q + u * L),
+                                      acc[u]);
+                }
+            }
+            T lanes[L];
+            Ops::store(lanes, Ops::add(acc[0], acc[1]));
+            T sum = 0;
+            for (size_t k = 0; k < L; ++k) sum += lanes[k];
+            for (; q < end; ++q) sum += op.values[q] * packed[op.indices[q]];
+            sums[0] = sum;
+        } else if constexpr (B % RowOps::lanes == 0) {
+            constexpr size_t N = B / RowOps::lanes;
+            constexpr size_t U = N >= 4 ? 1 : 4 / N;
+            typename RowOps::V acc[U][N];
+#pragma GCC unroll 4
+            for (size_t u = 0; u < U; ++u)
+#pragma GCC unroll 8
+                for (size_t n = 0; n < N; ++n) acc[u][n] = RowOps::zero();
+            size_t q = begin;
+            for (; q + U <= end; q += U) {
+#pragma GCC unroll 4
+                for (size_t u = 0; u < U; ++u) {
+                    const typename RowOps::V x = RowOps::broadcast(packed[op.indices[q + u]]);
+#pragma GCC unroll 8
+                    for (size_t n = 0; n < N; ++n) {
+                        acc[u][n] = RowOps::fma(x, RowOps::load(op.values + (q + u) * B + n * RowOps::lanes), acc[u][n]);
+                    }
+                }
+            }
+            for (; q < end; ++q) {
+                const typename RowOps::V x = RowOps::broadcast(packed[op.indices[q]]);
+#pragma GCC unroll 8
+                for (size_t n = 0; n < N; ++n) {
+                    acc[0][n] = RowOps::fma(x, RowOps::load(op.values + q * B + n * RowOps::lanes), acc[0][n]);
+                }
+            }
+#pragma GCC unroll 4
+            for (size_t u = 1; u < U; ++u)
+#pragma GCC unroll 8
+                for (size_t n = 0; n < N; ++n) acc[0][n] = RowOps::add(acc[0][n], acc[u][n]);
+#pragma GCC unroll 8
+            for (size_t n = 0; n < N; ++n) RowOps::store(sums + n * RowOps::lanes, acc[0][n]);
+        } else {
+            // Blocks narrower than a row vector (4x1 in float): plain loop
+            for (size_t b = 0; b < B; ++b) sums[b] = T(0);
+            for (size_t q = begin; q < end; ++q) {
+                const T x = packed[op.indices[q]];
+#pragma GCC unroll 8
+                for (size_t b = 0; b < B; ++b) sums[b] += x * op.values[q * B + b];
+            }
+        }
+        const size_t first = block * B;
+        const size_t width = std::min(B, op.outputs - first);
+        for (size_t b = 0; b < width; ++b) out[first + b] = sums[b];
+    }
+    if (op.epilogue) op.epilogue->apply(op.epilogue->context, out, op.out_stride, i, 0, 1, op.outputs);
+}
+
+// Output rows [lo, hi): full tiles of Ops::lanes rows; a remainder of more than
+// ROW_KERNEL_ROWS rows as one zero-padded tile, shorter ones row by row
+// RowOps are the vectors of the single-row kernel, at most B lanes wide
+template<typename Ops, typename RowOps, size_t B>
+void multiplyRows(const Operands<typename Ops::T>& op, size_t lo, size_t hi, typename Ops::T* scratch) {
+    size_t i = lo;
+    for (; i + Ops::lanes <= hi; i += Ops::lanes) tile<Ops, B>(op, i, Ops::lanes, scratch);
+    if (hi - i > ROW_KERNEL_ROWS) {
+        tile<Ops, B>(op, i, hi - i, scratch);
+        return;
+    }
+    for (; i < hi; ++i) row<Ops, RowOps, B>(op, i, scratch);
+}
@@ -0,0 +1,286 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <array>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "simd.hpp"
+
+namespace Parallel {
+    // Unit of work: chunk `index` of a parallel loop
+    // Plain function pointer + context, so queuing a task never allocates
+    struct Task {
+        void (*run)(void* context, size_t index) = nullptr;
+        void* context = nullptr;
+        size_t index = 0;
+        std::atomic<size_t>* pending = nullptr;  // Decremented once the task finishes
+    };
+
+    // Fixed-capacity double-ended task queue
+    // The owning thread pushes and pops at the back; other threads steal from the front
+    class WorkQueue {
+    private:
+        static constexpr size_t CAPACITY = 512;
+        std::mutex mutex;
+        std::array<Task, CAPACITY> ring;
+        size_t head = 0;  // Oldest task (steal end)
+        size_t tail = 0;  // One past the newest task (owner end)
+
+    public:
+        // Returns false when full; the caller then runs the task itself
+        bool push(const Task& task) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (tail - head == CAPACITY) return false;
+            ring[tail++ % CAPACITY] = task;
+            return true;
+        }
+
+        bool popBack(Task& task) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (tail == head) return false;
+            task = ring[--tail % CAPACITY];
+            return true;
+        }
+
+        bool stealFront(Task& task) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (tail == head) return false;
+            task = ring[head++ % CAPACITY];
+            return true;
+        }
+    };
+
+    // Work-stealing thread pool
+    // A pool of size N runs N - 1 worker threads; the thread calling parallelFor
+    // always executes work too, and keeps helping (instead of blocking) while it
+    // waits, so nested parallel loops cannot deadlock.
+    class ThreadPool {
+    private:
+        std::vector<std::unique_ptr<WorkQueue>> queues;  // One per worker, plus one shared by external callers
+        std::vector<std::thread> workers;
+        std::mutex sleep_mutex;
+        std::condition_variable wake;
+        std::atomic<size_t> queued{0};
+        bool stopping = false;
+
+        // Index of the calling thread's queue in this pool (external threads share the last one)
+        size_t ownQueue() const {
+            const ThreadPool* owner = currentPool();
+            return owner == this ? currentWorker() : queues.size() - 1;
+        }
+
+        static const ThreadPool*& currentPool() {
+            thread_local const ThreadPool* pool = nullptr;
+            return pool;
+        }
+
+        static size_t& currentWorker() {
+            thread_local size_t index = 0;
+            return index;
+        }
+
+        // Run one queued task: own queue first (newest work, warm cache), then steal
+        bool tryRunOne() {
+            const size_t own = ownQueue();
+            Task task;
+            bool found = queues[own]->popBack(task);
+            for (size_t i = 1; !found && i < queues.size(); ++i) {
+                found = queues[(own + i) % queues.size()]->stealFront(task);
+            }
+            if (!found) return false;
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            task.run(task.context, task.index);
+            task.pending->fetch_sub(1, std::memory_order_release);
+            return true;
+        }
+
+        void workerLoop(size_t index) {
+            currentPool() = this;
+            currentWorker() = index;
+            while (true) {
+                if (tryRunOne()) continue;
+                std::unique_lock<std::mutex> lock(sleep_mutex);
+                wake.wait(lock, [this] { return stopping || queued.load(std::memory_order_relaxed) > 0; });
+                if (stopping) return;
+            }
+        }
+
+        void submit(const Task& task) {
+            if (!queues[ownQueue()]->push(task)) {
+                // Queue full: execute inline rather than allocate
+                task.run(task.context, task.index);
+                task.pending->fetch_sub(1, std::memory_order_release);
+                return;
+            }
+            queued.fetch_add(1, std::memory_order_relaxed);
+            { std::lock_guard<std::mutex> lock(sleep_mutex); }
+            wake.notify_one();
+        }
+
+    public:
+        // Constructor: num_threads counts the calling thread, so 1 means fully serial
+        explicit ThreadPool(size_t num_threads) {
+            const size_t worker_count = num_threads > 1 ? num_threads - 1 : 0;
+            for (size_t i = 0; i <= worker_count; ++i) {
+                queues.push_back(std::make_unique<WorkQueue>());
+            }
+            for (size_t i = 0; i < worker_count; ++i) {
+                workers.emplace_back([this, i] { workerLoop(i); });
+            }
+        }
+
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(sleep_mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (auto& worker : workers) worker.join();
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // Number of threads that execute work, including the caller
+        size_t size() const { return workers.size() + 1; }
+
+        // Run body(lo, hi) over [begin, end) split into chunks of at least `grain` items
+        // Chunk boundaries depend only on the range, grain and pool size
+        // Every chunk runs with the caller's denormal mode, whichever thread executes it
+        template<typename Body>
+        void parallelFor(size_t begin, size_t end, size_t grain, const Body& body) {
+            if (end <= begin) return;
+            const size_t total = end - begin;
+            grain = grain == 0 ? 1 : grain;
+            size_t chunks = std::min((total + grain - 1) / grain, size() * 4);
+            if (chunks <= 1 || size() == 1) {
+                body(begin, end);
+                return;
+            }
+
+            struct Context {
+                const Body* body;
+                size_t begin, end, chunk;
+                std::exception_ptr error;
+                std::atomic<bool> failed{false};
+                unsigned denormal_mode = Simd::denormalMode();
+            } context{&body, begin, end, (total + chunks - 1) / chunks, nullptr};
+            chunks = (total + context.chunk - 1) / context.chunk;
+
+            auto run = [](void* raw, size_t index) {
+                auto* ctx = static_cast<Context*>(raw);
+                const size_t lo = ctx->begin + index * ctx->chunk;
+                const size_t hi = std::min(ctx->end, lo + ctx->chunk);
+                Simd::DenormalModeGuard mode(ctx->denormal_mode);
+                try {
+                    (*ctx->body)(lo, hi);
+                } catch (...) {
+                    // Keep the first exception and rethrow it on the calling thread
+                    if (!ctx->failed.exchange(true)) ctx->error = std::current_exception();
+                }
+            };
+
+            std::atomic<size_t> pending{chunks - 1};
+            for (size_t index = 1; index < chunks; ++index) {
+                submit(Task{run, &context, index, &pending});
+            }
+            run(&context, 0);
+
+            // Help with queued work until every chunk of this loop has finished
+            while (pending.load(std::memory_order_acquire) > 0) {
+                if (!tryRunOne()) std::this_thread::yield();
+            }
+            if (context.error) std::rethrow_exception(context.error);
+        }
+    };
+
+    namespace detail {
+        // Default thread count: NN_NUM_THREADS if set, otherwise every hardware thread
+        inline size_t defaultThreadCount() {
+            if (const char* env = std::getenv("NN_NUM_THREADS")) {
+                long requested = std::strtol(env, nullptr, 10);
+                if (requested > 0) return static_cast<size_t>(requested);
+            }
+            const unsigned hardware = std::thread::hardware_concurrency();
+            return hardware > 0 ? hardware : 1;
+        }
+
+        inline std::unique_ptr<ThreadPool>& poolStorage() {
+            static std::unique_ptr<ThreadPool> pool = std::make_unique<ThreadPool>(defaultThreadCount());
+            return pool;
+        }
+    }
+
+    // Shared pool used by GEMM, activations, losses and batched prediction
+    inline ThreadPool& pool() { return *detail::poolStorage(); }
+
+    inline size_t numThreads() { return pool().size(); }
+
+    // Resize the shared pool; 1 runs everything on the calling thread
+    // Not thread-safe: call while no parallel work is running
+    inline void setNumThreads(size_t num_threads) {
+        detail::poolStorage() = std::make_unique<ThreadPool>(num_threads > 0 ? num_threads : 1);
+    }
+
+    // Convenience wrapper over the shared pool
+    template<typename Body>
+    void parallelFor(size_t begin, size_t end, size_t grain, const Body& body) {
+        pool().parallelFor(begin, end, grain, body);
+    }
+
+    // Minimum elements per task for elementwise loops
+    // Below this, scheduling costs more than the loop itself
+    constexpr size_t ELEMENTWISE_GRAIN = 16384;
+
+    // Elements per block for parallel reductions
+    // Sums are always formed per fixed block and combined in block order, so
+    // results are bit-identical for any thread count, including 1
+    constexpr size_t REDUCTION_BLOCK = 4096;
+
+    // Compensated (Neumaier) running sum: the rounding error of every addition is kept in a
+    // second term, so long sums of same-signed values lose no more than a final rounding
+    template<typename T>
+    class CompensatedSum {
+    private:
+        T sum = 0;
+        T compensation = 0;
+
+    public:
+        void add(T value) {
+            const T total = sum + value;
+            if (std::abs(sum) >= std::abs(value)) compensation += (sum - total) + value;
+            else compensation += (value - total) + sum;
+            sum = total;
+        }
+
+        T value() const { return sum + compensation; }
+    };
+
+    // Deterministic parallel sum of block(lo, hi) over [0, count)
+    // Block results are combined with a CompensatedSum
+    template<typename T, typename Block>
+    T parallelSum(size_t count, const Block& block) {
+        const size_t blocks = (count + REDUCTION_BLOCK - 1) / REDUCTION_BLOCK;
+        if (blocks <= 1) return count == 0 ? T(0) : block(0, count);
+
+        thread_local std::vector<T> partials;
+        std::vector<T> local;
+        local.swap(partials);  // Take the buffer so nested reductions cannot alias it
+        local.assign(blocks, T(0));
+        parallelFor(0, blocks, 1, [&](size_t lo, size_t hi) {
+            for (size_t b = lo; b < hi; ++b) {
+                local[b] = block(b * REDUCTION_BLOCK, std::min(count, (b + 1) * REDUCTION_BLOCK));
+            }
+        });
+        CompensatedSum<T> sum;
+        for (T partial : local) sum.add(partial);
+        partials.swap(local);
+        return sum.value();
+    }
+}
@@ -1,7 +1,7 @@
 
 #pragma once
+#include "dataset.hpp"
 #include "matrix.hpp"
-#include <random>
 #include <algorithm>
 
 namespace Utils {
@@ -11,25 +11,11 @@ namespace Utils {
     public:
         // Generate synthetic XOR training/test data
         // Returns pair of input matrix and expected output matrix
-        static std::pair<Matrix<T>, Matrix<T>> generateXORData(size_t samples) {
-            Matrix<T> inputs(samples, 2);    // 2D inputs (operands)
-            Matrix<T> outputs(samples, 1);    // 1D outputs (XOR result)
-            
-            // Initialize random number generator
-            std::random_device rd;
-            std::mt19937 gen(rd());
-            std::uniform_int_distribution<> dis(0, 1);  // Binary distribution
-
-            // Generate random binary inputs and compute XOR outputs
-            for (size_t i = 0; i < samples; ++i) {
-                bool a = dis(gen);  // First operand
-                bool b = dis(gen);  // Second operand
-                inputs.at(i, 0) = a;
-                inputs.at(i, 1) = b;
-                outputs.at(i, 0) = a != b;  // XOR operation
-            }
-
-            return {inputs, outputs};
+        // Without a seed each call draws one from the global sequence (Random::nextSeed)
+        static std::pair<Matrix<T>, Matrix<T>> generateXORData(size_t samples, uint64_t seed = Random::nextSeed()) {
+            // Same samples a Data::XorSource streams; read them all at once
+            Data::XorSource<T> source(samples, seed);
+            return Data::readAll(source);
         }
     };
 
@@ -39,7 +25,7 @@ namespace Utils {
     public:
         // Calculate classification accuracy
         // Compares predicted values to expected values using threshold
-        static T accuracy(const Matrix<T>& predicted, const Matrix<T>& expected, T threshold = 0.5) {
+        static T accuracy(const Matrix<T>& predicted, const Matrix<T>& expected, T threshold = T(0.5)) {
             size_t correct = 0;
             size_t total = predicted.getRows() * predicted.getCols();
 
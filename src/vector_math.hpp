@@ -0,0 +1,174 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include "simd.hpp"
+
+// Vectorized transcendental functions over arrays: exp, log, sigmoid and tanh
+// Each call dispatches to the scalar, AVX2 or AVX-512 kernel picked by Simd::activeLevel().
+//
+// Method: Cody-Waite reduction x = n * ln2 + r (|r| <= ln2 / 2), a Taylor polynomial for e^r
+// (degree 13 for double, 7 for float), then scaling by 2^n. tanh goes through an expm1 that
+// evaluates r * q(r) directly near zero, so small inputs keep full relative accuracy.
+// log splits x = m * 2^e with m in [sqrt(1/2), sqrt(2)) and sums the odd atanh series of
+// s = (m - 1) / (m + 1) (|s| <= 0.172; 11 terms for double, 5 for float), arranged as
+// f - s * (f - s^2 q) around the exact f = m - 1.
+//
+// Maximum error of the AVX2/AVX-512 kernels against a long double reference, measured
+// over dense sweeps by bench/vector_math_bench.cpp (documented bound / measured):
+//   exp      <= 1 ulp (0.85 double, 0.94 float)
+//   log      <= 2 ulp (1.11 double, 0.94 float)
+//   sigmoid  <= 3 ulp (2.41 double, 2.44 float)
+//   tanh     <= 4 ulp (3.17 double, 2.86 float)
+// The scalar level calls libm, which has one lane's worth of work anyway.
+// Edge cases: NaN propagates, exp overflows to +inf and underflows to 0 (subnormal results
+// are produced down to the smallest subnormal), tanh saturates to exactly +-1, log gives -inf
+// at 0, NaN below 0 and +inf at +inf, and takes subnormal inputs at full accuracy.
+namespace VectorMath {
+    namespace detail {
+        template<typename T>
+        struct Constants;
+
+        template<>
+        struct Constants<double> {
+            static constexpr double log2e = 1.4426950408889634074;
+            static constexpr double ln2_hi = 6.93147180369123816490e-01;  // 32 significant bits
+            static constexpr double ln2_lo = 1.90821492927058770002e-10;
+            static constexpr double exp_max = 709.782712893383973096;   // ln(DBL_MAX)
+            static constexpr double exp_min = -745.133219101941108420;  // ln(smallest subnormal)
+            static constexpr double tanh_limit = 20.0;                  // tanh(20) rounds to 1
+            static constexpr double infinity = std::numeric_limits<double>::infinity();
+            static constexpr size_t degree = 13;
+            // 1/1!, 1/2!, ..., 1/13!
+            static constexpr double taylor[degree] = {
+                1.0, 1.0 / 2, 1.0 / 6, 1.0 / 24, 1.0 / 120, 1.0 / 720, 1.0 / 5040,
+                1.0 / 40320, 1.0 / 362880, 1.0 / 3628800, 1.0 / 39916800,
+                1.0 / 479001600, 1.0 / 6227020800};
+            static constexpr double sqrt2 = 1.41421356237309504880;
+            static constexpr double min_normal = std::numeric_limits<double>::min();
+            static constexpr double subnormal_scale = 18014398509481984.0;  // 2^54
+            static constexpr double subnormal_bits = 54;
+            static constexpr double quiet_nan = std::numeric_limits<double>::quiet_NaN();
+            static constexpr size_t log_degree = 11;
+            // log(m) = 2s + s^3 * sum(series[k] * s^2k): 2/3, 2/5, ..., 2/23
+            static constexpr double log_series[log_degree] = {
+                2.0 / 3, 2.0 / 5, 2.0 / 7, 2.0 / 9, 2.0 / 11, 2.0 / 13, 2.0 / 15,
+                2.0 / 17, 2.0 / 19, 2.0 / 21, 2.0 / 23};
+        };
+
+        template<>
+        struct Constants<float> {
+            static constexpr float log2e = 1.44269504f;
+            static constexpr float ln2_hi = 0.693359375f;                // 9 significant bits
+            static constexpr float ln2_lo = -2.12194440e-4f;
+            static constexpr float exp_max = 88.7228394f;               // ln(FLT_MAX)
+            static constexpr float exp_min = -103.972084f;              // ln(smallest subnormal)
+            static constexpr float tanh_limit = 9.0f;                    // tanh(9) rounds to 1
+            static constexpr float infinity = std::numeric_limits<float>::infinity();
+            static constexpr size_t degree = 7;
+            // 1/1!, 1/2!, ..., 1/7!
+            static constexpr float taylor[degree] = {
+                1.0f, 1.0f / 2, 1.0f / 6, 1.0f / 24, 1.0f / 120, 1.0f / 720, 1.0f / 5040};
+            static constexpr float sqrt2 = 1.41421356f;
+            static constexpr float min_normal = std::numeric_limits<float>::min();
+            static constexpr float subnormal_scale = 33554432.0f;          // 2^25
+            static constexpr float subnormal_bits = 25;
+            static constexpr float quiet_nan = std::numeric_limits<float>::quiet_NaN();
+            static constexpr size_t log_degree = 5;
+            // 2/3, 2/5, ..., 2/11
+            static constexpr float log_series[log_degree] = {2.0f / 3, 2.0f / 5, 2.0f / 7, 2.0f / 9, 2.0f / 11};
+        };
+
+        // Scalar level: one lane gains nothing from the polynomial, so defer to libm
+        namespace portable {
+            template<typename T>
+            void exp(const T* in, T* out, size_t count) {
+                for (size_t i = 0; i < count; ++i) out[i] = std::exp(in[i]);
+            }
+
+            template<typename T>
+            void log(const T* in, T* out, size_t count) {
+                for (size_t i = 0; i < count; ++i) out[i] = std::log(in[i]);
+            }
+
+            template<typename T>
+            void sigmoid(const T* in, T* out, size_t count) {
+                for (size_t i = 0; i < count; ++i) out[i] = T(1) / (T(1) + std::exp(-in[i]));
+            }
+
+            template<typename T>
+            void tanh(const T* in, T* out, size_t count) {
+                for (size_t i = 0; i < count; ++i) out[i] = std::tanh(in[i]);
+            }
+        }
+
+#if NN_SIMD_X86
+NN_SIMD_BEGIN_AVX2
+        namespace avx2 {
+#include "vector_math_kernel.inl"
+        }
+NN_SIMD_END
+
+NN_SIMD_BEGIN_AVX512
+        namespace avx512 {
+#include "vector_math_kernel.inl"
+        }
+NN_SIMD_END
+#endif
+
+        // Array kernels for one instruction set
+        template<typename T>
+        struct Kernels {
+            void (*exp)(const T*, T*, size_t);
+            void (*log)(const T*, T*, size_t);
+            void (*sigmoid)(const T*, T*, size_t);
+            void (*tanh)(const T*, T*, size_t);
+        };
+
+        template<typename T>
+        const Kernels<T>& select(Simd::Level level) {
+            static const Kernels<T> scalar{&portable::exp<T>, &portable::log<T>, &portable::sigmoid<T>, &portable::tanh<T>};
+#if NN_SIMD_X86
+            static const Kernels<T> avx2{
+                &avx2::applyArray<Simd::Avx2Ops<T>, avx2::expVector<Simd::Avx2Ops<T>>>,
+                &avx2::applyArray<Simd::Avx2Ops<T>, avx2::logVector<Simd::Avx2Ops<T>>>,
+                &avx2::applyArray<Simd::Avx2Ops<T>, avx2::sigmoidVector<Simd::Avx2Ops<T>>>,
+                &avx2::applyArray<Simd::Avx2Ops<T>, avx2::tanhVector<Simd::Avx2Ops<T>>>};
+            static const Kernels<T> avx512{
+                &avx512::applyArray<Simd::Avx512Ops<T>, avx512::expVector<Simd::Avx512Ops<T>>>,
+                &avx512::applyArray<Simd::Avx512Ops<T>, avx512::logVector<Simd::Avx512Ops<T>>>,
+                &avx512::applyArray<Simd::Avx512Ops<T>, avx512::sigmoidVector<Simd::Avx512Ops<T>>>,
+                &avx512::applyArray<Simd::Avx512Ops<T>, avx512::tanhVector<Simd::Avx512Ops<T>>>};
+            if (level == Simd::Level::AVX512) return avx512;
+            if (level == Simd::Level::AVX2) return avx2;
+#else
+            (void)level;
+#endif
+            return scalar;
+        }
+    }
+
+    // out[i] = e^in[i]; in and out may alias
+    template<typename T>
+    void exp(const T* in, T* out, size_t count) {
+        detail::select<T>(Simd::activeLevel()).exp(in, out, count);
+    }
+
+    // out[i] = ln(in[i]); in and out may alias
+    template<typename T>
+    void log(const T* in, T* out, size_t count) {
+        detail::select<T>(Simd::activeLevel()).log(in, out, count);
+    }
+
+    // out[i] = 1 / (1 + e^-in[i]); in and out may alias
+    template<typename T>
+    void sigmoid(const T* in, T* out, size_t count) {
+        detail::select<T>(Simd::activeLevel()).sigmoid(in, out, count);
+    }
+
+    // out[i] = tanh(in[i]); in and out may alias
+    template<typename T>
+    void tanh(const T* in, T* out, size_t count) {
+        detail::select<T>(Simd::activeLevel()).tanh(in, out, count);
+    }
+}
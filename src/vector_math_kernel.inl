@@ -0,0 +1,124 @@
+// Vectorized exp / expm1 / log / sigmoid / tanh kernel bodies
+// Included once per SIMD region (AVX2, AVX-512) by vector_math.hpp, so each copy is
+// compiled with that region's target options. Do not include directly.
+//
+// Ops: lane operations from simd.hpp; Constants<T> is defined in vector_math.hpp
+
+// Shared range reduction: x = n * ln2 + r with |r| <= ln2 / 2
+// Returns q(r) such that e^r = 1 + r * q(r), using the Taylor coefficients 1/k!
+template<typename Ops>
+inline typename Ops::V reduce(typename Ops::V x, typename Ops::V& n, typename Ops::V& r) {
+    using T = typename Ops::T;
+    using C = Constants<T>;
+    n = Ops::round(Ops::mul(x, Ops::broadcast(C::log2e)));
+    // Cody-Waite: ln2_hi has trailing zero bits, so n * ln2_hi is exact
+    r = Ops::fma(n, Ops::broadcast(-C::ln2_hi), x);
+    r = Ops::fma(n, Ops::broadcast(-C::ln2_lo), r);
+
+    typename Ops::V q = Ops::broadcast(C::taylor[C::degree - 1]);
+#pragma GCC unroll 16
+    for (size_t k = C::degree - 1; k > 0; --k) {
+        q = Ops::fma(q, r, Ops::broadcast(C::taylor[k - 1]));
+    }
+    return q;
+}
+
+// e^x for one vector; NaN propagates, overflow gives +inf, deep underflow gives 0
+template<typename Ops>
+inline typename Ops::V expVector(typename Ops::V x) {
+    using C = Constants<typename Ops::T>;
+    const typename Ops::V hi = Ops::broadcast(C::exp_max);
+    const typename Ops::V lo = Ops::broadcast(C::exp_min);
+    // min/max return x when it is NaN, so NaN flows through to the result
+    typename Ops::V clamped = Ops::min(hi, Ops::max(lo, x));
+
+    typename Ops::V n, r;
+    typename Ops::V q = reduce<Ops>(clamped, n, r);
+    typename Ops::V result = Ops::ldexp(Ops::fma(r, q, Ops::broadcast(1)), n);
+
+    result = Ops::selectGreater(x, hi, Ops::broadcast(C::infinity), result);
+    return Ops::selectGreater(lo, x, Ops::zero(), result);
+}
+
+// e^x - 1 without cancellation near 0; input must already be clamped to a finite range
+template<typename Ops>
+inline typename Ops::V expm1Vector(typename Ops::V x) {
+    typename Ops::V n, r;
+    typename Ops::V q = reduce<Ops>(x, n, r);
+    // For |x| <= ln2 / 2 the reduction leaves n == 0 and r * q is e^x - 1 directly
+    typename Ops::V small = Ops::mul(r, q);
+    typename Ops::V large = Ops::sub(Ops::ldexp(Ops::fma(r, q, Ops::broadcast(1)), n), Ops::broadcast(1));
+    return Ops::selectEqual(n, Ops::zero(), small, large);
+}
+
+// Natural log for one vector
+// x = m * 2^e with m in [sqrt(1/2), sqrt(2)), then log(m) = 2 atanh(s) = 2s + s^3 * q(s^2)
+// with s = (m - 1) / (m + 1); m - 1 is exact, so there is no cancellation near x = 1
+template<typename Ops>
+inline typename Ops::V logVector(typename Ops::V x) {
+    using C = Constants<typename Ops::T>;
+    const typename Ops::V one = Ops::broadcast(1);
+    const typename Ops::V min_normal = Ops::broadcast(C::min_normal);
+    const typename Ops::V sqrt2 = Ops::broadcast(C::sqrt2);
+
+    // Subnormals are scaled into the normal range first and their exponent corrected
+    typename Ops::V scaled = Ops::selectGreater(min_normal, x, Ops::mul(x, Ops::broadcast(C::subnormal_scale)), x);
+    typename Ops::V e = Ops::add(Ops::getexp(scaled),
+                                 Ops::selectGreater(min_normal, x, Ops::broadcast(-C::subnormal_bits), Ops::zero()));
+    typename Ops::V m = Ops::getmant(scaled);
+    e = Ops::selectGreater(m, sqrt2, Ops::add(e, one), e);
+    m = Ops::selectGreater(m, sqrt2, Ops::mul(m, Ops::broadcast(0.5)), m);
+
+    typename Ops::V f = Ops::sub(m, one);
+    typename Ops::V s = Ops::div(f, Ops::add(f, Ops::broadcast(2)));
+    typename Ops::V z = Ops::mul(s, s);
+    typename Ops::V q = Ops::broadcast(C::log_series[C::log_degree - 1]);
+#pragma GCC unroll 16
+    for (size_t k = C::log_degree - 1; k > 0; --k) {
+        q = Ops::fma(q, z, Ops::broadcast(C::log_series[k - 1]));
+    }
+    // 2s = f - s * f, so log(m) = f - s * (f - s^2 q): the leading term f carries no rounding
+    typename Ops::V result = Ops::fma(Ops::sub(Ops::zero(), s), Ops::sub(f, Ops::mul(z, q)), f);
+    // e * ln2 in two parts; e * ln2_hi is exact
+    result = Ops::fma(e, Ops::broadcast(C::ln2_lo), result);
+    result = Ops::fma(e, Ops::broadcast(C::ln2_hi), result);
+
+    result = Ops::selectEqual(x, Ops::zero(), Ops::broadcast(-C::infinity), result);
+    result = Ops::selectGreater(Ops::zero(), x, Ops::broadcast(C::quiet_nan), result);
+    result = Ops::selectEqual(x, Ops::broadcast(C::infinity), x, result);
+    // NaN compares unequal to itself: pass it through
+    return Ops::selectEqual(x, x, result, x);
+}
+
+// 1 / (1 + e^-x)
+template<typename Ops>
+inline typename Ops::V sigmoidVector(typename Ops::V x) {
+    const typename Ops::V one = Ops::broadcast(1);
+    return Ops::div(one, Ops::add(one, expVector<Ops>(Ops::sub(Ops::zero(), x))));
+}
+
+// tanh(x) = expm1(2x) / (expm1(2x) + 2), with x clamped where tanh is already +-1
+template<typename Ops>
+inline typename Ops::V tanhVector(typename Ops::V x) {
+    using C = Constants<typename Ops::T>;
+    const typename Ops::V limit = Ops::broadcast(C::tanh_limit);
+    typename Ops::V clamped = Ops::min(limit, Ops::max(Ops::sub(Ops::zero(), limit), x));
+    typename Ops::V em = expm1Vector<Ops>(Ops::add(clamped, clamped));
+    return Ops::div(em, Ops::add(em, Ops::broadcast(2)));
+}
+
+// Apply a vector function to count elements; the tail goes through a padded lane buffer
+// in and out may point to the same memory
+template<typename Ops, typename Ops::V (*Op)(typename Ops::V)>
+void applyArray(const typename Ops::T* in, typename Ops::T* out, size_t count) {
+    size_t i = 0;
+    for (; i + Ops::lanes <= count; i += Ops::lanes) {
+        Ops::store(out + i, Op(Ops::load(in + i)));
+    }
+    if (i < count) {
+        typename Ops::T lane[Ops::lanes] = {};
+        for (size_t j = i; j < count; ++j) lane[j - i] = in[j];
+        Ops::store(lane, Op(Ops::load(lane)));
+        for (size_t j = i; j < count; ++j) out[j] = lane[j - i];
+    }
+}